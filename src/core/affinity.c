@@ -0,0 +1,193 @@
+/**
+ * @author ttoobne
+ * @date 2026/10/17
+ */
+
+#include "affinity.h"
+
+#include "log.h"
+
+#include <ctype.h>
+#include <linux/mempolicy.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+static cpu_set_t    affinity_cpus;              /* 允许运行的 CPU 集合 */
+static int          affinity_cpus_num;          /* 集合中的 CPU 数量， 0 表示不限制 */
+static int          affinity_node;              /* 绑定的 NUMA 节点 */
+
+static int parse_cpu_list(const char* str, cpu_set_t* set);
+static int read_node_cpus(int node, cpu_set_t* set);
+
+/*
+ * 初始化线程绑定策略，需在创建任何线程之前调用。
+ * cpu_list 形如 "0-15" 或 "0-3,8,10-11" ，为空字符串时不限制 CPU ；
+ * numa_node 为 NUMA_NODE_NONE 时不绑定节点，否则线程只运行在该节点的 CPU 上，内存优先从该节点分配。
+ * 两者同时指定时取交集。成功返回 0 ，否则返回 -1 。
+ */
+int affinity_init(const char* cpu_list, int numa_node) {
+    cpu_set_t node_cpus;
+
+    affinity_cpus_num = 0;
+    affinity_node = numa_node;
+    CPU_ZERO(&affinity_cpus);
+
+    if (cpu_list != NULL && cpu_list[0] != '\0') {
+        if (parse_cpu_list(cpu_list, &affinity_cpus) != 0) {
+            log_error("invalid cpu list \"%s\".", cpu_list);
+            return -1;
+        }
+    }
+
+    if (numa_node != NUMA_NODE_NONE) {
+        if (read_node_cpus(numa_node, &node_cpus) != 0) {
+            log_error("read cpus of numa node %d failed.", numa_node);
+            return -1;
+        }
+
+        if (CPU_COUNT(&affinity_cpus) > 0) {
+            CPU_AND(&affinity_cpus, &affinity_cpus, &node_cpus);
+        } else {
+            CPU_OR(&affinity_cpus, &affinity_cpus, &node_cpus);
+        }
+    }
+
+    affinity_cpus_num = CPU_COUNT(&affinity_cpus);
+
+    if ((cpu_list != NULL && cpu_list[0] != '\0') || numa_node != NUMA_NODE_NONE) {
+        if (affinity_cpus_num == 0) {
+            log_error("no cpu left after applying cpu_affinity and numa_node.");
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+/*
+ * 按初始化时的策略绑定当前线程。
+ * index 小于 0 时绑定到整个 CPU 集合，否则绑定到集合中的第 index % n 个 CPU ，用于每核一个事件循环。
+ * 此后当前线程首次访问的内存页（ http_request_t 、读缓冲区等）都从绑定的 NUMA 节点分配。
+ * 未初始化时什么也不做。成功返回 0 ，否则返回 -1 。
+ */
+int affinity_bind(int index) {
+    cpu_set_t set;
+    unsigned long nodemask;
+    int cpu;
+    int n;
+
+    if (affinity_cpus_num > 0) {
+        if (index < 0) {
+            set = affinity_cpus;
+        } else {
+            /* 找到集合中的第 index % n 个 CPU */
+            CPU_ZERO(&set);
+            n = index % affinity_cpus_num;
+
+            for (cpu = 0; cpu < CPU_SETSIZE; ++ cpu) {
+                if (CPU_ISSET(cpu, &affinity_cpus) && n -- == 0) {
+                    CPU_SET(cpu, &set);
+                    break;
+                }
+            }
+        }
+
+        if (pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &set) != 0) {
+            log_error("set thread cpu affinity failed.");
+            return -1;
+        }
+    }
+
+    /* 内存优先从绑定节点分配，首次访问时生效 */
+    if (affinity_node != NUMA_NODE_NONE && affinity_node < (int)(sizeof(nodemask) * 8)) {
+        nodemask = 1UL << affinity_node;
+
+        if (syscall(SYS_set_mempolicy, MPOL_PREFERRED, &nodemask, sizeof(nodemask) * 8) != 0) {
+            log_error("set numa memory policy failed.");
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+/*
+ * 解析 CPU 列表，格式为逗号分隔的编号或编号区间，如 "0-3,8,10-11" 。
+ * 成功返回 0 ，否则返回 -1 。
+ */
+static int parse_cpu_list(const char* str, cpu_set_t* set) {
+    const char* p;
+    char* ed;
+    long first;
+    long last;
+    long cpu;
+
+    CPU_ZERO(set);
+
+    for (p = str; *p != '\0'; ) {
+        if (!isdigit(*p)) {
+            return -1;
+        }
+
+        first = strtol(p, &ed, 10);
+        last = first;
+        p = ed;
+
+        if (*p == '-') {
+            if (!isdigit(*(p + 1))) {
+                return -1;
+            }
+
+            last = strtol(p + 1, &ed, 10);
+            p = ed;
+        }
+
+        if (first > last || last >= CPU_SETSIZE) {
+            return -1;
+        }
+
+        for (cpu = first; cpu <= last; ++ cpu) {
+            CPU_SET(cpu, set);
+        }
+
+        if (*p == ',') {
+            p ++ ;
+        } else if (*p != '\0' && *p != '\n') {
+            return -1;
+        } else {
+            break;
+        }
+    }
+
+    return 0;
+}
+
+/*
+ * 从 sysfs 读取 NUMA 节点上的 CPU 列表。
+ * 成功返回 0 ，否则返回 -1 。
+ */
+static int read_node_cpus(int node, cpu_set_t* set) {
+    char path[64];
+    char buf[1024];
+    FILE* fp;
+
+    snprintf(path, sizeof(path), NODE_CPULIST, node);
+
+    if ((fp = fopen(path, "r")) == NULL) {
+        return -1;
+    }
+
+    if (fgets(buf, sizeof(buf), fp) == NULL) {
+        fclose(fp);
+        return -1;
+    }
+
+    fclose(fp);
+
+    return parse_cpu_list(buf, set);
+}
@@ -0,0 +1,28 @@
+/**
+ * @author ttoobne
+ * @date 2026/10/17
+ */
+
+#ifndef _AFFINITY_H_
+#define _AFFINITY_H_
+
+#define NUMA_NODE_NONE  -1          /* 不绑定 NUMA 节点 */
+#define NODE_CPULIST    "/sys/devices/system/node/node%d/cpulist"
+
+/*
+ * 初始化线程绑定策略，需在创建任何线程之前调用。
+ * cpu_list 形如 "0-15" 或 "0-3,8,10-11" ，为空字符串时不限制 CPU ；
+ * numa_node 为 NUMA_NODE_NONE 时不绑定节点，否则线程只运行在该节点的 CPU 上，内存优先从该节点分配。
+ * 两者同时指定时取交集。成功返回 0 ，否则返回 -1 。
+ */
+int affinity_init(const char* cpu_list, int numa_node);
+
+/*
+ * 按初始化时的策略绑定当前线程。
+ * index 小于 0 时绑定到整个 CPU 集合，否则绑定到集合中的第 index % n 个 CPU ，用于每核一个事件循环。
+ * 此后当前线程首次访问的内存页（ http_request_t 、读缓冲区等）都从绑定的 NUMA 节点分配。
+ * 未初始化时什么也不做。成功返回 0 ，否则返回 -1 。
+ */
+int affinity_bind(int index);
+
+#endif /* _AFFINITY_H_ */
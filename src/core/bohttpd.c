@@ -5,27 +5,25 @@
 
 #include "bohttpd.h"
 
+#include "affinity.h"
 #include "config.h"
-#include "epoll.h"
+#include "coroutine.h"
+#include "event_loop.h"
 #include "http.h"
-#include "http_request.h"
+#include "http_file_cache.h"
+#include "http_output.h"
+#include "http_response_cache.h"
+#include "http_scan.h"
 #include "http_timer.h"
 #include "log.h"
 #include "threadpool.h"
+#include "times.h"
 #include "utility.h"
 
-#include <arpa/inet.h>
-#include <errno.h>
 #include <getopt.h>
-#include <netinet/in.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
-#include <string.h>
-#include <sys/epoll.h>
-#include <sys/socket.h>
-#include <sys/types.h>
-#include <time.h>
-#include <unistd.h>
 
 /* 设置长参数选项 */
 static const struct option long_options[] = {
@@ -44,18 +42,12 @@ static void usage();
 int main(int argc, char* argv[]) {
     config_t*           config;
     char*               conf_path;
-    struct sockaddr_in  cliaddr;
-    socklen_t           cliadrlen;
-    epoll_t*            epoll;
-    struct epoll_event  epev;
-    http_request_t*     event;
+    event_loop_t**      loops;
     threadpool_t*       threadpool;
-    msec_t              timeout;
+    int                 loops_num;
     int                 opt;
     int                 options_index;
-    int                 listenfd;
-    int                 connfd;
-    int                 evnum;
+    int                 i;
 
     /* 配置文件默认路径 */
     conf_path = CONF_PATH;
@@ -92,6 +84,11 @@ int main(int argc, char* argv[]) {
 
     log_info("configuration file parsing is complete.");
 
+    /* 初始化时间缓存，定时器与响应头部都依赖它 */
+    if (init_times() != 0) {
+        return 1;
+    }
+
     /* 初始化定时器 */
     if (init_timer() != 0) {
         log_error("init timer failed.");
@@ -100,104 +97,104 @@ int main(int argc, char* argv[]) {
 
     log_info("timer initialization is complete.");
 
-    /* 创建 epoll 文件描述符 */
-    if ((epoll = epoll_create_fd(0)) == NULL) {
-        log_error("create epoll fd failed.");
+    /* 按 CPU 支持的指令集选择请求解析器的批量扫描实现 */
+    log_info("request parser uses %s scanning.", http_scan_name(http_scan_init(HTTP_SCAN_AVX2)));
+
+    /* 静态文件的发送方式 */
+    http_output_init(config->static_send, config->static_copy_max);
+
+    /* 打开文件缓存 */
+    if (http_file_cache_init(config) != 0) {
         return 1;
     }
 
-    /* 创建监听描述符 */
-    if ((listenfd = create_listenfd(config->port)) < 0) {
-        log_error("create listenfd failed.");
+    /* 预先生成的错误响应 */
+    if (http_init_error_pages() != 0) {
         return 1;
     }
 
-    /* 将监听描述符设置为非阻塞 */
-    set_nonblocking(listenfd);
-
-    /* 为了将 listenfd 放入 epoll 中，需要额外为 listenfd 初始化一个事件结构体  */
-    if ((event = http_request_init(listenfd, epoll, NULL)) == NULL) {
-        log_error("event_t init failed.");
+    /* 小文件的完整响应缓存 */
+    if (http_response_cache_init(config) != 0) {
         return 1;
     }
 
-    /* epoll 监听 listenfd 上的 accept 事件，边缘触发 */
-    epev.data.ptr = (void*)event;
-    epev.events = EPOLLIN | EPOLLET;
-    epoll_add_fd(epoll, listenfd, &epev);
+    /* 对端关闭后继续写入不应终止服务器 */
+    if (ignore_sigpipe() != 0) {
+        return 1;
+    }
 
-    /* 创建线程池，大小从配置文件读取 */
-    if ((threadpool = threadpool_create(config->threadpool, config->taskqueue)) == NULL) {
-        log_error("thread poll create failed.");
+    /* 绑定 CPU 与 NUMA 节点，主线程先绑定，此后主线程分配的内存也来自本地节点 */
+    if (affinity_init(config->cpu_affinity, config->numa_node) != 0 ||
+        affinity_bind(config->reactors > 0 ? 0 : -1) != 0) {
+        log_error("set cpu affinity failed.");
         return 1;
     }
 
-    cliadrlen = sizeof(cliaddr);    /* 必须初始化 */
+    /* 每个连接在自己的协程中执行，读写遇到 EAGAIN 时挂起而不占用线程 */
+    coroutine_init((size_t)config->coroutine_stack * 1024);
 
-    log_info("thread pool initialization is complete.");
+    threadpool = NULL;
+    loops_num = config->reactors > 0 ? config->reactors : 1;
 
-    log_info("Bohttpd goes to work.");
+    if (config->reactors == 0) {
+        /* 单事件循环模式，创建弹性线程池，线程数在 [threadpool_min, threadpool] 之间随负载变化 */
+        if ((threadpool = threadpool_create_elastic(config->threadpool_min, config->threadpool, config->taskqueue,
+                                                    config->threadpool_mode, (size_t)config->thread_stack * 1024)) == NULL) {
+            log_error("thread poll create failed.");
+            return 1;
+        }
+
+        threadpool_set_scaling(threadpool, config->thread_grow, config->thread_idle);
 
-    /* 主循环 */
-    for ( ;; ) {
-        timeout = find_timer();
+        /* 排队时间超过 shed_target 时以 503 拒绝请求 */
+        threadpool_set_shedding(threadpool, config->shed_target, config->shed_interval, http_shed_request);
 
-        /* 根据超时时间最接近的事件确定 epoll wait 的阻塞时间 */
-        if ((evnum = epoll_wait_event(epoll, MAX_EVENTS, timeout)) < 0) {
-            log_error("epoll wait failed.");
+        log_info("thread pool initialization is complete.");
+    }
+
+    if ((loops = (event_loop_t**)calloc(loops_num, sizeof(event_loop_t*))) == NULL) {
+        log_error("event loops malloc failed.");
+        return 1;
+    }
+
+    /* 多事件循环模式下每个事件循环各自拥有一个 SO_REUSEPORT 监听描述符 */
+    for (i = 0; i < loops_num; ++ i) {
+        if ((loops[i] = event_loop_create(i, config, threadpool, config->reactors > 0)) == NULL) {
+            log_error("create event loop failed.");
             return 1;
         }
+    }
 
-        /* 此时一定有超时事件，需要执行回调函数 */
-        expire_timers();
-
-        while(evnum -- ) {
-            event = (http_request_t*)(epoll->events[evnum].data.ptr);
-            if (event->fd == listenfd) {
-                /* 边缘触发，所以必须处理完所有的连接请求 */
-                for ( ;; ) {
-                    //log_debug("ready to accept");
-                    if ((connfd = accept(listenfd, (struct sockaddr*)&cliaddr, &cliadrlen)) < 0) {
-                        if (errno != EAGAIN && errno != EWOULDBLOCK) {
-                            log_error("accept error.");
-                        }
-
-                        break;
-                    }
-
-                    log_info("new connection arrive. client<%s:%u>", 
-                            inet_ntoa(cliaddr.sin_addr), ntohs(cliaddr.sin_port));
-                    
-                    /* 初始化已连接描述符，加入定时器、epoll 监听可读事件 */
-                    http_init_connection(connfd, epoll, config);
-                }
-                
-            } else {
-                if ((epoll->events[evnum].events & EPOLLERR) || 
-                    (epoll->events[evnum].events & EPOLLHUP) || /* 对端关闭连接 */
-                    !(epoll->events[evnum].events & EPOLLIN)) {
-
-                    close(connfd);
-                    continue;
-                }
-
-                event = epoll->events[evnum].data.ptr;
-
-                /* 将执行任务添加至工作队列等待线程执行 */
-                threadpool_add_task(threadpool, execute_request, (void*)event);
-
-                //execute_request(event);
-            }
+    log_info("Bohttpd goes to work.");
+
+    /* 第 0 个事件循环运行在主线程上，其余的各自创建线程 */
+    for (i = 1; i < loops_num; ++ i) {
+        if (pthread_create(&(loops[i]->tid), NULL, event_loop_run, (void*)loops[i]) != 0) {
+            log_error("create event loop thread failed.");
+            return 1;
         }
     }
 
-    config_destroy(config);
+    loops[0]->tid = pthread_self();
+    event_loop_run((void*)loops[0]);
 
-    epoll_free(epoll);
+    for (i = 1; i < loops_num; ++ i) {
+        pthread_join(loops[i]->tid, NULL);
+    }
+
+    for (i = 0; i < loops_num; ++ i) {
+        event_loop_destroy(loops[i]);
+    }
+
+    free(loops);
 
-    threadpool_destroy(threadpool);
+    if (threadpool) {
+        threadpool_destroy(threadpool);
+    }
+
+    config_destroy(config);
 
-    return 0;
+    return 1;
 }
 
 /*
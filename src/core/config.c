@@ -6,11 +6,13 @@
 #include "config.h"
 
 #include "log.h"
+#include "threadpool.h"
 
 #include <ctype.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
 static int check_name_value(config_t* config, char* name_st, char* name_ed, char* value_st, char* value_ed);
 static long to_interger(char* st, char* ed);
@@ -52,13 +54,36 @@ config_t* parse_configuration(char* filename) {
 
         /* 设置配置默认值 */
         config->threadpool = THREADPOOL_DEF;
+        config->threadpool_min = THREADMIN_DEF;
+        config->thread_stack = THREADSTACK_DEF;
+        config->coroutine_stack = COSTACK_DEF;
+        config->thread_grow = THREADGROW_DEF;
+        config->thread_idle = THREADIDLE_DEF;
         config->taskqueue = TASKQUEUE_DEF;
+        config->threadpool_mode = TPMODE_DEF;
+        config->shed_target = SHEDTARGET_DEF;
+        config->shed_interval = SHEDINTVL_DEF;
         memset(config->root, 0, sizeof(config->root));
         memset(config->defile, 0, sizeof(config->defile));
         strncpy(config->root, ROOT_DEF, 2);
         strncpy(config->defile, DEFILE_DEF, 10);
         config->timeout = TIMEOUT_DEF;
+        config->large_header_buffers = LARGEBUFS_DEF;
         config->port = PORT_DEF;
+        config->reactors = REACTORS_DEF;
+        config->event_backend = BACKEND_DEF;
+        config->conn_pool = CONNPOOL_DEF;
+        config->conn_pool_hugepage = CONNHUGE_DEF;
+        memset(config->cpu_affinity, 0, sizeof(config->cpu_affinity));
+        strcpy(config->cpu_affinity, CPUAFFINITY_DEF);
+        config->numa_node = NUMANODE_DEF;
+        config->static_send = STATICSEND_DEF;
+        config->static_copy_max = STATICCOPY_DEF;
+        config->open_file_cache = FILECACHE_DEF;
+        config->open_file_cache_valid = FILEVALID_DEF;
+        config->negative_cache_valid = NEGVALID_DEF;
+        config->response_cache = RESPCACHE_DEF;
+        config->response_cache_max = RESPCMAX_DEF;
 
         /* 只读打开配置文件 */
         if ((fp = fopen(filename, "r")) == NULL) {
@@ -121,7 +146,8 @@ config_t* parse_configuration(char* filename) {
                         break;
                     }
 
-                    if (!isalpha(ch) && !isdigit(ch)) {
+                    /* 配置名中允许出现下划线，如 threadpool_mode */
+                    if (!isalpha(ch) && !isdigit(ch) && ch != '_') {
                         if (!iscntrl(ch)) {
                             log_warn("line %d in configuration file: unrecognized syntax or character '%c'.", line, ch);
                         } else {
@@ -201,6 +227,23 @@ config_t* parse_configuration(char* filename) {
         fclose(fp);
         fp = NULL;
 
+        /* 最小线程数不超过线程池大小 */
+        if (config->threadpool_min > config->threadpool) {
+            config->threadpool_min = config->threadpool;
+        }
+
+        /* reactors = auto 时按在线 CPU 核数创建事件循环 */
+        if (config->reactors == REACTORS_AUTO) {
+            if ((config->reactors = sysconf(_SC_NPROCESSORS_ONLN)) <= 0) {
+                config->reactors = 1;
+            }
+        }
+
+        /* io_uring 后端在事件循环线程上执行请求，不使用线程池 */
+        if (config->event_backend == BACKEND_URING && config->reactors == 0) {
+            config->reactors = 1;
+        }
+
         return config;
 
     } while(0);
@@ -279,7 +322,50 @@ static int check_name_value(config_t* config, char* name_st, char* name_ed, char
 
         break;
 
+    case 8:
+        if (strncmp("reactors", name_st, name_ed - name_st + 1) == 0) {
+            if (strcmp("auto", value_st) == 0) {
+                config->reactors = REACTORS_AUTO;
+                return 0;
+            }
+
+            if ((ret = (to_interger(value_st, value_ed))) < 0) {
+                return -1;
+            }
+
+            if (ret > INT_MAX) {
+                return -1;
+            }
+
+            config->reactors = ret;
+            return 0;
+        }
+
+        break;
+
     case 9:
+        if (strncmp("conn_pool", name_st, name_ed - name_st + 1) == 0) {
+            if ((ret = (to_interger(value_st, value_ed))) < 0) {
+                return -1;
+            }
+
+            config->conn_pool = ret;
+            return 0;
+        }
+
+        if (strncmp("numa_node", name_st, name_ed - name_st + 1) == 0) {
+            if ((ret = (to_interger(value_st, value_ed))) < 0) {
+                return -1;
+            }
+
+            if (ret > INT_MAX) {
+                return -1;
+            }
+
+            config->numa_node = ret;
+            return 0;
+        }
+
         if (strncmp("taskqueue", name_st, name_ed - name_st + 1) == 0) {
             if ((ret = (to_interger(value_st, value_ed))) < 0) {
                 return -1;
@@ -311,6 +397,237 @@ static int check_name_value(config_t* config, char* name_st, char* name_ed, char
 
         break;
         
+    case 11:
+        if (strncmp("thread_grow", name_st, name_ed - name_st + 1) == 0) {
+            if ((ret = (to_interger(value_st, value_ed))) < 0) {
+                return -1;
+            }
+
+            config->thread_grow = ret;
+            return 0;
+        }
+
+        if (strncmp("thread_idle", name_st, name_ed - name_st + 1) == 0) {
+            if ((ret = (to_interger(value_st, value_ed))) <= 0) {
+                return -1;
+            }
+
+            config->thread_idle = ret;
+            return 0;
+        }
+
+        if (strncmp("static_send", name_st, name_ed - name_st + 1) == 0) {
+            if (strcmp("sendfile", value_st) == 0) {
+                config->static_send = STATIC_SENDFILE;
+                return 0;
+            }
+
+            if (strcmp("mmap", value_st) == 0) {
+                config->static_send = STATIC_MMAP;
+                return 0;
+            }
+
+            return -1;
+        }
+
+        if (strncmp("shed_target", name_st, name_ed - name_st + 1) == 0) {
+            if ((ret = (to_interger(value_st, value_ed))) < 0) {
+                return -1;
+            }
+
+            config->shed_target = ret;
+            return 0;
+        }
+
+        break;
+
+    case 12:
+        if (strncmp("thread_stack", name_st, name_ed - name_st + 1) == 0) {
+            if ((ret = (to_interger(value_st, value_ed))) < 0) {
+                return -1;
+            }
+
+            if (ret > INT_MAX / 1024) {
+                return -1;
+            }
+
+            config->thread_stack = ret;
+            return 0;
+        }
+
+        if (strncmp("cpu_affinity", name_st, name_ed - name_st + 1) == 0) {
+            if (value_ed - value_st + 1 >= sizeof(config->cpu_affinity)) {
+                return -1;
+            }
+
+            strncpy(config->cpu_affinity, value_st, sizeof(config->cpu_affinity));
+            return 0;
+        }
+
+        break;
+
+    case 13:
+        if (strncmp("event_backend", name_st, name_ed - name_st + 1) == 0) {
+            if (strcmp("epoll", value_st) == 0) {
+                config->event_backend = BACKEND_EPOLL;
+                return 0;
+            }
+
+            if (strcmp("io_uring", value_st) == 0) {
+                config->event_backend = BACKEND_URING;
+                return 0;
+            }
+
+            return -1;
+        }
+
+        if (strncmp("shed_interval", name_st, name_ed - name_st + 1) == 0) {
+            if ((ret = (to_interger(value_st, value_ed))) <= 0) {
+                return -1;
+            }
+
+            config->shed_interval = ret;
+            return 0;
+        }
+
+        break;
+
+    case 14:
+        if (strncmp("threadpool_min", name_st, name_ed - name_st + 1) == 0) {
+            if ((ret = (to_interger(value_st, value_ed))) <= 0) {
+                return -1;
+            }
+
+            if (ret > INT_MAX) {
+                return -1;
+            }
+
+            config->threadpool_min = ret;
+            return 0;
+        }
+
+        if (strncmp("response_cache", name_st, name_ed - name_st + 1) == 0) {
+            if ((ret = (to_interger(value_st, value_ed))) < 0) {
+                return -1;
+            }
+
+            config->response_cache = ret;
+            return 0;
+        }
+
+        break;
+
+    case 15:
+        if (strncmp("threadpool_mode", name_st, name_ed - name_st + 1) == 0) {
+            if (strcmp("fifo", value_st) == 0) {
+                config->threadpool_mode = THREADPOOL_FIFO;
+                return 0;
+            }
+
+            if (strcmp("steal", value_st) == 0) {
+                config->threadpool_mode = THREADPOOL_STEAL;
+                return 0;
+            }
+
+            return -1;
+        }
+
+        if (strncmp("static_copy_max", name_st, name_ed - name_st + 1) == 0) {
+            if ((ret = (to_interger(value_st, value_ed))) < 0) {
+                return -1;
+            }
+
+            config->static_copy_max = ret;
+            return 0;
+        }
+
+        if (strncmp("open_file_cache", name_st, name_ed - name_st + 1) == 0) {
+            if ((ret = (to_interger(value_st, value_ed))) < 0) {
+                return -1;
+            }
+
+            config->open_file_cache = ret;
+            return 0;
+        }
+
+        if (strncmp("coroutine_stack", name_st, name_ed - name_st + 1) == 0) {
+            if ((ret = (to_interger(value_st, value_ed))) < COSTACK_MIN) {
+                return -1;
+            }
+
+            if (ret > INT_MAX / 1024) {
+                return -1;
+            }
+
+            config->coroutine_stack = ret;
+            return 0;
+        }
+
+        break;
+
+    case 18:
+        if (strncmp("conn_pool_hugepage", name_st, name_ed - name_st + 1) == 0) {
+            if (strcmp("on", value_st) == 0) {
+                config->conn_pool_hugepage = 1;
+                return 0;
+            }
+
+            if (strcmp("off", value_st) == 0) {
+                config->conn_pool_hugepage = 0;
+                return 0;
+            }
+
+            return -1;
+        }
+
+        if (strncmp("response_cache_max", name_st, name_ed - name_st + 1) == 0) {
+            if ((ret = (to_interger(value_st, value_ed))) < 0) {
+                return -1;
+            }
+
+            config->response_cache_max = ret;
+            return 0;
+        }
+
+        break;
+
+    case 20:
+        if (strncmp("large_header_buffers", name_st, name_ed - name_st + 1) == 0) {
+            if ((ret = (to_interger(value_st, value_ed))) < 0) {
+                return -1;
+            }
+
+            if (ret > INT_MAX) {
+                return -1;
+            }
+
+            config->large_header_buffers = ret;
+            return 0;
+        }
+
+        if (strncmp("negative_cache_valid", name_st, name_ed - name_st + 1) == 0) {
+            if ((ret = (to_interger(value_st, value_ed))) < 0) {
+                return -1;
+            }
+
+            config->negative_cache_valid = ret;
+            return 0;
+        }
+
+        break;
+
+    case 21:
+        if (strncmp("open_file_cache_valid", name_st, name_ed - name_st + 1) == 0) {
+            if ((ret = (to_interger(value_st, value_ed))) <= 0) {
+                return -1;
+            }
+
+            config->open_file_cache_valid = ret;
+            return 0;
+        }
+
+        break;
+        
     default:
         break;
     }
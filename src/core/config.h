@@ -11,20 +11,70 @@
 #define USHORT_MAX      65535
 #define INT_MAX         2147483647
 
-#define THREADPOOL_DEF  64              /* 线程池大小默认值 */
+#define THREADPOOL_DEF  64              /* 线程池大小（最大线程数）默认值 */
+#define THREADMIN_DEF   4               /* 最小线程数默认值 */
+#define THREADSTACK_DEF 256             /* 线程栈大小默认值（ KB ） */
+#define COSTACK_DEF     64              /* 协程栈大小默认值（ KB ） */
+#define COSTACK_MIN     32              /* 协程栈大小下限（ KB ），从 serve_connection 起最深的调用链约 12KB ，另需留给 libc */
+#define THREADGROW_DEF  10              /* 扩容阈值默认值 */
+#define THREADIDLE_DEF  10000           /* 线程空闲退出时间默认值 */
 #define TASKQUEUE_DEF   32              /* 任务队列大小默认值 */
+#define TPMODE_DEF      0               /* 线程池调度模式默认值， 0 为 fifo ， 1 为 steal */
+#define SHEDTARGET_DEF  0               /* 过载控制的目标排队时间默认值， 0 表示关闭 */
+#define SHEDINTVL_DEF   100             /* 过载控制的观察区间默认值 */
+#define CPUAFFINITY_DEF ""              /* 线程绑定的 CPU 列表默认值，空表示不绑定 */
+#define NUMANODE_DEF    -1              /* 绑定的 NUMA 节点默认值， -1 表示不绑定 */
 #define ROOT_DEF        "./html/"       /* 根目录默认值 */
 #define DEFILE_DEF      "index.html"    /* 默认文件默认值 */
 #define TIMEOUT_DEF     1000            /* 长连接超时时间默认值 */
+#define LARGEBUFS_DEF   4               /* 一个请求最多使用的大读缓冲区个数默认值 */
 #define PORT_DEF        80              /* 端口号默认值 */
+#define REACTORS_DEF    0               /* 事件循环数量默认值， 0 表示单事件循环 + 线程池 */
+#define REACTORS_AUTO   -1              /* reactors = auto ，按在线 CPU 核数创建事件循环 */
+#define BACKEND_EPOLL   0               /* 事件循环使用 epoll */
+#define BACKEND_URING   1               /* 事件循环使用 io_uring */
+#define BACKEND_DEF     BACKEND_EPOLL   /* 事件循环后端默认值 */
+#define CONNPOOL_DEF    1024            /* 每个事件循环的连接对象池容量默认值， 0 表示不使用对象池 */
+#define CONNHUGE_DEF    0               /* 连接对象池是否使用大页默认值 */
+#define STATIC_SENDFILE 0               /* 静态文件用 sendfile 从页缓存直接发送 */
+#define STATIC_MMAP     1               /* 静态文件映射到内存后 writev 发送 */
+#define STATICSEND_DEF  STATIC_SENDFILE /* 静态文件发送方式默认值 */
+#define STATICCOPY_DEF  16384           /* 读入内存发送的静态文件大小上限默认值 */
+#define FILECACHE_DEF   1024            /* 打开文件缓存的条目数默认值， 0 表示不缓存 */
+#define FILEVALID_DEF   1000            /* inotify 不可用时打开文件缓存条目的有效时间默认值 */
+#define NEGVALID_DEF    5000            /* 否定条目的有效时间默认值， 0 表示不缓存否定结果 */
+#define RESPCACHE_DEF   8192            /* 响应缓存的内存预算默认值（ KB ）， 0 表示不缓存 */
+#define RESPCMAX_DEF    16384           /* 缓存的响应体大小上限默认值 */
 
 typedef struct {
-    int             threadpool;         /* 线程池大小 */
+    int             threadpool;         /* 线程池大小，即最大线程数 */
+    int             threadpool_min;     /* 最小线程数 */
+    int             thread_stack;       /* 线程栈大小（ KB ） */
+    int             coroutine_stack;    /* 每个连接的协程栈大小（ KB ） */
+    unsigned long   thread_grow;        /* 任务排队超过该时间（毫秒）时增加线程 */
+    unsigned long   thread_idle;        /* 多出的线程空闲该时间（毫秒）后退出 */
     int             taskqueue;          /* 任务队列大小 */
+    int             threadpool_mode;    /* 线程池调度模式 */
+    unsigned long   shed_target;        /* 过载控制的目标排队时间（毫秒） */
+    unsigned long   shed_interval;      /* 过载控制的观察区间（毫秒） */
     char            root[NAME_MAX];     /* 根目录 */
     char            defile[NAME_MAX];   /* 默认文件名 */
     unsigned long   timeout;            /* 长连接超时时间 */
+    int             large_header_buffers;   /* 请求头部超过第一块读缓冲区时最多追加的大缓冲区个数 */
     unsigned short  port;               /* 端口号 */
+    int             reactors;           /* 多事件循环模式下事件循环的数量 */
+    int             event_backend;      /* 事件循环后端， BACKEND_EPOLL 或 BACKEND_URING */
+    unsigned long   conn_pool;          /* 每个事件循环预先映射的连接对象个数 */
+    int             conn_pool_hugepage; /* 连接对象池是否使用大页 */
+    char            cpu_affinity[NAME_MAX]; /* 工作线程与事件循环绑定的 CPU 列表，如 0-15 */
+    int             numa_node;          /* 工作线程与事件循环绑定的 NUMA 节点 */
+    int             static_send;        /* 静态文件发送方式， STATIC_SENDFILE 或 STATIC_MMAP */
+    unsigned long   static_copy_max;    /* 不超过该大小的静态文件读入内存，与响应头部一起发送 */
+    unsigned long   open_file_cache;    /* 打开文件缓存的条目数 */
+    unsigned long   open_file_cache_valid;  /* inotify 不可用时打开文件缓存条目的有效时间（毫秒） */
+    unsigned long   negative_cache_valid;   /* 不存在或不可读的路径的缓存时间（毫秒） */
+    unsigned long   response_cache;     /* 完整响应缓存的内存预算（ KB ） */
+    unsigned long   response_cache_max; /* 不超过该大小的静态文件缓存完整的响应 */
 } config_t;
 
 /*
@@ -0,0 +1,314 @@
+/**
+ * @author ttoobne
+ * @date 2026/10/17
+ */
+
+#include "coroutine.h"
+
+#include "log.h"
+#include "pool.h"
+
+#include <pthread.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#if !defined(__x86_64__)
+#include <ucontext.h>
+#endif
+
+/*
+ * 协程结构体放在栈映射的最高处，栈从它下方开始向下增长，最低的一页为保护页。
+ * 一次 mmap 即可得到协程所需的全部内存。
+ */
+struct coroutine_s {
+#if defined(__x86_64__)
+    void*               sp;             /* 挂起时协程的栈指针 */
+    void*               caller_sp;      /* 协程运行时恢复方的栈指针 */
+#else
+    ucontext_t          ctx;            /* 协程的上下文 */
+    ucontext_t          caller_ctx;     /* 恢复方的上下文 */
+#endif
+    void*               map;            /* 栈映射的起始地址 */
+    pool_cache_t*       cache;          /* 创建协程的线程的空闲栈缓存， NULL 表示共用的缓存 */
+    coroutine_func_t*   func;           /* 协程函数 */
+    void*               arg;            /* 协程函数的参数 */
+    int                 state;          /* 协程状态 */
+};
+
+static size_t           stack_size = COROUTINE_STACK_DEF;   /* 不含保护页的栈大小 */
+static size_t           page_size;
+static void*            cache[COROUTINE_CACHE_MAX];         /* 没有自己的缓存的线程共用的空闲栈映射 */
+static int              cache_num;
+static pthread_mutex_t  cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static __thread pool_cache_t* local_cache;                  /* 当前线程的空闲栈缓存 */
+
+static void* coroutine_map();
+static void coroutine_main(coroutine_t* co);
+
+#if defined(__x86_64__)
+
+/*
+ * 保存被调用者保存的寄存器，将栈指针存入 *from ，切换到栈 to 并恢复其寄存器。
+ * 由汇编实现，只保存 System V ABI 要求调用前后不变的寄存器，比 swapcontext 少一次修改信号掩码的系统调用。
+ */
+void coroutine_switch(void** from, void* to);
+
+/*
+ * 协程首次运行的入口， r12 为协程指针， r13 为 coroutine_main 。
+ */
+void coroutine_entry();
+
+__asm__ (
+    ".text\n"
+    ".p2align 4\n"
+    ".type coroutine_switch, @function\n"
+    "coroutine_switch:\n"
+    "    pushq %rbp\n"
+    "    pushq %rbx\n"
+    "    pushq %r12\n"
+    "    pushq %r13\n"
+    "    pushq %r14\n"
+    "    pushq %r15\n"
+    "    movq %rsp, (%rdi)\n"
+    "    movq %rsi, %rsp\n"
+    "    popq %r15\n"
+    "    popq %r14\n"
+    "    popq %r13\n"
+    "    popq %r12\n"
+    "    popq %rbx\n"
+    "    popq %rbp\n"
+    "    ret\n"
+    ".size coroutine_switch, .-coroutine_switch\n"
+    "\n"
+    ".p2align 4\n"
+    ".type coroutine_entry, @function\n"
+    "coroutine_entry:\n"
+    "    movq %r12, %rdi\n"
+    "    call *%r13\n"
+    "    ud2\n"
+    ".size coroutine_entry, .-coroutine_entry\n"
+);
+
+#else
+
+static __thread coroutine_t* coroutine_starting;    /* makecontext 无法可移植地传递指针，首次运行时经由它传递 */
+
+static void coroutine_start() {
+    coroutine_main(coroutine_starting);
+}
+
+#endif
+
+/*
+ * 设置之后创建的协程的栈大小（字节），不足一页按一页计算，应在创建协程前调用。
+ */
+void coroutine_init(size_t size) {
+    page_size = sysconf(_SC_PAGESIZE);
+
+    if (size < page_size) {
+        size = page_size;
+    }
+
+    stack_size = (size + page_size - 1) & ~(page_size - 1);
+}
+
+/*
+ * 为当前线程创建空闲栈缓存，之后当前线程创建的协程销毁时栈归还到这里，否则归还到共用的加锁缓存。
+ * 只能由不会退出的线程（事件循环线程）调用。成功返回 0 ，失败返回 -1 。
+ */
+int coroutine_init_local() {
+    if (local_cache == NULL && (local_cache = pool_cache_create(COROUTINE_CACHE_MAX)) == NULL) {
+        return -1;
+    }
+
+    return 0;
+}
+
+/*
+ * 创建协程，首次恢复时执行 func(arg) 。
+ * 创建成功则返回 coroutine_t 类型指针，失败则返回 NULL 。
+ */
+coroutine_t* coroutine_create(coroutine_func_t* func, void* arg) {
+    coroutine_t* co;
+    uintptr_t top;
+    void* map;
+
+    if ((map = coroutine_map()) == NULL) {
+        return NULL;
+    }
+
+    top = ((uintptr_t)map + page_size + stack_size - sizeof(coroutine_t)) & ~(uintptr_t)15;
+    co = (coroutine_t*)top;
+
+    co->map = map;
+    co->cache = local_cache;
+    co->func = func;
+    co->arg = arg;
+    co->state = COROUTINE_READY;
+
+#if defined(__x86_64__)
+    {
+        uintptr_t* sp;
+
+        /* 伪造一次 coroutine_switch 保存的现场： 6 个寄存器与返回地址，返回后栈指针 16 字节对齐 */
+        sp = (uintptr_t*)(top - 16 - 8 - 6 * 8);
+        memset(sp, 0, 6 * 8);
+        sp[2] = (uintptr_t)coroutine_main;     /* r13 */
+        sp[3] = (uintptr_t)co;                 /* r12 */
+        sp[6] = (uintptr_t)coroutine_entry;    /* 返回地址 */
+
+        co->sp = sp;
+    }
+#else
+    if (getcontext(&(co->ctx)) != 0) {
+        log_error("getcontext failed.");
+        coroutine_free(co);
+        return NULL;
+    }
+
+    co->ctx.uc_stack.ss_sp = (char*)map + page_size;
+    co->ctx.uc_stack.ss_size = top - ((uintptr_t)map + page_size);
+    co->ctx.uc_link = NULL;
+    makecontext(&(co->ctx), coroutine_start, 0);
+#endif
+
+    return co;
+}
+
+/*
+ * 恢复协程运行，直到协程挂起或协程函数返回。
+ * 返回协程的状态： COROUTINE_SUSPENDED 或 COROUTINE_DEAD 。
+ */
+int coroutine_resume(coroutine_t* co) {
+    if (co->state != COROUTINE_READY && co->state != COROUTINE_SUSPENDED) {
+        return co->state;
+    }
+
+    co->state = COROUTINE_RUNNING;
+
+#if defined(__x86_64__)
+    coroutine_switch(&(co->caller_sp), co->sp);
+#else
+    coroutine_starting = co;
+    swapcontext(&(co->caller_ctx), &(co->ctx));
+#endif
+
+    return co->state;
+}
+
+/*
+ * 挂起当前协程，回到恢复它的位置。只能在协程内部调用。
+ */
+void coroutine_yield(coroutine_t* co) {
+    co->state = COROUTINE_SUSPENDED;
+
+#if defined(__x86_64__)
+    coroutine_switch(&(co->sp), co->caller_sp);
+#else
+    swapcontext(&(co->ctx), &(co->caller_ctx));
+#endif
+}
+
+/*
+ * 销毁协程，协程不能正在运行，可以在任意线程调用。栈放回创建协程的线程的缓存供之后的协程使用。
+ */
+void coroutine_free(coroutine_t* co) {
+    pool_node_t* node;
+    void* map;
+
+    if (co == NULL) {
+        return;
+    }
+
+    map = co->map;
+
+    if (co->cache) {
+        /* 空闲栈的链接放在保护页之上的栈底，协程结构体此后不再使用 */
+        node = (pool_node_t*)((char*)map + page_size);
+        node->cache = co->cache;
+
+        if (pool_cache_put(local_cache, node) != 0) {
+            munmap(map, page_size + stack_size);
+        }
+
+        return;
+    }
+
+    pthread_mutex_lock(&cache_mutex);
+
+    if (cache_num < COROUTINE_CACHE_MAX) {
+        cache[cache_num ++ ] = map;
+        map = NULL;
+    }
+
+    pthread_mutex_unlock(&cache_mutex);
+
+    if (map) {
+        munmap(map, page_size + stack_size);
+    }
+}
+
+/*
+ * 获取一个栈映射，优先使用当前线程的缓存，当前线程没有缓存时使用共用的缓存。失败返回 NULL 。
+ */
+static void* coroutine_map() {
+    pool_node_t* node;
+    void* map;
+
+    map = NULL;
+
+    if (local_cache) {
+        if ((node = pool_cache_get(local_cache)) != NULL) {
+            map = (char*)node - page_size;
+        }
+    } else {
+        pthread_mutex_lock(&cache_mutex);
+
+        if (cache_num > 0) {
+            map = cache[ -- cache_num];
+        }
+
+        pthread_mutex_unlock(&cache_mutex);
+    }
+
+    if (map) {
+        return map;
+    }
+
+    if (page_size == 0) {
+        coroutine_init(stack_size);
+    }
+
+    if ((map = mmap(NULL, page_size + stack_size, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS | MAP_STACK, -1, 0)) == MAP_FAILED) {
+        log_error("coroutine stack mmap failed.");
+        return NULL;
+    }
+
+    /* 最低的一页作为保护页 */
+    if (mprotect(map, page_size, PROT_NONE) != 0) {
+        log_error("coroutine guard page mprotect failed.");
+        munmap(map, page_size + stack_size);
+        return NULL;
+    }
+
+    return map;
+}
+
+/*
+ * 协程的最外层函数：执行协程函数，返回后切换回恢复方，不再返回。
+ */
+static void coroutine_main(coroutine_t* co) {
+    co->func(co->arg);
+
+    co->state = COROUTINE_DEAD;
+
+#if defined(__x86_64__)
+    coroutine_switch(&(co->sp), co->caller_sp);
+#else
+    swapcontext(&(co->ctx), &(co->caller_ctx));
+#endif
+}
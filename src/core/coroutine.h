@@ -0,0 +1,63 @@
+/**
+ * @author ttoobne
+ * @date 2026/10/17
+ */
+
+#ifndef _COROUTINE_H_
+#define _COROUTINE_H_
+
+#include <stddef.h>
+
+/*
+ * 有栈协程。每个协程拥有独立的 mmap 栈，栈底设有保护页，溢出时立即触发段错误而不是破坏相邻内存。
+ * 协程可以在不同线程上恢复执行，但同一时刻只能由一个线程恢复。
+ * 协程函数中不要直接读取 errno ：编译器可能复用挂起前取得的 errno 地址，在其他线程恢复后读到错误的值，
+ * 应在协程函数之外的函数中完成系统调用与 errno 的判断。
+ */
+
+#define COROUTINE_STACK_DEF     (64 * 1024)     /* 默认栈大小 */
+#define COROUTINE_CACHE_MAX     256             /* 每个缓存保留的空闲栈数量上限 */
+
+#define COROUTINE_READY         0               /* 已创建，尚未运行 */
+#define COROUTINE_SUSPENDED     1               /* 已挂起 */
+#define COROUTINE_RUNNING       2               /* 正在运行 */
+#define COROUTINE_DEAD          3               /* 协程函数已返回 */
+
+typedef void (coroutine_func_t) (void* arg);
+
+typedef struct coroutine_s coroutine_t;
+
+/*
+ * 设置之后创建的协程的栈大小（字节），不足一页按一页计算，应在创建协程前调用。
+ */
+void coroutine_init(size_t stack_size);
+
+/*
+ * 为当前线程创建空闲栈缓存，之后当前线程创建的协程销毁时栈归还到这里，否则归还到共用的加锁缓存。
+ * 只能由不会退出的线程（事件循环线程）调用。成功返回 0 ，失败返回 -1 。
+ */
+int coroutine_init_local();
+
+/*
+ * 创建协程，首次恢复时执行 func(arg) 。
+ * 创建成功则返回 coroutine_t 类型指针，失败则返回 NULL 。
+ */
+coroutine_t* coroutine_create(coroutine_func_t* func, void* arg);
+
+/*
+ * 恢复协程运行，直到协程挂起或协程函数返回。
+ * 返回协程的状态： COROUTINE_SUSPENDED 或 COROUTINE_DEAD 。
+ */
+int coroutine_resume(coroutine_t* co);
+
+/*
+ * 挂起当前协程，回到恢复它的位置。只能在协程内部调用。
+ */
+void coroutine_yield(coroutine_t* co);
+
+/*
+ * 销毁协程，协程不能正在运行，可以在任意线程调用。栈放回创建协程的线程的缓存供之后的协程使用。
+ */
+void coroutine_free(coroutine_t* co);
+
+#endif /* _COROUTINE_H_ */
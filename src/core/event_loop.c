@@ -0,0 +1,482 @@
+/**
+ * @author ttoobne
+ * @date 2026/10/17
+ */
+
+#include "event_loop.h"
+
+#include "affinity.h"
+#include "coroutine.h"
+#include "http.h"
+#include "http_buffer.h"
+#include "http_request.h"
+#include "http_timer.h"
+#include "http_uring.h"
+#include "log.h"
+#include "pool.h"
+#include "times.h"
+#include "uring.h"
+#include "utility.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <stdlib.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+static int event_loop_run_uring(event_loop_t* loop);
+static void event_loop_accept(event_loop_t* loop);
+static void event_loop_dispatch(event_loop_t* loop, http_request_t* event);
+static void event_loop_redispatch(event_loop_t* loop);
+static void event_loop_report(event_loop_t* loop);
+static void event_loop_report_pool(event_loop_t* loop);
+static void event_loop_report_files(event_loop_t* loop);
+
+/*
+ * 创建事件循环，包括 epoll 与监听描述符。
+ * threadpool 为 NULL 时请求在事件循环线程上执行，reuseport 非 0 时监听描述符设置 SO_REUSEPORT 。
+ * 创建成功则返回 event_loop_t 类型指针，失败则返回 NULL 。
+ */
+event_loop_t* event_loop_create(int id, config_t* config, threadpool_t* threadpool, int reuseport) {
+    event_loop_t* loop;
+    struct epoll_event epev;
+
+    if ((loop = (event_loop_t*)malloc(sizeof(event_loop_t))) == NULL) {
+        log_error("event_loop_t malloc failed.");
+        return NULL;
+    }
+
+    loop->id = id;
+    loop->epoll = NULL;
+    loop->listenfd = -1;
+    loop->listen_event = NULL;
+    loop->threadpool = threadpool;
+    loop->config = config;
+    loop->deferred = NULL;
+    loop->deferred_num = 0;
+    loop->defer_total = 0;
+    loop->shed_total = 0;
+    loop->stats_msec = 0;
+    loop->stats_sum = 0;
+    loop->pool_msec = 0;
+    loop->pool_miss = 0;
+    loop->files_msec = 0;
+    loop->files_coalesced = 0;
+
+    do {
+        if (threadpool && (loop->deferred = (deferred_event_t*)malloc(sizeof(deferred_event_t) * DEFER_MAX)) == NULL) {
+            log_error("deferred events malloc failed.");
+            break;
+        }
+
+        /* 创建 epoll 文件描述符 */
+        if ((loop->epoll = epoll_create_fd(0)) == NULL) {
+            log_error("create epoll fd failed.");
+            break;
+        }
+
+        /* 创建监听描述符 */
+        if ((loop->listenfd = create_listenfd(config->port, reuseport)) < 0) {
+            log_error("create listenfd failed.");
+            break;
+        }
+
+        /* 将监听描述符设置为非阻塞 */
+        set_nonblocking(loop->listenfd);
+
+        /* 为了将 listenfd 放入 epoll 中，需要额外为 listenfd 初始化一个事件结构体  */
+        if ((loop->listen_event = http_request_init(loop->listenfd, loop->epoll, NULL)) == NULL) {
+            log_error("event_t init failed.");
+            break;
+        }
+
+        /* epoll 监听 listenfd 上的 accept 事件，边缘触发 */
+        epev.data.ptr = loop->listen_event;
+        epev.events = EPOLLIN | EPOLLET;
+        if (epoll_add_fd(loop->epoll, loop->listenfd, &epev) != 0) {
+            break;
+        }
+
+        return loop;
+
+    } while (0);
+
+    event_loop_destroy(loop);
+
+    return NULL;
+}
+
+/*
+ * 运行事件循环，可直接作为线程函数使用，出错时返回。
+ */
+void* event_loop_run(void* event_loop) {
+    event_loop_t* loop;
+    http_request_t* event;
+    msec_t timeout;
+    uint32_t events;
+    int evnum;
+
+    loop = (event_loop_t*)event_loop;
+
+    /* 多事件循环模式下每个事件循环绑定一个 CPU ，否则与工作线程共用整个 CPU 集合 */
+    affinity_bind(loop->threadpool ? -1 : loop->id);
+
+    /* 连接对象在事件循环线程上分配，绑定 CPU 之后再创建对象池，首次使用时内存来自本地节点 */
+    if (loop->config->conn_pool > 0 &&
+        pool_init_local(loop->config->event_backend == BACKEND_URING ? sizeof(http_uring_conn_t) : sizeof(http_request_t),
+                        loop->config->conn_pool, loop->config->conn_pool_hugepage) != 0) {
+        log_warn("connection pool of event loop %d is not available, falls back to malloc.", loop->id);
+    }
+
+    /* 读缓冲区与协程栈由本线程分配时归还到本线程的缓存，不经过各线程共用的锁 */
+    if (http_buffer_init_local() != 0 || coroutine_init_local() != 0) {
+        log_warn("buffer caches of event loop %d are not available, falls back to the shared caches.", loop->id);
+    }
+
+    /* io_uring 后端只在多事件循环模式下使用，内核不支持或运行中出错时退回 epoll */
+    if (loop->config->event_backend == BACKEND_URING && loop->threadpool == NULL) {
+        event_loop_run_uring(loop);
+
+        log_warn("io_uring is not available, event loop %d falls back to epoll.", loop->id);
+
+        /* 监听描述符是边缘触发的， io_uring 退出前已到达的连接不会再触发事件 */
+        event_loop_accept(loop);
+    }
+
+    log_info("event loop %d goes to work.", loop->id);
+
+    for ( ;; ) {
+        timeout = find_timer();
+
+        /* 有推迟分发的连接时需要尽快重试 */
+        if (loop->deferred_num > 0 && timeout > DEFER_RETRY) {
+            timeout = DEFER_RETRY;
+        }
+
+        /* 根据超时时间最接近的事件确定 epoll wait 的阻塞时间 */
+        if ((evnum = epoll_wait_event(loop->epoll, MAX_EVENTS, timeout)) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            log_error("epoll wait failed.");
+            break;
+        }
+
+        /* 每轮只读一次时钟，本轮的定时器与响应头部都使用缓存的时间 */
+        update_times();
+
+        /* 此时一定有超时事件，需要执行回调函数 */
+        expire_timers();
+        event_loop_report_pool(loop);
+        event_loop_report_files(loop);
+
+        if (loop->threadpool) {
+            /* 先重试之前推迟的连接，保持先来先服务 */
+            event_loop_redispatch(loop);
+            event_loop_report(loop);
+        }
+
+        while (evnum -- ) {
+            event = (http_request_t*)(loop->epoll->events[evnum].data.ptr);
+            events = loop->epoll->events[evnum].events;
+
+            if (event->fd == loop->listenfd) {
+                event_loop_accept(loop);
+                continue;
+            }
+
+            /* 等待发送响应的连接监听的是可写事件 */
+            if ((events & EPOLLERR) || (events & EPOLLHUP) || /* 对端关闭连接 */
+                !(events & (EPOLLIN | EPOLLOUT))) {
+
+                if (event->timer.timer_set) {
+                    delete_timer((void*)event);
+                }
+                http_close_connection((void*)event);
+                continue;
+            }
+
+            if (loop->threadpool == NULL) {
+                /* 多事件循环模式，请求直接在本线程执行 */
+                execute_request((void*)event);
+                continue;
+            }
+
+            event_loop_dispatch(loop, event);
+        }
+    }
+
+    return NULL;
+}
+
+/*
+ * 销毁事件循环。
+ */
+int event_loop_destroy(event_loop_t* loop) {
+    if (loop == NULL) {
+        return -1;
+    }
+
+    if (loop->listen_event) {
+        http_request_destroy((http_request_t*)loop->listen_event);
+        loop->listen_event = NULL;
+    }
+
+    if (loop->listenfd >= 0) {
+        close(loop->listenfd);
+        loop->listenfd = -1;
+    }
+
+    if (loop->deferred) {
+        free(loop->deferred);
+        loop->deferred = NULL;
+    }
+
+    if (loop->epoll) {
+        close(loop->epoll->epollfd);
+        epoll_free(loop->epoll);
+        loop->epoll = NULL;
+    }
+
+    free(loop);
+
+    return 0;
+}
+
+/*
+ * 以 io_uring 为后端运行事件循环： multishot accept 接受连接， multishot recv 接收数据，
+ * 响应通过链式的 sendmsg 与 splice 发送，每轮循环只需一次 io_uring_enter 。
+ * io_uring 必须在运行它的线程中创建。只在创建失败或运行中出错时返回 -1 ，由调用者退回 epoll 。
+ * 出错时仍由 io_uring 管理的连接随 io_uring 一起放弃，之后的连接由 epoll 接受。
+ */
+static int event_loop_run_uring(event_loop_t* loop) {
+    uring_t* uring;
+    io_uring_cqe* cqe;
+    msec_t timeout;
+    int ret;
+
+    if ((uring = uring_create()) == NULL) {
+        return -1;
+    }
+
+    if (http_uring_listen(uring, (http_request_t*)loop->listen_event) != 0) {
+        uring_free(uring);
+        return -1;
+    }
+
+    log_info("event loop %d goes to work with io_uring.", loop->id);
+
+    for ( ;; ) {
+        timeout = find_timer();
+
+        /* 提交上一轮产生的所有操作，并等待完成事件或最近的定时器超时。
+         * 内核暂时无法接收时照常处理已有的完成事件，腾出空间后下一轮重试 */
+        if ((ret = uring_submit_and_wait(uring, timeout)) < 0 && ret != URING_AGAIN) {
+            log_error("io_uring of event loop %d failed.", loop->id);
+            break;
+        }
+
+        update_times();
+        expire_timers();
+        event_loop_report_pool(loop);
+        event_loop_report_files(loop);
+
+        while ((cqe = uring_peek_cqe(uring)) != NULL) {
+            http_uring_handle(uring, cqe, loop->config);
+            uring_cqe_seen(uring);
+        }
+    }
+
+    uring_free(uring);
+
+    return -1;
+}
+
+/*
+ * 接受监听描述符上的所有连接请求。
+ */
+static void event_loop_accept(event_loop_t* loop) {
+    struct sockaddr_in cliaddr;
+    socklen_t cliadrlen;
+    char addr[INET_ADDRSTRLEN];
+    int connfd;
+
+    /* 边缘触发，所以必须处理完所有的连接请求 */
+    for ( ;; ) {
+        cliadrlen = sizeof(cliaddr);    /* 必须初始化 */
+
+        if ((connfd = accept(loop->listenfd, (struct sockaddr*)&cliaddr, &cliadrlen)) < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                log_error("accept error.");
+            }
+
+            break;
+        }
+
+        log_info("new connection arrive. client<%s:%u>",
+                inet_ntop(AF_INET, &cliaddr.sin_addr, addr, sizeof(addr)), ntohs(cliaddr.sin_port));
+
+        /* 初始化已连接描述符，加入定时器、epoll 监听可读事件 */
+        http_init_connection(connfd, loop->epoll, loop->config);
+    }
+}
+
+/*
+ * 将就绪的连接交给线程池执行，同一连接的请求优先交给同一线程。
+ * 分发永远不阻塞：任务队列已满时推迟该连接，推迟的连接过多时直接拒绝。
+ */
+static void event_loop_dispatch(event_loop_t* loop, http_request_t* event) {
+    deferred_event_t* deferred;
+
+    /* 交给工作线程之前移出时间轮，工作线程执行期间本线程不会再让它超时，它重新定时时也不会碰到槽中的节点。
+     * 推迟期间连接同样不在定时器中，由推迟超时负责 */
+    detach_timer((void*)event);
+
+    if (threadpool_try_add_task_affinity(loop->threadpool, execute_request, (void*)event, event->fd) == 0) {
+        return;
+    }
+
+    if (loop->deferred_num == DEFER_MAX) {
+        loop->shed_total ++ ;
+        http_shed_request((void*)event);
+        return;
+    }
+
+    deferred = &(loop->deferred[loop->deferred_num ++ ]);
+    deferred->event = (void*)event;
+    deferred->since = current_msec();
+
+    loop->defer_total ++ ;
+}
+
+/*
+ * 重试推迟分发的连接，推迟时间超过 shed_target 的连接直接拒绝。
+ */
+static void event_loop_redispatch(event_loop_t* loop) {
+    deferred_event_t* deferred;
+    http_request_t* event;
+    unsigned long now;
+    int i;
+    int n;
+
+    if (loop->deferred_num == 0) {
+        return;
+    }
+
+    now = current_msec();
+
+    for (i = 0, n = 0; i < loop->deferred_num; ++ i) {
+        deferred = &(loop->deferred[i]);
+        event = (http_request_t*)deferred->event;
+
+        if (threadpool_try_add_task_affinity(loop->threadpool, execute_request, (void*)event, event->fd) == 0) {
+            continue;
+        }
+
+        if (loop->config->shed_target > 0 && now - deferred->since > loop->config->shed_target) {
+            loop->shed_total ++ ;
+            http_shed_request((void*)event);
+            continue;
+        }
+
+        loop->deferred[n ++ ] = *deferred;
+    }
+
+    loop->deferred_num = n;
+}
+
+/*
+ * 过载统计有变化时输出，间隔不小于 STATS_INTERVAL 。
+ */
+static void event_loop_report(event_loop_t* loop) {
+    unsigned long now;
+    unsigned long shed_num;
+    unsigned long full_num;
+    unsigned long sum;
+    int current;
+    int min;
+    int max;
+
+    now = current_msec();
+
+    if (now - loop->stats_msec < STATS_INTERVAL) {
+        return;
+    }
+
+    loop->stats_msec = now;
+
+    threadpool_get_stats(loop->threadpool, &shed_num, &full_num);
+    threadpool_get_threads(loop->threadpool, &current, &min, &max);
+
+    sum = shed_num + full_num + loop->defer_total + loop->shed_total;
+    if (sum == loop->stats_sum) {
+        return;
+    }
+
+    loop->stats_sum = sum;
+
+    log_warn("overload: shed by codel %lu, shed by loop %lu, deferred %lu (pending %d), queue full %lu, "
+             "threads %d (min %d, max %d).",
+             shed_num, loop->shed_total, loop->defer_total, loop->deferred_num, full_num, current, min, max);
+}
+
+/*
+ * 连接对象池用完、开始退回 malloc 时输出统计，间隔不小于 STATS_INTERVAL 。
+ */
+static void event_loop_report_pool(event_loop_t* loop) {
+    unsigned long now;
+    unsigned long hit;
+    unsigned long miss;
+    unsigned long used;
+
+    now = current_msec();
+
+    if (now - loop->pool_msec < STATS_INTERVAL) {
+        return;
+    }
+
+    loop->pool_msec = now;
+
+    pool_get_stats(&hit, &miss, &used);
+    if (miss == loop->pool_miss) {
+        return;
+    }
+
+    loop->pool_miss = miss;
+
+    log_warn("connection pool of event loop %d: hit %lu, miss %lu, in use %lu of %lu.",
+             loop->id, hit, miss, used, loop->config->conn_pool);
+}
+
+/*
+ * 有请求等待其他请求打开同一文件时输出统计，间隔不小于 STATS_INTERVAL 。统计是全局的，只由 0 号事件循环输出。
+ */
+static void event_loop_report_files(event_loop_t* loop) {
+    unsigned long now;
+    unsigned long load_num;
+    unsigned long coalesced_num;
+
+    if (loop->id != 0) {
+        return;
+    }
+
+    now = current_msec();
+
+    if (now - loop->files_msec < STATS_INTERVAL) {
+        return;
+    }
+
+    loop->files_msec = now;
+
+    http_file_cache_get_stats(&load_num, &coalesced_num);
+    if (coalesced_num == loop->files_coalesced) {
+        return;
+    }
+
+    log_info("file loads: opened %lu, coalesced %lu (+%lu).",
+             load_num, coalesced_num, coalesced_num - loop->files_coalesced);
+
+    loop->files_coalesced = coalesced_num;
+}
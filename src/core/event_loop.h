@@ -0,0 +1,71 @@
+/**
+ * @author ttoobne
+ * @date 2026/10/17
+ */
+
+#ifndef _EVENT_LOOP_H_
+#define _EVENT_LOOP_H_
+
+#include "config.h"
+#include "epoll.h"
+#include "threadpool.h"
+
+#include <pthread.h>
+
+#define DEFER_MAX       MAX_EVENTS      /* 每个事件循环最多推迟分发的连接数 */
+#define DEFER_RETRY     1               /* 有推迟的连接时 epoll 的最长阻塞时间（毫秒） */
+#define STATS_INTERVAL  1000            /* 输出过载统计的最短间隔（毫秒） */
+
+/*
+ * 任务队列已满时被推迟分发的连接。
+ */
+typedef struct {
+    void*           event;          /* 连接对应的 http_request_t */
+    unsigned long   since;          /* 开始推迟的时间 */
+} deferred_event_t;
+
+/*
+ * 事件循环类型。
+ * 单事件循环模式下只有一个事件循环，就绪的请求交给线程池执行；
+ * 多事件循环模式（reactors > 0）下每个事件循环独占一个线程、一个 epoll 和一个 SO_REUSEPORT 监听描述符，
+ * 请求直接在事件循环所在线程上执行，不再经过中心分发。
+ */
+typedef struct {
+    int                 id;             /* 事件循环编号 */
+    epoll_t*            epoll;          /* 事件循环独占的 epoll */
+    int                 listenfd;       /* 事件循环独占的监听描述符 */
+    void*               listen_event;   /* 监听描述符对应的 http_request_t */
+    threadpool_t*       threadpool;     /* 执行请求的线程池，为 NULL 时在事件循环线程上直接执行 */
+    config_t*           config;         /* 配置 */
+    pthread_t           tid;            /* 事件循环所在线程 */
+
+    deferred_event_t*   deferred;       /* 任务队列已满时推迟分发的连接，分发永远不阻塞事件循环 */
+    int                 deferred_num;   /* 推迟分发的连接数 */
+    unsigned long       defer_total;    /* 累计推迟分发的次数 */
+    unsigned long       shed_total;     /* 因推迟过久或推迟的连接过多而拒绝的连接数 */
+    unsigned long       stats_msec;     /* 上次输出过载统计的时间 */
+    unsigned long       stats_sum;      /* 上次输出时各项统计之和，没有变化则不输出 */
+    unsigned long       pool_msec;      /* 上次输出连接对象池统计的时间 */
+    unsigned long       pool_miss;      /* 上次输出时连接对象池的未命中次数，没有增加则不输出 */
+    unsigned long       files_msec;     /* 上次输出打开文件统计的时间 */
+    unsigned long       files_coalesced;/* 上次输出时合并的打开次数，没有增加则不输出 */
+} event_loop_t;
+
+/*
+ * 创建事件循环，包括 epoll 与监听描述符。
+ * threadpool 为 NULL 时请求在事件循环线程上执行，reuseport 非 0 时监听描述符设置 SO_REUSEPORT 。
+ * 创建成功则返回 event_loop_t 类型指针，失败则返回 NULL 。
+ */
+event_loop_t* event_loop_create(int id, config_t* config, threadpool_t* threadpool, int reuseport);
+
+/*
+ * 运行事件循环，可直接作为线程函数使用，出错时返回。
+ */
+void* event_loop_run(void* event_loop);
+
+/*
+ * 销毁事件循环。
+ */
+int event_loop_destroy(event_loop_t* loop);
+
+#endif /* _EVENT_LOOP_H_ */
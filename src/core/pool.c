@@ -0,0 +1,300 @@
+/**
+ * @author ttoobne
+ * @date 2026/10/17
+ */
+
+#include "pool.h"
+
+#include "log.h"
+
+#include <stdlib.h>
+#include <sys/mman.h>
+
+/* 每个对象前的头部，对象池中的对象与退回 malloc 的对象都有 */
+typedef struct pool_obj_s {
+    pool_t*             pool;           /* 所属的对象池， NULL 表示由 malloc 分配 */
+    struct pool_obj_s*  next;           /* 空闲链表中的下一个对象 */
+} pool_obj_t;
+
+struct pool_s {
+    char*               end;            /* 最后一个完整对象的结束地址 */
+    char*               fresh;          /* 尚未使用过的内存的起始地址 */
+    size_t              size;           /* 对象的最大大小 */
+    size_t              stride;         /* 相邻对象的间隔，按缓存行取整，相邻对象不共享缓存行 */
+    pool_obj_t*         free_list;      /* 本地空闲链表，只有所属线程访问 */
+    unsigned long       hit;            /* 从池中分配的次数 */
+    unsigned long       miss;           /* 退回 malloc 的次数 */
+    unsigned long       local_freed;    /* 所属线程释放的池中对象数 */
+
+    /* 其他线程写入的部分放在单独的缓存行 */
+    pool_obj_t*         remote_list __attribute__((aligned(POOL_ALIGN)));  /* 其他线程释放的对象 */
+    unsigned long       remote_freed;   /* 其他线程释放的池中对象数 */
+};
+
+struct pool_cache_s {
+    pool_node_t*        free_list;      /* 本地空闲链表，只有所属线程访问 */
+    unsigned long       num;            /* 本地空闲链表中的对象数 */
+    unsigned long       max;            /* 本地空闲链表最多保留的对象数 */
+
+    /* 其他线程写入的部分放在单独的缓存行 */
+    pool_node_t*        remote_list __attribute__((aligned(POOL_ALIGN)));  /* 其他线程归还的对象 */
+};
+
+static __thread pool_t* local_pool;     /* 当前线程的对象池 */
+
+static void* pool_map(size_t size, int hugepage);
+
+/*
+ * 为当前线程创建对象池，最多容纳 max 个不大于 size 字节的对象。
+ * 内存一次映射，页面在首次使用时才实际分配； hugepage 非 0 时优先使用大页。
+ * 成功返回 0 ，失败返回 -1 ，失败时当前线程的分配全部退回 malloc 。
+ */
+int pool_init_local(size_t size, unsigned long max, int hugepage) {
+    pool_t* pool;
+    size_t stride;
+    char* map;
+
+    if (local_pool) {
+        return 0;
+    }
+
+    stride = (sizeof(pool_obj_t) + size + POOL_ALIGN - 1) & ~(size_t)(POOL_ALIGN - 1);
+    if (max == 0 || stride * max / max != stride) {
+        log_error("pool size is invalid.");
+        return -1;
+    }
+
+    if ((pool = (pool_t*)aligned_alloc(POOL_ALIGN, sizeof(pool_t))) == NULL) {
+        log_error("pool_t malloc failed.");
+        return -1;
+    }
+
+    if ((map = (char*)pool_map(stride * max, hugepage)) == NULL) {
+        free(pool);
+        return -1;
+    }
+
+    pool->end = map + stride * max;
+    pool->fresh = map;
+    pool->size = size;
+    pool->stride = stride;
+    pool->free_list = NULL;
+    pool->hit = 0;
+    pool->miss = 0;
+    pool->local_freed = 0;
+    pool->remote_list = NULL;
+    pool->remote_freed = 0;
+
+    local_pool = pool;
+
+    return 0;
+}
+
+/*
+ * 分配 size 字节的对象，优先从当前线程的对象池中分配。失败返回 NULL 。
+ */
+void* pool_alloc(size_t size) {
+    pool_t* pool;
+    pool_obj_t* obj;
+
+    pool = local_pool;
+
+    if (pool && size <= pool->size) {
+        /* 本地空闲链表为空时一次取走其他线程释放的全部对象，只有所属线程会取，不存在 ABA 问题 */
+        if ((obj = pool->free_list) == NULL && __atomic_load_n(&(pool->remote_list), __ATOMIC_RELAXED)) {
+            obj = __atomic_exchange_n(&(pool->remote_list), NULL, __ATOMIC_ACQUIRE);
+        }
+
+        if (obj) {
+            pool->free_list = obj->next;
+        } else if (pool->fresh < pool->end) {
+            obj = (pool_obj_t*)pool->fresh;
+            obj->pool = pool;
+            pool->fresh += pool->stride;
+        }
+
+        if (obj) {
+            pool->hit ++ ;
+            return (void*)(obj + 1);
+        }
+    }
+
+    if (pool) {
+        pool->miss ++ ;
+    }
+
+    if ((obj = (pool_obj_t*)malloc(sizeof(pool_obj_t) + size)) == NULL) {
+        return NULL;
+    }
+
+    obj->pool = NULL;
+
+    return (void*)(obj + 1);
+}
+
+/*
+ * 释放 pool_alloc 分配的对象，可以在任意线程调用。
+ */
+void pool_free(void* ptr) {
+    pool_t* pool;
+    pool_obj_t* obj;
+    pool_obj_t* head;
+
+    if (ptr == NULL) {
+        return;
+    }
+
+    obj = (pool_obj_t*)ptr - 1;
+    pool = obj->pool;
+
+    if (pool == NULL) {
+        free(obj);
+        return;
+    }
+
+    if (pool == local_pool) {
+        obj->next = pool->free_list;
+        pool->free_list = obj;
+        pool->local_freed ++ ;
+        return;
+    }
+
+    /* 其他线程释放，压入所属线程的远程空闲链表 */
+    head = __atomic_load_n(&(pool->remote_list), __ATOMIC_RELAXED);
+
+    do {
+        obj->next = head;
+    } while (!__atomic_compare_exchange_n(&(pool->remote_list), &head, obj, 1, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+
+    __atomic_fetch_add(&(pool->remote_freed), 1, __ATOMIC_RELAXED);
+}
+
+/*
+ * 获取当前线程的对象池的统计：从池中分配的次数，退回 malloc 的次数，正在使用的池中对象数。
+ */
+void pool_get_stats(unsigned long* hit, unsigned long* miss, unsigned long* used) {
+    pool_t* pool;
+
+    if ((pool = local_pool) == NULL) {
+        *hit = *miss = *used = 0;
+        return;
+    }
+
+    *hit = pool->hit;
+    *miss = pool->miss;
+    *used = pool->hit - pool->local_freed - __atomic_load_n(&(pool->remote_freed), __ATOMIC_RELAXED);
+}
+
+/*
+ * 创建当前线程的缓存，本地空闲链表最多保留 max 个对象。失败返回 NULL 。
+ */
+pool_cache_t* pool_cache_create(unsigned long max) {
+    pool_cache_t* cache;
+
+    if ((cache = (pool_cache_t*)aligned_alloc(POOL_ALIGN, sizeof(pool_cache_t))) == NULL) {
+        log_error("pool_cache_t malloc failed.");
+        return NULL;
+    }
+
+    cache->free_list = NULL;
+    cache->num = 0;
+    cache->max = max;
+    cache->remote_list = NULL;
+
+    return cache;
+}
+
+/*
+ * 从当前线程的缓存 cache 中取出一个空闲对象，没有时返回 NULL 。只能由所属线程调用。
+ */
+pool_node_t* pool_cache_get(pool_cache_t* cache) {
+    pool_node_t* node;
+    pool_node_t* it;
+
+    if ((node = cache->free_list) != NULL) {
+        cache->free_list = node->next;
+        cache->num -- ;
+        return node;
+    }
+
+    /* 只有所属线程会取走远程空闲链表，不存在 ABA 问题 */
+    if (__atomic_load_n(&(cache->remote_list), __ATOMIC_RELAXED) == NULL) {
+        return NULL;
+    }
+
+    node = __atomic_exchange_n(&(cache->remote_list), NULL, __ATOMIC_ACQUIRE);
+
+    /* 其余对象转入本地空闲链表，远程归还的对象都由所属线程分配，数量不会超过所属线程同时使用的对象数 */
+    cache->free_list = node->next;
+
+    for (it = node->next; it; it = it->next) {
+        cache->num ++ ;
+    }
+
+    return node;
+}
+
+/*
+ * 将对象归还给分配它的线程的缓存， local 为当前线程的同类缓存，可以为 NULL 。可以在任意线程调用。
+ * 放入缓存返回 0 ；对象不属于任何线程，或所属线程的本地空闲链表已满时返回 -1 ，由调用者释放。
+ */
+int pool_cache_put(pool_cache_t* local, pool_node_t* node) {
+    pool_cache_t* cache;
+    pool_node_t* head;
+
+    if ((cache = node->cache) == NULL) {
+        return -1;
+    }
+
+    if (cache == local) {
+        if (cache->num >= cache->max) {
+            return -1;
+        }
+
+        node->next = cache->free_list;
+        cache->free_list = node;
+        cache->num ++ ;
+        return 0;
+    }
+
+    /* 其他线程归还，压入所属线程的远程空闲链表 */
+    head = __atomic_load_n(&(cache->remote_list), __ATOMIC_RELAXED);
+
+    do {
+        node->next = head;
+    } while (!__atomic_compare_exchange_n(&(cache->remote_list), &head, node, 1, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+
+    return 0;
+}
+
+/*
+ * 映射对象池的内存。优先使用预留的大页，没有预留时退回普通页并建议内核使用透明大页。失败返回 NULL 。
+ */
+static void* pool_map(size_t size, int hugepage) {
+    void* map;
+
+    if (hugepage) {
+        size = (size + POOL_HUGEPAGE - 1) & ~(size_t)(POOL_HUGEPAGE - 1);
+
+        /* 大页必须在映射时预留，否则首次访问时才因没有大页收到 SIGBUS */
+        map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+
+        if (map != MAP_FAILED) {
+            return map;
+        }
+
+        log_warn("no reserved huge pages for the pool, falls back to transparent huge pages.");
+    }
+
+    if ((map = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0)) == MAP_FAILED) {
+        log_error("pool mmap failed.");
+        return NULL;
+    }
+
+    if (hugepage) {
+        madvise(map, size, MADV_HUGEPAGE);
+    }
+
+    return map;
+}
@@ -0,0 +1,76 @@
+/**
+ * @author ttoobne
+ * @date 2026/10/17
+ */
+
+#ifndef _POOL_H_
+#define _POOL_H_
+
+#include <stddef.h>
+
+#define POOL_ALIGN      64              /* 对象按缓存行对齐 */
+#define POOL_HUGEPAGE   (2 * 1024 * 1024)
+
+/*
+ * 固定大小的对象池，每个事件循环线程一个。
+ * 对象从预先映射的一块连续内存中切分，释放后进入空闲链表循环使用，不经过 malloc 。
+ * 所属线程分配与释放时只操作本地空闲链表；其他线程（线程池中的工作线程）释放的对象以无锁方式压入远程空闲链表，
+ * 本地空闲链表为空时所属线程一次取走整个远程空闲链表。
+ * 对象池用完或对象大于池的对象大小时退回 malloc ，计为未命中。
+ */
+typedef struct pool_s pool_t;
+
+/*
+ * 为当前线程创建对象池，最多容纳 max 个不大于 size 字节的对象。
+ * 内存一次映射，页面在首次使用时才实际分配； hugepage 非 0 时优先使用大页。
+ * 成功返回 0 ，失败返回 -1 ，失败时当前线程的分配全部退回 malloc 。
+ */
+int pool_init_local(size_t size, unsigned long max, int hugepage);
+
+/*
+ * 分配 size 字节的对象，优先从当前线程的对象池中分配。失败返回 NULL 。
+ */
+void* pool_alloc(size_t size);
+
+/*
+ * 释放 pool_alloc 分配的对象，可以在任意线程调用。
+ */
+void pool_free(void* ptr);
+
+/*
+ * 获取当前线程的对象池的统计：从池中分配的次数，退回 malloc 的次数，正在使用的池中对象数。
+ */
+void pool_get_stats(unsigned long* hit, unsigned long* miss, unsigned long* used);
+
+/*
+ * 每线程的空闲对象缓存，用于不从对象池分配、但创建代价高的对象（读缓冲区、协程栈）。
+ * 与对象池相同，所属线程只操作本地空闲链表，其他线程归还的对象以无锁方式压入远程空闲链表，
+ * 本地空闲链表为空时所属线程一次取走整个远程空闲链表。
+ * 缓存只为不会退出的线程（事件循环线程）创建，对象引用的缓存因此始终有效。
+ */
+typedef struct pool_cache_s pool_cache_t;
+typedef struct pool_node_s pool_node_t;
+
+/* 嵌入在被缓存对象中的头部 */
+struct pool_node_s {
+    pool_cache_t*       cache;          /* 分配对象的线程的缓存， NULL 表示不属于任何线程 */
+    pool_node_t*        next;           /* 空闲链表中的下一个对象 */
+};
+
+/*
+ * 创建当前线程的缓存，本地空闲链表最多保留 max 个对象。失败返回 NULL 。
+ */
+pool_cache_t* pool_cache_create(unsigned long max);
+
+/*
+ * 从当前线程的缓存 cache 中取出一个空闲对象，没有时返回 NULL 。只能由所属线程调用。
+ */
+pool_node_t* pool_cache_get(pool_cache_t* cache);
+
+/*
+ * 将对象归还给分配它的线程的缓存， local 为当前线程的同类缓存，可以为 NULL 。可以在任意线程调用。
+ * 放入缓存返回 0 ；对象不属于任何线程，或所属线程的本地空闲链表已满时返回 -1 ，由调用者释放。
+ */
+int pool_cache_put(pool_cache_t* local, pool_node_t* node);
+
+#endif /* _POOL_H_ */
@@ -37,6 +37,7 @@ ssize_t rio_readn(int fd, void* usrbuf, size_t* n) {
 
 /*
  * 更健壮的不带缓冲的写，从 usrbuf 传送 n 字节到 fd 中。
+ * 非阻塞描述符写满时不再重试，返回 -1 且 errno 为 EAGAIN ，由调用者等待可写后继续。
  */
 ssize_t rio_writen(int fd, void* usrbuf, size_t n) {
     size_t nleft = n;       /* 剩余多少字节未写 */
@@ -45,7 +46,7 @@ ssize_t rio_writen(int fd, void* usrbuf, size_t n) {
 
     while (nleft > 0) {
         if ((nwrite = write(fd, bufp, nleft)) <= 0) {
-            if (errno != EINTR && errno != EAGAIN) {   /* 当 write 被中断则忽略，否则返回错误 */
+            if (errno != EINTR) {   /* 当 write 被中断则忽略，否则返回错误 */
                 return -1;
             }
         } else {
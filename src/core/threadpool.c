@@ -5,75 +5,165 @@
 
 #include "threadpool.h"
 
+#include "affinity.h"
 #include "log.h"
+#include "utility.h"
 
+#include <limits.h>
+#include <linux/futex.h>
 #include <stdlib.h>
-
-static void* threadpool_worker(void* threadpool);
+#include <string.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+static void* threadpool_worker(void* worker);
+static int threadpool_get_task(threadpool_worker_t* worker, threadpool_task_t* task);
+static int threadpool_steal_task(threadpool_worker_t* worker, threadpool_task_t* task);
+static int threadpool_push_task(threadpool_t* pool, task_function_t* func, void* args, int affinity);
+static int threadpool_should_shed(threadpool_t* pool, threadpool_task_t* task);
+static void threadpool_grow(threadpool_t* pool);
+static int threadpool_spawn(threadpool_t* pool);
+static int threadpool_retire(threadpool_worker_t* worker);
 static int threadpool_free(threadpool_t *threadpool);
+static int task_queue_init(task_queue_t* queue, size_t capacity);
+static void task_queue_free(task_queue_t* queue);
+static int task_queue_push(task_queue_t* queue, threadpool_task_t* task);
+static int task_queue_pop(task_queue_t* queue, threadpool_task_t* task);
+static int task_deque_init(task_deque_t* deque, size_t capacity);
+static void task_deque_free(task_deque_t* deque);
+static int task_deque_push(task_deque_t* deque, threadpool_task_t* task);
+static int task_deque_take(task_deque_t* deque, threadpool_task_t* task);
+static int task_deque_steal(task_deque_t* deque, threadpool_task_t* task);
+static unsigned ec_prepare_wait(eventcount_t* ec);
+static void ec_cancel_wait(eventcount_t* ec);
+static void ec_wait(eventcount_t* ec, unsigned key, unsigned long timeout);
+static void ec_notify(eventcount_t* ec, int all);
 
 /*
- * 创建线程池，线程池大小为 threadpool_size ，任务队列大小为 task_queue_size 。
+ * 创建线程池，线程池大小为 threadpool_size ，任务队列大小为 task_queue_size （向上取整为 2 的幂），
+ * 所有线程共享一个先进先出的任务队列。
  * 创建成功则返回相应线程池指针，否则返回 NULL 。
  */
 threadpool_t* threadpool_create(int threadpool_size, int task_queue_size) {
+    return threadpool_create_mode(threadpool_size, task_queue_size, THREADPOOL_FIFO);
+}
+
+/*
+ * 以指定的调度模式创建线程池， mode 为 THREADPOOL_FIFO 或 THREADPOOL_STEAL ，
+ * 工作窃取模式下每个线程各有一个 task_queue_size 大小的队列。其余参数与 threadpool_create 相同。
+ * 创建成功则返回相应线程池指针，否则返回 NULL 。
+ */
+threadpool_t* threadpool_create_mode(int threadpool_size, int task_queue_size, int mode) {
+    return threadpool_create_elastic(threadpool_size, threadpool_size, task_queue_size, mode, 0);
+}
+
+/*
+ * 创建弹性线程池，初始创建 min_threads 个线程，最多 max_threads 个线程。
+ * 任务排队时间持续超过扩容阈值时增加线程，超过 min_threads 的线程空闲一段时间后退出，阈值由 threadpool_set_scaling 设置。
+ * stack_size 为线程栈大小（字节）， 0 表示使用系统默认值。其余参数与 threadpool_create_mode 相同。
+ * 创建成功则返回相应线程池指针，否则返回 NULL 。
+ */
+threadpool_t* threadpool_create_elastic(int min_threads, int max_threads, int task_queue_size, int mode, size_t stack_size) {
 
     int i;
+    size_t capacity;
+    threadpool_worker_t* worker;
     threadpool_t* pool = NULL;
+    int threadpool_size = max_threads;
 
-    if (threadpool_size <= 0 || task_queue_size <= 0) {
+    if (min_threads <= 0 || max_threads < min_threads || task_queue_size <= 0 ||
+        (mode != THREADPOOL_FIFO && mode != THREADPOOL_STEAL)) {
         log_error("arguments invalid.");
         return NULL;
     }
 
+    /* 队列大小向上取整为 2 的幂，槽位下标用掩码计算 */
+    for (capacity = 2; capacity < (size_t)task_queue_size ||
+                       (mode == THREADPOOL_STEAL && capacity < STEAL_BATCH); capacity <<= 1);
+
     do {
-        if ((pool = (threadpool_t*)malloc(sizeof(threadpool_t))) == NULL) {
+        /* 队首与队尾按缓存行对齐，所以不能直接用 malloc */
+        if (posix_memalign((void**)&pool, CACHE_LINE_SIZE, sizeof(threadpool_t)) != 0) {
+            pool = NULL;
             log_error("malloc threadpool failed.");
             break;
         }
 
-        /* 初始化互斥锁和条件变量 */
-        if (pthread_mutex_init(&(pool->lock_mutex), NULL) != 0 ||
-            pthread_cond_init(&(pool->nfull_cond), NULL) != 0 ||
-            pthread_cond_init(&(pool->nempty_cond), NULL) != 0) {
-            log_error("mutex and condition initialize failed.");
+        memset(pool, 0, sizeof(threadpool_t));
+
+        pthread_mutex_init(&(pool->scale_lock), NULL);
+        pthread_attr_init(&(pool->thread_attr));
+
+        /* 栈大小不能小于 PTHREAD_STACK_MIN */
+        if (stack_size > 0 && pthread_attr_setstacksize(&(pool->thread_attr), stack_size < PTHREAD_STACK_MIN ?
+                                                        PTHREAD_STACK_MIN : stack_size) != 0) {
+            log_error("set thread stack size failed.");
             break;
         }
 
+        /* 初始化各个属性值 */
+        pool->mode = mode;
+        pool->min_threads = min_threads;
+        pool->threadpool_size = threadpool_size;
+        pool->thread_running = 0;
+        pool->grow_wait = GROW_WAIT_DEF;
+        pool->idle_timeout = IDLE_TIMEOUT_DEF;
+        pool->task_queue_size = capacity;
+        pool->next_worker = 0;
+        pool->shutdown = 0;
+
         if ((pool->threads = (pthread_t*)malloc
             (sizeof(pthread_t) * threadpool_size)) == NULL) {
             log_error("malloc threads failed.");
             break;
         }
 
-        if ((pool->task_queue = (threadpool_task_t*)malloc
-            (sizeof(threadpool_task_t) * task_queue_size)) == NULL) {
-            log_error("malloc task queue failed.");
+        if (posix_memalign((void**)&(pool->workers), CACHE_LINE_SIZE,
+                           sizeof(threadpool_worker_t) * threadpool_size) != 0) {
+            pool->workers = NULL;
+            log_error("malloc workers failed.");
             break;
         }
 
-        /* 初始化各个属性值 */
-        pool->threadpool_size = threadpool_size;
-        pool->thread_running = 0;
-        pool->task_queue_size = task_queue_size;
-        pool->task_queue_front = 0;
-        pool->task_queue_rear = 0;
-        pool->task_num = 0;
-        pool->shutdown = 0;
+        memset(pool->workers, 0, sizeof(threadpool_worker_t) * threadpool_size);
+
+        if (mode == THREADPOOL_FIFO && task_queue_init(&(pool->task_queue), capacity) != 0) {
+            log_error("malloc task queue failed.");
+            break;
+        }
 
-        /* 创建 threadpool_size 个线程 */
         for (i = 0; i < threadpool_size; ++ i) {
-            if (pthread_create(&(pool->threads[i]), NULL,
-                                threadpool_worker, (void*)pool) != 0) {
-                log_error("create threads failed.");
+            worker = &(pool->workers[i]);
+            worker->pool = pool;
+            worker->id = i;
+            worker->state = WORKER_NONE;
+            worker->steal_seed = i * 2654435761u + 1;
+
+            if (mode == THREADPOOL_STEAL && (task_queue_init(&(worker->inbox), capacity) != 0 ||
+                                             task_deque_init(&(worker->deque), capacity) != 0)) {
+                log_error("malloc worker queue failed.");
                 break;
             }
-            pool->thread_running ++ ;
         }
         if (i != threadpool_size) {
             break;
         }
 
+        /* 创建 min_threads 个线程 */
+        pthread_mutex_lock(&(pool->scale_lock));
+        for (i = 0; i < min_threads; ++ i) {
+            if (threadpool_spawn(pool) != 0) {
+                break;
+            }
+        }
+        pthread_mutex_unlock(&(pool->scale_lock));
+
+        if (i != min_threads) {
+            /* 让已经创建的线程退出后再释放 */
+            threadpool_destroy(pool);
+            return NULL;
+        }
+
         return pool;
 
     } while (0);
@@ -86,93 +176,479 @@ threadpool_t* threadpool_create(int threadpool_size, int task_queue_size) {
 /*
  * 线程池中的工作线程将执行此函数。
  */
-static void* threadpool_worker(void* threadpool) {
+static void* threadpool_worker(void* worker) {
 
-    threadpool_t* pool = (threadpool_t*)threadpool;
+    threadpool_worker_t* self = (threadpool_worker_t*)worker;
+    threadpool_t* pool = self->pool;
     threadpool_task_t task;
+    unsigned long idle_since;
+    unsigned long timeout;
+    unsigned long now;
+    unsigned key;
 
-    for ( ;; ) {
-        /* 获取互斥锁 */
-        pthread_mutex_lock(&(pool->lock_mutex));
+    /* 绑定 CPU 与 NUMA 节点 */
+    affinity_bind(-1);
 
-        /* 当任务队列中任务数为空，工作线程阻塞在 nempty_cond 上 */
-        while ((pool->task_num == 0) && (!pool->shutdown)) {
-            pthread_cond_wait(&(pool->nempty_cond), &(pool->lock_mutex));
-        }
-        
+    idle_since = monotonic_msec();
+
+    for ( ;; ) {
         /* 若线程池关闭，则线程终止 */
-        if (pool->shutdown) {
+        if (__atomic_load_n(&(pool->shutdown), __ATOMIC_ACQUIRE)) {
             break;
         }
 
-        /* 从任务队列首部取任务 */
-        task.func = pool->task_queue[pool->task_queue_front].func;
-        task.args = pool->task_queue[pool->task_queue_front].args;
-        
-        /* 循环队列 */
-        pool->task_queue_front = (pool->task_queue_front + 1) % pool->task_queue_size;
-        pool->task_num -- ;
+        /* 取任务 */
+        if (threadpool_get_task(self, &task) != 0) {
+            /* 没有任务，先登记为等待者再检查一次，避免丢失唤醒 */
+            key = ec_prepare_wait(&(pool->nempty_ec));
+
+            if (threadpool_get_task(self, &task) != 0) {
+                if (__atomic_load_n(&(pool->shutdown), __ATOMIC_ACQUIRE)) {
+                    ec_cancel_wait(&(pool->nempty_ec));
+                    break;
+                }
+
+                /* 超过最小线程数的线程空闲过久则退出，其余线程一直挂起 */
+                timeout = 0;
+                if (self->id >= pool->min_threads) {
+                    now = monotonic_msec();
+
+                    if (now - idle_since >= pool->idle_timeout) {
+                        ec_cancel_wait(&(pool->nempty_ec));
+
+                        if (threadpool_retire(self) == 0) {
+                            return NULL;
+                        }
+
+                        /* 不是编号最大的线程，继续等待 */
+                        idle_since = now;
+                        continue;
+                    }
+
+                    timeout = pool->idle_timeout - (now - idle_since);
+                }
+
+                /* 挂起在 nempty_ec 上，直到有新的任务 */
+                ec_wait(&(pool->nempty_ec), key, timeout);
+                continue;
+            }
+
+            ec_cancel_wait(&(pool->nempty_ec));
+        }
+
+        /* 取完任务则通知阻塞在任务队列已满上的生产者 */
+        ec_notify(&(pool->nfull_ec), 0);
 
-        /* 取完任务则广播任务队列未满条件 */
-        pthread_cond_broadcast(&(pool->nfull_cond));
-        /* 解开互斥锁 */
-        pthread_mutex_unlock(&(pool->lock_mutex));
+        /* 排队时间超过扩容阈值说明现有线程处理不过来 */
+        if (pool->min_threads < pool->threadpool_size &&
+            monotonic_msec() - task.enqueue_msec > pool->grow_wait) {
+            threadpool_grow(pool);
+        }
+
+        /* 过载时排队过久的任务直接拒绝 */
+        if (threadpool_should_shed(pool, &task)) {
+            __atomic_add_fetch(&(pool->shed_num), 1, __ATOMIC_RELAXED);
+            (*(pool->shed_func))(task.args);
+            continue;
+        }
 
         /* 执行任务 */
         (*(task.func))(task.args);
-    }
 
-    /* 终止线程 */
-    pool->thread_running -- ;
-    pthread_mutex_unlock(&(pool->lock_mutex));
-    pthread_exit(NULL);
+        if (self->id >= pool->min_threads) {
+            idle_since = monotonic_msec();
+        }
+    }
 
     return NULL;
 }
 
+/*
+ * 为工作线程取一个任务。
+ * FIFO 模式下从共享队列首部取；工作窃取模式下依次尝试本地 deque 、自己的 inbox 、其他线程。
+ * 成功返回 0 ，没有任务返回 -1 。
+ */
+static int threadpool_get_task(threadpool_worker_t* worker, threadpool_task_t* task) {
+    threadpool_task_t batch[STEAL_BATCH];
+    int n;
+
+    if (worker->pool->mode == THREADPOOL_FIFO) {
+        return task_queue_pop(&(worker->pool->task_queue), task);
+    }
+
+    if (task_deque_take(&(worker->deque), task) == 0) {
+        return 0;
+    }
+
+    /* 从 inbox 批量转移任务，返回最早的一个，其余按逆序压入 deque ，使 bottom 端弹出的顺序与投递顺序一致 */
+    for (n = 0; n < STEAL_BATCH; ++ n) {
+        if (task_queue_pop(&(worker->inbox), &batch[n]) != 0) {
+            break;
+        }
+    }
+
+    if (n > 0) {
+        *task = batch[0];
+
+        if (n == 1) {
+            return 0;
+        }
+
+        /* 只有 deque 为空时才会转移，且其容量不小于 STEAL_BATCH ，所以压入不会失败 */
+        while (-- n > 0) {
+            task_deque_push(&(worker->deque), &batch[n]);
+        }
+
+        /* 转移到 deque 的任务可以被窃取，唤醒空闲线程 */
+        ec_notify(&(worker->pool->nempty_ec), 0);
+
+        return 0;
+    }
+
+    return threadpool_steal_task(worker, task);
+}
+
+/*
+ * 从其他线程窃取一个任务，从随机位置开始遍历，先窃取 deque 再窃取 inbox 。
+ * 成功返回 0 ，没有任务返回 -1 。
+ */
+static int threadpool_steal_task(threadpool_worker_t* worker, threadpool_task_t* task) {
+    threadpool_t* pool;
+    threadpool_worker_t* victim;
+    int start;
+    int i;
+
+    pool = worker->pool;
+
+    worker->steal_seed = worker->steal_seed * 1103515245 + 12345;
+    start = (worker->steal_seed >> 16) % pool->threadpool_size;
+
+    for (i = 0; i < pool->threadpool_size; ++ i) {
+        victim = &(pool->workers[(start + i) % pool->threadpool_size]);
+
+        if (victim == worker) {
+            continue;
+        }
+
+        if (task_deque_steal(&(victim->deque), task) == 0 ||
+            task_queue_pop(&(victim->inbox), task) == 0) {
+            return 0;
+        }
+    }
+
+    return -1;
+}
+
 /*
  * 向线程池中添加任务。
  * 添加成功返回 0 ，否则返回 -1 。
  */
 int threadpool_add_task(threadpool_t* threadpool, task_function_t* func, void* args) {
+    return threadpool_add_task_affinity(threadpool, func, args, -1);
+}
+
+/*
+ * 向线程池中添加任务，工作窃取模式下优先投递给第 affinity % threadpool_size 个线程，
+ * 同一连接使用相同的 affinity 可以让其请求尽量在同一线程上执行。 affinity 小于 0 时轮流投递。
+ * 添加成功返回 0 ，否则返回 -1 。
+ */
+int threadpool_add_task_affinity(threadpool_t* threadpool, task_function_t* func, void* args, int affinity) {
+    unsigned key;
+
     if (threadpool == NULL || func == NULL) {
         log_error("arguments invalid.");
         return -1;
     }
 
-    /* 加锁 */
-    pthread_mutex_lock(&(threadpool->lock_mutex));
+    for ( ;; ) {
+        /* 如果线程池已经关闭 */
+        if (__atomic_load_n(&(threadpool->shutdown), __ATOMIC_ACQUIRE)) {
+            log_error("threadpool already shutdown.");
+            return -1;
+        }
+
+        /* 添加任务到任务队列尾部 */
+        if (threadpool_push_task(threadpool, func, args, affinity) == 0) {
+            break;
+        }
+
+        /* 如果任务队列中任务已满，则挂起在 nfull_ec 上 */
+        key = ec_prepare_wait(&(threadpool->nfull_ec));
+
+        if (threadpool_push_task(threadpool, func, args, affinity) == 0) {
+            ec_cancel_wait(&(threadpool->nfull_ec));
+            break;
+        }
+
+        if (__atomic_load_n(&(threadpool->shutdown), __ATOMIC_ACQUIRE)) {
+            ec_cancel_wait(&(threadpool->nfull_ec));
+            continue;
+        }
+
+        threadpool_grow(threadpool);
+
+        ec_wait(&(threadpool->nfull_ec), key, 0);
+    }
+
+    /* 通知一个挂起在 nempty_ec 上的线程 */
+    ec_notify(&(threadpool->nempty_ec), 0);
+
+    return 0;
+}
+
+/*
+ * 尝试向线程池中添加任务，队列已满时不阻塞。
+ * 添加成功返回 0 ，队列已满或线程池已关闭返回 -1 。
+ */
+int threadpool_try_add_task_affinity(threadpool_t* threadpool, task_function_t* func, void* args, int affinity) {
+    if (threadpool == NULL || func == NULL) {
+        log_error("arguments invalid.");
+        return -1;
+    }
 
-    /* 如果任务队列中任务已满，则阻塞在条件 nfull_cond 上 */
-    while ((threadpool->task_num == threadpool->task_queue_size) && (!threadpool->shutdown)) {
-        pthread_cond_wait(&(threadpool->nfull_cond), &(threadpool->lock_mutex));
+    if (__atomic_load_n(&(threadpool->shutdown), __ATOMIC_ACQUIRE)) {
+        return -1;
     }
 
-    /* 如果线程池已经关闭 */
-    if (threadpool->shutdown) {
-        pthread_mutex_unlock(&(threadpool->lock_mutex));
-        log_error("threadpool already shutdown.");
+    if (threadpool_push_task(threadpool, func, args, affinity) != 0) {
+        __atomic_add_fetch(&(threadpool->full_num), 1, __ATOMIC_RELAXED);
+        threadpool_grow(threadpool);
         return -1;
     }
 
-    /* 添加任务到任务队列尾部 */
-    threadpool->task_queue[threadpool->task_queue_rear].func = func;
-    threadpool->task_queue[threadpool->task_queue_rear].args = args;
-    threadpool->task_queue_rear = (threadpool->task_queue_rear + 1) % threadpool->task_queue_size;
-    threadpool->task_num ++ ;
+    /* 通知一个挂起在 nempty_ec 上的线程 */
+    ec_notify(&(threadpool->nempty_ec), 0);
+
+    return 0;
+}
+
+/*
+ * 设置 CoDel 过载控制。
+ * 某个长度为 interval 毫秒的观察区间内最小排队时间超过 target 毫秒时线程池进入过载状态，
+ * 过载状态下排队时间超过 2 * target 的任务不再执行 func ，而是执行 shed(args) 。 target 为 0 时关闭。
+ */
+void threadpool_set_shedding(threadpool_t* threadpool, unsigned long target, unsigned long interval, task_function_t* shed) {
+    if (threadpool == NULL) {
+        return;
+    }
+
+    threadpool->codel_interval = interval > 0 ? interval : 100;
+    threadpool->codel_interval_end = monotonic_msec() + threadpool->codel_interval;
+    threadpool->codel_min_delay = (unsigned long)-1;
+    threadpool->codel_overloaded = 0;
+    threadpool->shed_func = shed;
+    threadpool->codel_target = shed != NULL ? target : 0;
+}
+
+/*
+ * 获取被拒绝的任务数与因队列已满而添加失败的次数。
+ */
+void threadpool_get_stats(threadpool_t* threadpool, unsigned long* shed_num, unsigned long* full_num) {
+    if (shed_num) {
+        *shed_num = __atomic_load_n(&(threadpool->shed_num), __ATOMIC_RELAXED);
+    }
+
+    if (full_num) {
+        *full_num = __atomic_load_n(&(threadpool->full_num), __ATOMIC_RELAXED);
+    }
+}
+
+/*
+ * 设置弹性伸缩的阈值：任务排队超过 grow_wait 毫秒时增加线程，多出的线程空闲 idle_timeout 毫秒后退出。
+ */
+void threadpool_set_scaling(threadpool_t* threadpool, unsigned long grow_wait, unsigned long idle_timeout) {
+    if (threadpool == NULL) {
+        return;
+    }
+
+    threadpool->grow_wait = grow_wait;
+    threadpool->idle_timeout = idle_timeout > 0 ? idle_timeout : IDLE_TIMEOUT_DEF;
+}
+
+/*
+ * 获取当前线程数、最小线程数与最大线程数。
+ */
+void threadpool_get_threads(threadpool_t* threadpool, int* current, int* min, int* max) {
+    if (current) {
+        *current = __atomic_load_n(&(threadpool->thread_running), __ATOMIC_RELAXED);
+    }
+
+    if (min) {
+        *min = threadpool->min_threads;
+    }
+
+    if (max) {
+        *max = threadpool->threadpool_size;
+    }
+}
+
+/*
+ * 增加一个线程，每个 grow_wait 时间段内最多增加一个，已达最大线程数时什么也不做。
+ * 可能在工作线程或事件循环中调用，所以只尝试加锁，不会阻塞。
+ */
+static void threadpool_grow(threadpool_t* pool) {
+    unsigned long now;
+    unsigned long last;
+
+    if (__atomic_load_n(&(pool->thread_running), __ATOMIC_RELAXED) >= pool->threadpool_size) {
+        return;
+    }
+
+    now = monotonic_msec();
+    last = __atomic_load_n(&(pool->grow_msec), __ATOMIC_RELAXED);
+
+    if (now - last < pool->grow_wait ||
+        !__atomic_compare_exchange_n(&(pool->grow_msec), &last, now, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+        return;
+    }
+
+    if (pthread_mutex_trylock(&(pool->scale_lock)) != 0) {
+        return;
+    }
+
+    if (!__atomic_load_n(&(pool->shutdown), __ATOMIC_ACQUIRE) && threadpool_spawn(pool) == 0) {
+        log_info("threadpool grows to %d threads.", pool->thread_running);
+    }
+
+    pthread_mutex_unlock(&(pool->scale_lock));
+}
+
+/*
+ * 在第 thread_running 个槽位上创建线程，槽位上已退出的线程先回收。调用者需持有 scale_lock 。
+ * 成功返回 0 ，否则返回 -1 。
+ */
+static int threadpool_spawn(threadpool_t* pool) {
+    threadpool_worker_t* worker;
+    int i;
+
+    if ((i = pool->thread_running) >= pool->threadpool_size) {
+        return -1;
+    }
+
+    worker = &(pool->workers[i]);
+
+    if (worker->state == WORKER_EXITED) {
+        pthread_join(pool->threads[i], NULL);
+        worker->state = WORKER_NONE;
+    }
+
+    if (pthread_create(&(pool->threads[i]), &(pool->thread_attr), threadpool_worker, (void*)worker) != 0) {
+        log_error("create threads failed.");
+        return -1;
+    }
 
-    /* 通知一个阻塞在 nempty_cond 上的线程并解锁互斥锁 */
-    pthread_cond_signal(&(threadpool->nempty_cond));
-    pthread_mutex_unlock(&(threadpool->lock_mutex));
+    worker->state = WORKER_RUNNING;
+    __atomic_store_n(&(pool->thread_running), i + 1, __ATOMIC_RELEASE);
 
     return 0;
 }
 
+/*
+ * 空闲过久的线程尝试退出。为使运行中的线程始终占据连续的槽位，只有编号最大的线程可以退出。
+ * 可以退出返回 0 ，否则返回 -1 。
+ */
+static int threadpool_retire(threadpool_worker_t* worker) {
+    threadpool_t* pool;
+    int ret;
+
+    pool = worker->pool;
+    ret = -1;
+
+    pthread_mutex_lock(&(pool->scale_lock));
+
+    if (!__atomic_load_n(&(pool->shutdown), __ATOMIC_ACQUIRE) &&
+        worker->id == pool->thread_running - 1 && pool->thread_running > pool->min_threads) {
+        worker->state = WORKER_EXITED;
+        __atomic_store_n(&(pool->thread_running), worker->id, __ATOMIC_RELEASE);
+        ret = 0;
+    }
+
+    pthread_mutex_unlock(&(pool->scale_lock));
+
+    if (ret == 0) {
+        log_info("threadpool shrinks to %d threads.", worker->id);
+    }
+
+    return ret;
+}
+
+/*
+ * CoDel ：记录任务的排队时间，每个观察区间结束时根据区间内的最小排队时间判断是否过载。
+ * 最小排队时间反映的是持续的排队而不是短暂的突发，过载时只拒绝排队超过 2 * target 的任务。
+ * 需要拒绝返回 1 ，否则返回 0 。
+ */
+static int threadpool_should_shed(threadpool_t* pool, threadpool_task_t* task) {
+    unsigned long now;
+    unsigned long delay;
+    unsigned long min;
+    unsigned long end;
+
+    if (pool->codel_target == 0) {
+        return 0;
+    }
+
+    now = monotonic_msec();
+    delay = now > task->enqueue_msec ? now - task->enqueue_msec : 0;
+
+    /* 更新区间内的最小排队时间 */
+    min = __atomic_load_n(&(pool->codel_min_delay), __ATOMIC_RELAXED);
+    while (delay < min && !__atomic_compare_exchange_n(&(pool->codel_min_delay), &min, delay,
+                                                       1, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+
+    /* 区间结束，只有一个线程能成功推进区间 */
+    end = __atomic_load_n(&(pool->codel_interval_end), __ATOMIC_RELAXED);
+    if (now >= end && __atomic_compare_exchange_n(&(pool->codel_interval_end), &end, now + pool->codel_interval,
+                                                  0, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+        min = __atomic_exchange_n(&(pool->codel_min_delay), (unsigned long)-1, __ATOMIC_RELAXED);
+        __atomic_store_n(&(pool->codel_overloaded), min > pool->codel_target, __ATOMIC_RELAXED);
+    }
+
+    return __atomic_load_n(&(pool->codel_overloaded), __ATOMIC_RELAXED) && delay > 2 * pool->codel_target;
+}
+
+/*
+ * 将任务放入队列，工作窃取模式下首选线程的 inbox 已满时依次尝试其他线程。
+ * 成功返回 0 ，所有队列已满返回 -1 。
+ */
+static int threadpool_push_task(threadpool_t* pool, task_function_t* func, void* args, int affinity) {
+    threadpool_task_t task;
+    unsigned start;
+    int running;
+    int i;
+
+    task.func = func;
+    task.args = args;
+    task.enqueue_msec = pool->codel_target > 0 || pool->min_threads < pool->threadpool_size ? monotonic_msec() : 0;
+
+    if (pool->mode == THREADPOOL_FIFO) {
+        return task_queue_push(&(pool->task_queue), &task);
+    }
+
+    if (affinity >= 0) {
+        start = (unsigned)affinity;
+    } else {
+        start = __atomic_fetch_add(&(pool->next_worker), 1, __ATOMIC_RELAXED);
+    }
+
+    /* 只投递给运行中的线程，已退出线程的队列中残留的任务由其他线程窃取 */
+    running = __atomic_load_n(&(pool->thread_running), __ATOMIC_ACQUIRE);
+
+    for (i = 0; i < running; ++ i) {
+        if (task_queue_push(&(pool->workers[(start + i) % running].inbox), &task) == 0) {
+            return 0;
+        }
+    }
+
+    return -1;
+}
+
 /*
  * 释放线程池的资源。
  * 成功返回 0 ，否则返回 -1 。
  */
 static int threadpool_free(threadpool_t* threadpool) {
+    int i;
+
     if (threadpool == NULL) {
         return -1;
     }
@@ -181,19 +657,24 @@ static int threadpool_free(threadpool_t* threadpool) {
     if (threadpool->threads) {
         free(threadpool->threads);
         threadpool->threads = NULL;
+    }
 
-        /* 由于初始化互斥量和条件变量在 threads 之前，所以此处一定已经初始化成功 */
-        pthread_mutex_lock(&(threadpool->lock_mutex));
-        pthread_mutex_destroy(&(threadpool->lock_mutex));
-        pthread_cond_destroy(&(threadpool->nfull_cond));
-        pthread_cond_destroy(&(threadpool->nempty_cond));
+    /* 释放各线程的队列空间 */
+    if (threadpool->workers) {
+        for (i = 0; i < threadpool->threadpool_size; ++ i) {
+            task_queue_free(&(threadpool->workers[i].inbox));
+            task_deque_free(&(threadpool->workers[i].deque));
+        }
+
+        free(threadpool->workers);
+        threadpool->workers = NULL;
     }
 
     /* 释放任务队列空间 */
-    if (threadpool->task_queue) {
-        free(threadpool->task_queue);
-        threadpool->task_queue = NULL;
-    }
+    task_queue_free(&(threadpool->task_queue));
+
+    pthread_attr_destroy(&(threadpool->thread_attr));
+    pthread_mutex_destroy(&(threadpool->scale_lock));
 
     /* 释放线程池空间 */
     free(threadpool);
@@ -209,44 +690,321 @@ static int threadpool_free(threadpool_t* threadpool) {
 int threadpool_destroy(threadpool_t* threadpool) {
     int i;
 
-    do {
-        if (threadpool == NULL) {
-            log_error("arguments invalid.");
-            break;
-        }
+    if (threadpool == NULL) {
+        log_error("arguments invalid.");
+        return -1;
+    }
 
-        /* 取得互斥锁资源 */
-        if (pthread_mutex_lock(&(threadpool->lock_mutex)) != 0) {
-            log_error("lock failed.");
-            break;
+    /* 如果线程池已经关闭，则直接返回 */
+    if (__atomic_exchange_n(&(threadpool->shutdown), 1, __ATOMIC_ACQ_REL)) {
+        log_error("already shutting down.");
+        return -1;
+    }
+
+    /* 唤醒所有挂起的线程，使其终止 */
+    ec_notify(&(threadpool->nempty_ec), 1);
+    ec_notify(&(threadpool->nfull_ec), 1);
+
+    /* 等待正在进行的扩容完成，此后不会再创建或退出线程 */
+    pthread_mutex_lock(&(threadpool->scale_lock));
+    pthread_mutex_unlock(&(threadpool->scale_lock));
+
+    /* 回收线程池中的所有线程，包括已经空闲退出的线程 */
+    for (i = 0; i < threadpool->threadpool_size; ++ i) {
+        if (threadpool->workers[i].state == WORKER_NONE) {
+            continue;
         }
 
-        /* 如果线程池已经关闭，则直接返回 */
-        if (threadpool->shutdown) {
-            log_error("already shutting down.");
-            break;
+        if (pthread_join(threadpool->threads[i], NULL) != 0) {
+            log_error("thread join failed.");
         }
+    }
 
-        /* 将线程池设置为关闭 */
-        threadpool->shutdown = 1;
+    return threadpool_free(threadpool);
+}
 
-        /* 广播通知线程终止并解锁 */
-        if ((pthread_cond_broadcast(&(threadpool->nempty_cond)) != 0) ||
-            (pthread_mutex_unlock(&(threadpool->lock_mutex)) != 0)) {
-            log_error("threadpool unlock failed.");
-            break;
+/*
+ * 初始化无锁队列，capacity 必须为 2 的幂。
+ * 成功返回 0 ，否则返回 -1 。
+ */
+static int task_queue_init(task_queue_t* queue, size_t capacity) {
+    size_t i;
+
+    if ((queue->cells = (threadpool_cell_t*)malloc(sizeof(threadpool_cell_t) * capacity)) == NULL) {
+        return -1;
+    }
+
+    /* 初始时第 i 个槽位的序号为 i ，表示可以在位置 i 入队 */
+    for (i = 0; i < capacity; ++ i) {
+        queue->cells[i].sequence = i;
+    }
+
+    queue->mask = capacity - 1;
+    queue->head = 0;
+    queue->tail = 0;
+
+    return 0;
+}
+
+/*
+ * 释放无锁队列。
+ */
+static void task_queue_free(task_queue_t* queue) {
+    if (queue->cells) {
+        free(queue->cells);
+        queue->cells = NULL;
+    }
+}
+
+/*
+ * 无锁入队。
+ * 通过 CAS 抢占队尾位置，槽位序号等于位置时表示槽位空闲。
+ * 成功返回 0 ，队列已满返回 -1 。
+ */
+static int task_queue_push(task_queue_t* queue, threadpool_task_t* task) {
+    threadpool_cell_t* cell;
+    size_t pos;
+    size_t seq;
+    long diff;
+
+    pos = __atomic_load_n(&(queue->tail), __ATOMIC_RELAXED);
+
+    for ( ;; ) {
+        cell = &(queue->cells[pos & queue->mask]);
+        seq = __atomic_load_n(&(cell->sequence), __ATOMIC_ACQUIRE);
+        diff = (long)seq - (long)pos;
+
+        if (diff == 0) {
+            /* 槽位空闲，尝试占用 */
+            if (__atomic_compare_exchange_n(&(queue->tail), &pos, pos + 1,
+                                            1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                break;
+            }
+        } else if (diff < 0) {
+            /* 槽位中还有上一轮未取走的任务，队列已满 */
+            return -1;
+        } else {
+            /* 其他生产者已经占用了该位置 */
+            pos = __atomic_load_n(&(queue->tail), __ATOMIC_RELAXED);
         }
+    }
+
+    cell->task = *task;
+
+    /* 发布任务，序号加 1 表示可以出队 */
+    __atomic_store_n(&(cell->sequence), pos + 1, __ATOMIC_RELEASE);
 
-        /* 回收线程池中的所有线程 */
-        for (i = 0; i < threadpool->thread_running; ++ i) {
-            if (pthread_join(threadpool->threads[i], NULL) != 0) {
-                log_error("thread join failed.");
+    return 0;
+}
+
+/*
+ * 无锁出队。
+ * 通过 CAS 抢占队首位置，槽位序号等于位置加 1 时表示槽位中有任务。
+ * 成功返回 0 ，队列为空返回 -1 。
+ */
+static int task_queue_pop(task_queue_t* queue, threadpool_task_t* task) {
+    threadpool_cell_t* cell;
+    size_t pos;
+    size_t seq;
+    long diff;
+
+    pos = __atomic_load_n(&(queue->head), __ATOMIC_RELAXED);
+
+    for ( ;; ) {
+        cell = &(queue->cells[pos & queue->mask]);
+        seq = __atomic_load_n(&(cell->sequence), __ATOMIC_ACQUIRE);
+        diff = (long)seq - (long)(pos + 1);
+
+        if (diff == 0) {
+            if (__atomic_compare_exchange_n(&(queue->head), &pos, pos + 1,
+                                            1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                break;
             }
+        } else if (diff < 0) {
+            /* 槽位尚未写入任务，队列为空 */
+            return -1;
+        } else {
+            pos = __atomic_load_n(&(queue->head), __ATOMIC_RELAXED);
         }
+    }
 
-        return threadpool_free(threadpool);
+    *task = cell->task;
 
-    } while (0);
+    /* 释放槽位，序号置为下一轮可入队的位置 */
+    __atomic_store_n(&(cell->sequence), pos + queue->mask + 1, __ATOMIC_RELEASE);
 
-    return -1;
-}
\ No newline at end of file
+    return 0;
+}
+
+/*
+ * 初始化工作窃取双端队列，capacity 必须为 2 的幂。
+ * 成功返回 0 ，否则返回 -1 。
+ */
+static int task_deque_init(task_deque_t* deque, size_t capacity) {
+    if ((deque->buffer = (threadpool_task_t*)malloc(sizeof(threadpool_task_t) * capacity)) == NULL) {
+        return -1;
+    }
+
+    deque->mask = capacity - 1;
+    deque->top = 0;
+    deque->bottom = 0;
+
+    return 0;
+}
+
+/*
+ * 释放工作窃取双端队列。
+ */
+static void task_deque_free(task_deque_t* deque) {
+    if (deque->buffer) {
+        free(deque->buffer);
+        deque->buffer = NULL;
+    }
+}
+
+/*
+ * 所属线程在 bottom 端压入任务。
+ * 成功返回 0 ，已满返回 -1 。
+ */
+static int task_deque_push(task_deque_t* deque, threadpool_task_t* task) {
+    threadpool_task_t* slot;
+    long b;
+    long t;
+
+    b = __atomic_load_n(&(deque->bottom), __ATOMIC_RELAXED);
+    t = __atomic_load_n(&(deque->top), __ATOMIC_ACQUIRE);
+
+    if (b - t > deque->mask) {
+        return -1;
+    }
+
+    slot = &(deque->buffer[b & deque->mask]);
+    __atomic_store_n(&(slot->func), task->func, __ATOMIC_RELAXED);
+    __atomic_store_n(&(slot->args), task->args, __ATOMIC_RELAXED);
+    __atomic_store_n(&(slot->enqueue_msec), task->enqueue_msec, __ATOMIC_RELAXED);
+
+    /* 先写槽位再发布 bottom */
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    __atomic_store_n(&(deque->bottom), b + 1, __ATOMIC_RELAXED);
+
+    return 0;
+}
+
+/*
+ * 所属线程在 bottom 端弹出任务，只剩最后一个任务时与窃取者通过 CAS top 竞争。
+ * 成功返回 0 ，为空返回 -1 。
+ */
+static int task_deque_take(task_deque_t* deque, threadpool_task_t* task) {
+    threadpool_task_t* slot;
+    long b;
+    long t;
+    int ret;
+
+    b = __atomic_load_n(&(deque->bottom), __ATOMIC_RELAXED) - 1;
+    __atomic_store_n(&(deque->bottom), b, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    t = __atomic_load_n(&(deque->top), __ATOMIC_RELAXED);
+
+    if (t > b) {
+        /* 为空，恢复 bottom */
+        __atomic_store_n(&(deque->bottom), b + 1, __ATOMIC_RELAXED);
+        return -1;
+    }
+
+    slot = &(deque->buffer[b & deque->mask]);
+    task->func = __atomic_load_n(&(slot->func), __ATOMIC_RELAXED);
+    task->args = __atomic_load_n(&(slot->args), __ATOMIC_RELAXED);
+    task->enqueue_msec = __atomic_load_n(&(slot->enqueue_msec), __ATOMIC_RELAXED);
+
+    ret = 0;
+
+    if (t == b) {
+        /* 最后一个任务，与窃取者竞争 */
+        if (!__atomic_compare_exchange_n(&(deque->top), &t, t + 1,
+                                         0, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED)) {
+            ret = -1;
+        }
+        __atomic_store_n(&(deque->bottom), b + 1, __ATOMIC_RELAXED);
+    }
+
+    return ret;
+}
+
+/*
+ * 其他线程在 top 端窃取任务。
+ * 成功返回 0 ，为空或竞争失败返回 -1 。
+ */
+static int task_deque_steal(task_deque_t* deque, threadpool_task_t* task) {
+    threadpool_task_t* slot;
+    long b;
+    long t;
+
+    t = __atomic_load_n(&(deque->top), __ATOMIC_ACQUIRE);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    b = __atomic_load_n(&(deque->bottom), __ATOMIC_ACQUIRE);
+
+    if (t >= b) {
+        return -1;
+    }
+
+    slot = &(deque->buffer[t & deque->mask]);
+    task->func = __atomic_load_n(&(slot->func), __ATOMIC_RELAXED);
+    task->args = __atomic_load_n(&(slot->args), __ATOMIC_RELAXED);
+    task->enqueue_msec = __atomic_load_n(&(slot->enqueue_msec), __ATOMIC_RELAXED);
+
+    /* CAS 失败说明任务已被所属线程或其他窃取者取走 */
+    if (!__atomic_compare_exchange_n(&(deque->top), &t, t + 1,
+                                     0, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED)) {
+        return -1;
+    }
+
+    return 0;
+}
+
+/*
+ * 登记为等待者并返回当前的 epoch ，之后必须调用 ec_wait 或 ec_cancel_wait 。
+ */
+static unsigned ec_prepare_wait(eventcount_t* ec) {
+    __atomic_add_fetch(&(ec->waiters), 1, __ATOMIC_SEQ_CST);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+    return __atomic_load_n(&(ec->epoch), __ATOMIC_SEQ_CST);
+}
+
+/*
+ * 取消等待。
+ */
+static void ec_cancel_wait(eventcount_t* ec) {
+    __atomic_sub_fetch(&(ec->waiters), 1, __ATOMIC_SEQ_CST);
+}
+
+/*
+ * 若 epoch 自 ec_prepare_wait 之后没有变化，则挂起在 futex 上，最多挂起 timeout 毫秒， 0 表示一直挂起。
+ */
+static void ec_wait(eventcount_t* ec, unsigned key, unsigned long timeout) {
+    struct timespec ts;
+
+    if (__atomic_load_n(&(ec->epoch), __ATOMIC_SEQ_CST) == key) {
+        ts.tv_sec = timeout / 1000;
+        ts.tv_nsec = (timeout % 1000) * 1000000;
+        syscall(SYS_futex, &(ec->epoch), FUTEX_WAIT_PRIVATE, key, timeout > 0 ? &ts : NULL, NULL, 0);
+    }
+
+    __atomic_sub_fetch(&(ec->waiters), 1, __ATOMIC_SEQ_CST);
+}
+
+/*
+ * 通知等待者，all 非 0 时唤醒所有等待者，否则只唤醒一个。
+ * 没有等待者时不进入内核。
+ */
+static void ec_notify(eventcount_t* ec, int all) {
+    /* 与 ec_prepare_wait 中的 waiters 自增构成全序，保证不会丢失唤醒 */
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+    if (__atomic_load_n(&(ec->waiters), __ATOMIC_SEQ_CST) == 0) {
+        return;
+    }
+
+    __atomic_add_fetch(&(ec->epoch), 1, __ATOMIC_SEQ_CST);
+    syscall(SYS_futex, &(ec->epoch), FUTEX_WAKE_PRIVATE, all ? INT_MAX : 1, NULL, NULL, 0);
+}
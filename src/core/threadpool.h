@@ -7,6 +7,7 @@
 #define _THREADPOOL_H_
 
 #include <pthread.h>
+#include <stddef.h>
 
 typedef void* (task_function_t)(void*);      /* 简化函数类型 */
 
@@ -16,38 +17,184 @@ typedef void* (task_function_t)(void*);      /* 简化函数类型 */
 typedef struct {
     task_function_t*    func;               /* 指向任务函数 */
     void*               args;               /* 传入 func 的参数 */
+    unsigned long       enqueue_msec;       /* 入队时间，用于计算排队时间 */
 } threadpool_task_t;
 
+#define CACHE_LINE_SIZE     64              /* 缓存行大小，用于避免伪共享 */
+
 /*
- * 线程池类型。
+ * 无锁任务队列中的槽位。
+ * sequence 与入队/出队位置配合标识槽位状态：等于 pos 时可入队，等于 pos + 1 时可出队。
+ */
+typedef struct {
+    size_t              sequence;           /* 槽位序号 */
+    threadpool_task_t   task;               /* 槽位中的任务 */
+} threadpool_cell_t;
+
+/*
+ * 基于 futex 的 eventcount ，用于挂起与唤醒空闲线程。
+ * 只有存在等待者时通知方才会进入内核，没有等待者时通知只是一次原子读。
+ */
+typedef struct {
+    unsigned            epoch;              /* futex 等待的字，每次通知加 1 */
+    unsigned            waiters;            /* 等待者数量 */
+} eventcount_t;
+
+/*
+ * 有界无锁多生产者多消费者队列，队首与队尾各占一个缓存行。
+ */
+typedef struct {
+    size_t              head                /* 队列头部，出队位置 */
+                        __attribute__((aligned(CACHE_LINE_SIZE)));
+    size_t              tail                /* 队列尾部，入队位置 */
+                        __attribute__((aligned(CACHE_LINE_SIZE)));
+    threadpool_cell_t*  cells               /* 槽位数组，采用循环队列结构 */
+                        __attribute__((aligned(CACHE_LINE_SIZE)));
+    size_t              mask;               /* 队列大小减 1 ，队列大小为 2 的幂 */
+} task_queue_t;
+
+/*
+ * Chase-Lev 工作窃取双端队列。
+ * 只有所属线程在 bottom 端压入与弹出，其他线程从 top 端窃取。
  */
 typedef struct {
-    pthread_t*          threads;            /* 线程 tid 数组 */
-    threadpool_task_t*  task_queue;         /* 任务队列，采用循环队列结构 */
+    long                top                 /* 窃取端 */
+                        __attribute__((aligned(CACHE_LINE_SIZE)));
+    long                bottom              /* 所属线程端 */
+                        __attribute__((aligned(CACHE_LINE_SIZE)));
+    threadpool_task_t*  buffer              /* 循环数组 */
+                        __attribute__((aligned(CACHE_LINE_SIZE)));
+    long                mask;               /* 数组大小减 1 ，数组大小为 2 的幂 */
+} task_deque_t;
+
+#define THREADPOOL_FIFO     0               /* 所有线程共享一个任务队列 */
+#define THREADPOOL_STEAL    1               /* 每个线程拥有本地队列，空闲线程窃取其他线程的任务 */
+
+#define STEAL_BATCH         8               /* 每次从收件队列转移到本地双端队列的最大任务数 */
+
+#define GROW_WAIT_DEF       10              /* 默认扩容阈值：任务排队超过该时间（毫秒）时增加线程 */
+#define IDLE_TIMEOUT_DEF    10000           /* 默认空闲时间：超过最小线程数的线程空闲该时间（毫秒）后退出 */
+
+#define WORKER_NONE         0               /* 槽位上没有线程 */
+#define WORKER_RUNNING      1               /* 槽位上的线程正在运行 */
+#define WORKER_EXITED       2               /* 槽位上的线程已退出，等待回收 */
+
+typedef struct threadpool_s threadpool_t;
+
+/*
+ * 工作线程类型。
+ * 工作窃取模式下，事件循环按连接亲和性把任务投递到 inbox ，
+ * 工作线程批量把 inbox 中的任务转移到自己的 deque 中执行，空闲线程则从其他线程的 deque 或 inbox 中窃取。
+ */
+typedef struct {
+    task_queue_t        inbox;              /* 投递给该线程的任务 */
+    task_deque_t        deque;              /* 本地工作窃取双端队列 */
+    threadpool_t*       pool;               /* 所属线程池 */
+    int                 id;                 /* 线程编号，即槽位下标 */
+    int                 state;              /* 槽位状态， WORKER_NONE 、 WORKER_RUNNING 或 WORKER_EXITED */
+    unsigned            steal_seed;         /* 选择窃取对象的随机数种子 */
+} threadpool_worker_t;
+
+/*
+ * 线程池类型。
+ */
+struct threadpool_s {
+    task_queue_t        task_queue;         /* FIFO 模式下所有线程共享的任务队列 */
+    eventcount_t        nempty_ec           /* 任务队列非空的 eventcount */
+                        __attribute__((aligned(CACHE_LINE_SIZE)));
+    eventcount_t        nfull_ec            /* 任务队列非满的 eventcount */
+                        __attribute__((aligned(CACHE_LINE_SIZE)));
+    unsigned            next_worker         /* 未指定亲和性时轮流投递的下一个线程 */
+                        __attribute__((aligned(CACHE_LINE_SIZE)));
 
-    int                 threadpool_size;    /* 线程池大小 */
-    int                 thread_running;     /* 运行中的线程数量，正常情况下等于线程池大小 */
+                                            /* CoDel 过载控制，由工作线程在取任务时更新 */
+    unsigned long       codel_interval_end  /* 当前观察区间的结束时间 */
+                        __attribute__((aligned(CACHE_LINE_SIZE)));
+    unsigned long       codel_min_delay;    /* 当前观察区间内的最小排队时间 */
+    int                 codel_overloaded;   /* 上一个观察区间内最小排队时间超过目标值则为 1 */
+    unsigned long       codel_target;       /* 目标排队时间（毫秒）， 0 表示不做过载控制 */
+    unsigned long       codel_interval;     /* 观察区间长度（毫秒） */
+    task_function_t*    shed_func;          /* 任务被拒绝时代替 func 执行的函数 */
+
+    unsigned long       shed_num            /* 因排队时间过长被拒绝的任务数 */
+                        __attribute__((aligned(CACHE_LINE_SIZE)));
+    unsigned long       full_num;           /* 因队列已满而添加失败的次数 */
+
+                                            /* 弹性伸缩，线程数在 [min_threads, threadpool_size] 之间变化 */
+    unsigned long       grow_msec           /* 上次扩容的时间 */
+                        __attribute__((aligned(CACHE_LINE_SIZE)));
+    unsigned long       grow_wait;          /* 任务排队超过该时间（毫秒）时增加一个线程，每个该时间段内最多增加一个 */
+    unsigned long       idle_timeout;       /* 超过最小线程数的线程空闲该时间（毫秒）后退出 */
+    pthread_mutex_t     scale_lock;         /* 创建、退出与回收线程时加锁 */
+    pthread_attr_t      thread_attr;        /* 创建线程的属性，包括栈大小 */
+
+    pthread_t*          threads             /* 线程 tid 数组 */
+                        __attribute__((aligned(CACHE_LINE_SIZE)));
+    threadpool_worker_t* workers;           /* 工作线程数组，运行中的线程占据 [0, thread_running) */
+
+    int                 mode;               /* THREADPOOL_FIFO 或 THREADPOOL_STEAL */
+    int                 min_threads;        /* 最小线程数 */
+    int                 threadpool_size;    /* 线程池大小，即最大线程数 */
+    int                 thread_running;     /* 当前线程数 */
     int                 task_queue_size;    /* 任务队列大小 */
-    int                 task_queue_front;   /* 任务队列头部 */
-    int                 task_queue_rear;    /* 任务队列尾部 */
-    int                 task_num;           /* 任务队列中实际的任务数量 */
     int                 shutdown;           /* 线程池的关闭状态， 1 为关闭 */
-
-    pthread_mutex_t     lock_mutex;         /* 用于内部工作的互斥锁 */
-    pthread_cond_t      nfull_cond;         /* 任务队列非满的条件变量 */
-    pthread_cond_t      nempty_cond;        /* 任务队列非空的条件变量 */
-} threadpool_t;
+};
 
 /*
- * 创建线程池，线程池大小为 threadpool_size ，任务队列大小为 task_queue_size 。
+ * 创建线程池，线程池大小为 threadpool_size ，任务队列大小为 task_queue_size （向上取整为 2 的幂），
+ * 所有线程共享一个先进先出的任务队列。
  * 创建成功则返回相应线程池指针，否则返回 NULL 。
  */
 threadpool_t* threadpool_create(int threadpool_size, int task_queue_size);
+
+/*
+ * 以指定的调度模式创建线程池， mode 为 THREADPOOL_FIFO 或 THREADPOOL_STEAL ，
+ * 工作窃取模式下每个线程各有一个 task_queue_size 大小的队列。其余参数与 threadpool_create 相同。
+ * 创建成功则返回相应线程池指针，否则返回 NULL 。
+ */
+threadpool_t* threadpool_create_mode(int threadpool_size, int task_queue_size, int mode);
+
+/*
+ * 创建弹性线程池，初始创建 min_threads 个线程，最多 max_threads 个线程。
+ * 任务排队时间持续超过扩容阈值时增加线程，超过 min_threads 的线程空闲一段时间后退出，阈值由 threadpool_set_scaling 设置。
+ * stack_size 为线程栈大小（字节）， 0 表示使用系统默认值。其余参数与 threadpool_create_mode 相同。
+ * 创建成功则返回相应线程池指针，否则返回 NULL 。
+ */
+threadpool_t* threadpool_create_elastic(int min_threads, int max_threads, int task_queue_size, int mode, size_t stack_size);
 /*
  * 向线程池中添加任务。
  * 添加成功返回 0 ，否则返回 -1 。
  */
 int threadpool_add_task(threadpool_t* threadpool, task_function_t* func, void* args);
+/*
+ * 向线程池中添加任务，工作窃取模式下优先投递给第 affinity % threadpool_size 个线程，
+ * 同一连接使用相同的 affinity 可以让其请求尽量在同一线程上执行。 affinity 小于 0 时轮流投递。
+ * 添加成功返回 0 ，否则返回 -1 。
+ */
+int threadpool_add_task_affinity(threadpool_t* threadpool, task_function_t* func, void* args, int affinity);
+/*
+ * 尝试向线程池中添加任务，队列已满时不阻塞。
+ * 添加成功返回 0 ，队列已满或线程池已关闭返回 -1 。
+ */
+int threadpool_try_add_task_affinity(threadpool_t* threadpool, task_function_t* func, void* args, int affinity);
+/*
+ * 设置 CoDel 过载控制。
+ * 某个长度为 interval 毫秒的观察区间内最小排队时间超过 target 毫秒时线程池进入过载状态，
+ * 过载状态下排队时间超过 2 * target 的任务不再执行 func ，而是执行 shed(args) 。 target 为 0 时关闭。
+ */
+void threadpool_set_shedding(threadpool_t* threadpool, unsigned long target, unsigned long interval, task_function_t* shed);
+/*
+ * 获取被拒绝的任务数与因队列已满而添加失败的次数。
+ */
+void threadpool_get_stats(threadpool_t* threadpool, unsigned long* shed_num, unsigned long* full_num);
+/*
+ * 设置弹性伸缩的阈值：任务排队超过 grow_wait 毫秒时增加线程，多出的线程空闲 idle_timeout 毫秒后退出。
+ */
+void threadpool_set_scaling(threadpool_t* threadpool, unsigned long grow_wait, unsigned long idle_timeout);
+/*
+ * 获取当前线程数、最小线程数与最大线程数。
+ */
+void threadpool_get_threads(threadpool_t* threadpool, int* current, int* min, int* max);
 /*
  * 销毁线程池。
  * 成功返回 0 ，否则返回 -1 。
@@ -0,0 +1,96 @@
+/**
+ * @author ttoobne
+ * @date 2026/10/17
+ */
+
+#include "times.h"
+
+#include "log.h"
+#include "utility.h"
+
+#include <pthread.h>
+#include <time.h>
+
+/*
+ * 各事件循环共用一份缓存：毫秒数直接原子地读写；
+ * Date 头部行格式化到环形缓冲区的下一个位置后再原子地发布指针，读者不需要加锁。
+ */
+static unsigned long    cached_msec;                                    /* 缓存的单调时钟时间 */
+static const char*      cached_http_date;                               /* 当前发布的 Date 头部行 */
+static time_t           cached_sec = -1;                                /* 当前 Date 头部行对应的秒数 */
+static char             http_dates[TIMES_SLOTS][HTTP_DATE_LINE_LEN + 1];
+static unsigned         slot;
+static pthread_mutex_t  times_mutex = PTHREAD_MUTEX_INITIALIZER;        /* 只有格式化 Date 头部行的线程持有 */
+
+/*
+ * 初始化时间缓存，应在使用缓存的时间之前调用。
+ */
+int init_times() {
+    update_times();
+
+    if (cached_http_date == NULL) {
+        log_error("init http date failed.");
+        return -1;
+    }
+
+    return 0;
+}
+
+/*
+ * 更新时间缓存，由各事件循环在每次等待返回后调用。
+ * 缓存的毫秒数只增不减；秒数变化时重新格式化 Date 头部行并发布。
+ */
+void update_times() {
+    struct timespec ts;
+    struct tm tm;
+    unsigned long old;
+    unsigned long now;
+    char* date;
+
+    now = monotonic_msec();
+    old = __atomic_load_n(&cached_msec, __ATOMIC_RELAXED);
+
+    /* 多个事件循环同时更新时保留较新的值 */
+    while (now > old) {
+        if (__atomic_compare_exchange_n(&cached_msec, &old, now, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+            break;
+        }
+    }
+
+    clock_gettime(CLOCK_REALTIME_COARSE, &ts);
+
+    if (ts.tv_sec == __atomic_load_n(&cached_sec, __ATOMIC_RELAXED)) {
+        return;
+    }
+
+    /* 已有其他事件循环在格式化 */
+    if (pthread_mutex_trylock(&times_mutex) != 0) {
+        return;
+    }
+
+    if (ts.tv_sec != cached_sec && gmtime_r(&(ts.tv_sec), &tm) != NULL) {
+        slot = (slot + 1) % TIMES_SLOTS;
+        date = http_dates[slot];
+
+        strftime(date, HTTP_DATE_LINE_LEN + 1, "Date: %a, %d %b %Y %H:%M:%S GMT\r\n", &tm);
+
+        __atomic_store_n(&cached_http_date, date, __ATOMIC_RELEASE);
+        __atomic_store_n(&cached_sec, ts.tv_sec, __ATOMIC_RELAXED);
+    }
+
+    pthread_mutex_unlock(&times_mutex);
+}
+
+/*
+ * 获取缓存的单调时钟时间，单位毫秒。
+ */
+unsigned long current_msec() {
+    return __atomic_load_n(&cached_msec, __ATOMIC_RELAXED);
+}
+
+/*
+ * 获取缓存的 Date 头部行，格式为 "Date: <IMF-fixdate>\r\n" ，长度为 HTTP_DATE_LINE_LEN ，不需要释放。
+ */
+const char* current_http_date() {
+    return __atomic_load_n(&cached_http_date, __ATOMIC_ACQUIRE);
+}
@@ -0,0 +1,36 @@
+/**
+ * @author ttoobne
+ * @date 2026/10/17
+ */
+
+#ifndef _TIMES_H_
+#define _TIMES_H_
+
+#include <stddef.h>
+
+#define HTTP_DATE_LINE      "Date: Sun, 06 Nov 1994 08:49:37 GMT\r\n"
+#define HTTP_DATE_LINE_LEN  (sizeof(HTTP_DATE_LINE) - 1)   /* 预先格式化的 Date 头部行的长度 */
+#define TIMES_SLOTS         64                              /* Date 头部行的缓冲区个数，读者持有的旧缓冲区在 64 秒内不会被覆盖 */
+
+/*
+ * 初始化时间缓存，应在使用缓存的时间之前调用。
+ */
+int init_times();
+
+/*
+ * 更新时间缓存，由各事件循环在每次等待返回后调用。
+ * 缓存的毫秒数只增不减；秒数变化时重新格式化 Date 头部行并发布。
+ */
+void update_times();
+
+/*
+ * 获取缓存的单调时钟时间，单位毫秒。
+ */
+unsigned long current_msec();
+
+/*
+ * 获取缓存的 Date 头部行，格式为 "Date: <IMF-fixdate>\r\n" ，长度为 HTTP_DATE_LINE_LEN ，不需要释放。
+ */
+const char* current_http_date();
+
+#endif /* _TIMES_H_ */
@@ -0,0 +1,315 @@
+/**
+ * @author ttoobne
+ * @date 2026/10/17
+ */
+
+#include "uring.h"
+
+#include "log.h"
+
+#include <errno.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+static int uring_enter(uring_t* uring, unsigned to_submit, unsigned min_complete, int timeout);
+static unsigned uring_flush(uring_t* uring);
+
+/*
+ * 创建 io_uring 并注册接收缓冲区。
+ * 内核不支持 multishot accept 、 multishot recv 或缓冲区环时失败。
+ * 创建成功则返回 uring_t 类型指针，失败则返回 NULL 。
+ */
+uring_t* uring_create() {
+    uring_t* uring = NULL;
+    struct io_uring_params params;
+    struct io_uring_buf_reg reg;
+    struct io_uring_buf* buf;
+    unsigned i;
+
+    do {
+        if ((uring = (uring_t*)malloc(sizeof(uring_t))) == NULL) {
+            log_error("uring malloc failed.");
+            break;
+        }
+
+        memset(uring, 0, sizeof(uring_t));
+        uring->ringfd = -1;
+
+        /* SINGLE_ISSUER 与 DEFER_TASKRUN 要求 6.1 及以上的内核，此时 multishot accept/recv 与缓冲区环都可用 */
+        memset(&params, 0, sizeof(params));
+        params.flags = IORING_SETUP_SINGLE_ISSUER | IORING_SETUP_DEFER_TASKRUN;
+
+        if ((uring->ringfd = syscall(__NR_io_uring_setup, URING_ENTRIES, &params)) < 0) {
+            log_error("io_uring setup failed.");
+            break;
+        }
+
+        if (!(params.features & IORING_FEAT_SINGLE_MMAP) || !(params.features & IORING_FEAT_EXT_ARG)) {
+            log_error("io_uring features not supported.");
+            break;
+        }
+
+        /* 提交队列与完成队列共用一次 mmap */
+        uring->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        uring->cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        if (uring->cq_ring_size > uring->sq_ring_size) {
+            uring->sq_ring_size = uring->cq_ring_size;
+        }
+        uring->cq_ring_size = uring->sq_ring_size;
+
+        if ((uring->sq_ring = mmap(NULL, uring->sq_ring_size, PROT_READ | PROT_WRITE,
+                                   MAP_SHARED | MAP_POPULATE, uring->ringfd, IORING_OFF_SQ_RING)) == MAP_FAILED) {
+            uring->sq_ring = NULL;
+            log_error("io_uring mmap failed.");
+            break;
+        }
+        uring->cq_ring = uring->sq_ring;
+
+        uring->sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+        if ((uring->sqes = mmap(NULL, uring->sqes_size, PROT_READ | PROT_WRITE,
+                                MAP_SHARED | MAP_POPULATE, uring->ringfd, IORING_OFF_SQES)) == MAP_FAILED) {
+            uring->sqes = NULL;
+            log_error("io_uring mmap failed.");
+            break;
+        }
+
+        uring->sq_head = (unsigned*)((char*)uring->sq_ring + params.sq_off.head);
+        uring->sq_tail = (unsigned*)((char*)uring->sq_ring + params.sq_off.tail);
+        uring->sq_mask = *(unsigned*)((char*)uring->sq_ring + params.sq_off.ring_mask);
+        uring->sq_array = (unsigned*)((char*)uring->sq_ring + params.sq_off.array);
+        uring->sqe_tail = *(uring->sq_tail);
+
+        uring->cq_head = (unsigned*)((char*)uring->cq_ring + params.cq_off.head);
+        uring->cq_tail = (unsigned*)((char*)uring->cq_ring + params.cq_off.tail);
+        uring->cq_mask = *(unsigned*)((char*)uring->cq_ring + params.cq_off.ring_mask);
+        uring->cqes = (io_uring_cqe*)((char*)uring->cq_ring + params.cq_off.cqes);
+
+        /* 提交项与提交队列一一对应 */
+        for (i = 0; i <= uring->sq_mask; ++ i) {
+            uring->sq_array[i] = i;
+        }
+
+        /* 接收缓冲区环，内核从中挑选缓冲区存放收到的数据 */
+        uring->buf_ring_size = URING_BUF_NUM * sizeof(struct io_uring_buf);
+        if ((uring->buf_ring = mmap(NULL, uring->buf_ring_size, PROT_READ | PROT_WRITE,
+                                    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0)) == MAP_FAILED) {
+            uring->buf_ring = NULL;
+            log_error("buffer ring mmap failed.");
+            break;
+        }
+
+        if ((uring->bufs = (unsigned char*)malloc(URING_BUF_NUM * URING_BUF_SIZE)) == NULL) {
+            log_error("buffers malloc failed.");
+            break;
+        }
+
+        memset(&reg, 0, sizeof(reg));
+        reg.ring_addr = (unsigned long)uring->buf_ring;
+        reg.ring_entries = URING_BUF_NUM;
+        reg.bgid = URING_BUF_GROUP;
+
+        if (syscall(__NR_io_uring_register, uring->ringfd, IORING_REGISTER_PBUF_RING, &reg, 1) != 0) {
+            log_error("io_uring register buffer ring failed.");
+            break;
+        }
+
+        for (i = 0; i < URING_BUF_NUM; ++ i) {
+            buf = &(uring->buf_ring->bufs[i]);
+            buf->addr = (unsigned long)(uring->bufs + i * URING_BUF_SIZE);
+            buf->len = URING_BUF_SIZE;
+            buf->bid = i;
+        }
+
+        uring->buf_tail = URING_BUF_NUM;
+        __atomic_store_n(&(uring->buf_ring->tail), uring->buf_tail, __ATOMIC_RELEASE);
+
+        return uring;
+
+    } while (0);
+
+    uring_free(uring);
+
+    return NULL;
+}
+
+/*
+ * 保证提交队列中至少有 n 个空闲的提交项，不够时先提交已有的项。
+ * 链式操作必须在同一次提交中，填写前先预留整条链。成功返回 0 ，提交队列一直腾不出空间时返回 -1 。
+ */
+int uring_reserve(uring_t* uring, unsigned n) {
+    int retry;
+
+    for (retry = 0; uring->sqe_tail - __atomic_load_n(uring->sq_head, __ATOMIC_ACQUIRE) + n > uring->sq_mask + 1;
+         ++ retry) {
+        if (retry == URING_RETRY_MAX) {
+            log_error("io_uring submission queue is full.");
+            return -1;
+        }
+
+        /* 内核一次可能只取走一部分，暂时无法接收时重试 */
+        if (uring_enter(uring, uring_flush(uring), 0, 0) == -1) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+/*
+ * 获取一个空闲的提交项，提交队列已满时先提交已有的项。
+ * 返回的提交项已清零，提交队列一直腾不出空间时返回 NULL 。
+ */
+io_uring_sqe* uring_get_sqe(uring_t* uring) {
+    io_uring_sqe* sqe;
+
+    if (uring_reserve(uring, 1) != 0) {
+        return NULL;
+    }
+
+    sqe = &(uring->sqes[uring->sqe_tail & uring->sq_mask]);
+    uring->sqe_tail ++ ;
+
+    memset(sqe, 0, sizeof(io_uring_sqe));
+
+    return sqe;
+}
+
+/*
+ * 提交所有填写好的提交项，并等待至少一个完成事件，最多等待 timeout 毫秒， -1 表示一直等待。
+ * 返回提交的数量，内核暂时无法接收时返回 URING_AGAIN ，出错返回 -1 。
+ */
+int uring_submit_and_wait(uring_t* uring, int timeout) {
+    return uring_enter(uring, uring_flush(uring), 1, timeout);
+}
+
+/*
+ * 取一个完成事件，没有则返回 NULL 。处理完毕后需调用 uring_cqe_seen 。
+ */
+io_uring_cqe* uring_peek_cqe(uring_t* uring) {
+    unsigned head;
+
+    head = *(uring->cq_head);
+
+    if (head == __atomic_load_n(uring->cq_tail, __ATOMIC_ACQUIRE)) {
+        return NULL;
+    }
+
+    return &(uring->cqes[head & uring->cq_mask]);
+}
+
+/*
+ * 标记一个完成事件已处理。
+ */
+void uring_cqe_seen(uring_t* uring) {
+    __atomic_store_n(uring->cq_head, *(uring->cq_head) + 1, __ATOMIC_RELEASE);
+}
+
+/*
+ * 获取编号为 bid 的接收缓冲区。
+ */
+void* uring_buffer(uring_t* uring, unsigned bid) {
+    return uring->bufs + bid * URING_BUF_SIZE;
+}
+
+/*
+ * 将编号为 bid 的接收缓冲区还给内核。
+ */
+void uring_recycle_buffer(uring_t* uring, unsigned bid) {
+    struct io_uring_buf* buf;
+
+    buf = &(uring->buf_ring->bufs[uring->buf_tail & (URING_BUF_NUM - 1)]);
+    buf->addr = (unsigned long)(uring->bufs + bid * URING_BUF_SIZE);
+    buf->len = URING_BUF_SIZE;
+    buf->bid = bid;
+
+    uring->buf_tail ++ ;
+    __atomic_store_n(&(uring->buf_ring->tail), uring->buf_tail, __ATOMIC_RELEASE);
+}
+
+/*
+ * 释放所申请的空间资源。
+ */
+int uring_free(uring_t* uring) {
+    if (uring == NULL) {
+        return 0;
+    }
+
+    if (uring->buf_ring) {
+        munmap(uring->buf_ring, uring->buf_ring_size);
+    }
+
+    if (uring->bufs) {
+        free(uring->bufs);
+    }
+
+    if (uring->sqes) {
+        munmap(uring->sqes, uring->sqes_size);
+    }
+
+    if (uring->sq_ring) {
+        munmap(uring->sq_ring, uring->sq_ring_size);
+    }
+
+    if (uring->ringfd >= 0) {
+        close(uring->ringfd);
+    }
+
+    free(uring);
+
+    return 0;
+}
+
+/*
+ * 发布已填写的提交项，返回需要提交的数量，包括之前的提交中内核没有取走的项。
+ */
+static unsigned uring_flush(uring_t* uring) {
+    __atomic_store_n(uring->sq_tail, uring->sqe_tail, __ATOMIC_RELEASE);
+
+    return uring->sqe_tail - __atomic_load_n(uring->sq_head, __ATOMIC_ACQUIRE);
+}
+
+/*
+ * 调用 io_uring_enter ，提交 to_submit 个提交项并等待 min_complete 个完成事件。
+ * 超时或被信号中断时返回 0 ，内核暂时无法接收（内存不足或完成队列溢出）时返回 URING_AGAIN ，出错返回 -1 。
+ */
+static int uring_enter(uring_t* uring, unsigned to_submit, unsigned min_complete, int timeout) {
+    struct io_uring_getevents_arg arg;
+    struct __kernel_timespec ts;
+    unsigned flags;
+    int ret;
+
+    flags = IORING_ENTER_EXT_ARG;
+    if (min_complete > 0) {
+        flags |= IORING_ENTER_GETEVENTS;
+    }
+
+    memset(&arg, 0, sizeof(arg));
+    arg.sigmask_sz = _NSIG / 8;
+
+    if (timeout >= 0) {
+        ts.tv_sec = timeout / 1000;
+        ts.tv_nsec = (timeout % 1000) * 1000000;
+        arg.ts = (unsigned long)&ts;
+    }
+
+    if ((ret = syscall(__NR_io_uring_enter, uring->ringfd, to_submit, min_complete,
+                       flags, &arg, sizeof(arg))) < 0) {
+        if (errno == ETIME || errno == EINTR) {
+            return 0;
+        }
+
+        if (errno == EAGAIN || errno == EBUSY) {
+            return URING_AGAIN;
+        }
+
+        log_error("io_uring enter failed.");
+        return -1;
+    }
+
+    return ret;
+}
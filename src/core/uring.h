@@ -0,0 +1,105 @@
+/**
+ * @author ttoobne
+ * @date 2026/10/17
+ */
+
+#ifndef _URING_H_
+#define _URING_H_
+
+#include <linux/io_uring.h>
+#include <stddef.h>
+
+/*
+ * 使用 uring_t 类型简化 io_uring 的使用，直接通过系统调用实现，不依赖 liburing 。
+ * 只应在创建它的线程中使用。
+ */
+
+#define URING_ENTRIES       1024        /* 提交队列大小 */
+#define URING_BUF_NUM       512         /* 提供给内核的接收缓冲区数量，必须为 2 的幂 */
+#define URING_BUF_SIZE      4096        /* 每个接收缓冲区的大小 */
+#define URING_BUF_GROUP     0           /* 接收缓冲区组编号 */
+#define URING_RETRY_MAX     16          /* 提交队列已满且内核暂时无法接收时的最多重试次数 */
+
+#define URING_AGAIN         -2          /* 内核暂时无法接收提交（ EAGAIN 、 EBUSY ），处理完成事件后重试 */
+
+typedef struct io_uring_sqe io_uring_sqe;
+typedef struct io_uring_cqe io_uring_cqe;
+
+typedef struct {
+    int                     ringfd;         /* io_uring 对应的文件描述符 */
+
+    unsigned*               sq_head;        /* 提交队列，内核更新 head ，用户更新 tail */
+    unsigned*               sq_tail;
+    unsigned                sq_mask;
+    unsigned*               sq_array;
+    io_uring_sqe*           sqes;
+    unsigned                sqe_tail;       /* 已填写但尚未提交的最后位置 */
+
+    unsigned*               cq_head;        /* 完成队列，内核更新 tail ，用户更新 head */
+    unsigned*               cq_tail;
+    unsigned                cq_mask;
+    io_uring_cqe*           cqes;
+
+    void*                   sq_ring;        /* mmap 得到的各段内存 */
+    size_t                  sq_ring_size;
+    void*                   cq_ring;
+    size_t                  cq_ring_size;
+    size_t                  sqes_size;
+
+    struct io_uring_buf_ring* buf_ring;     /* 提供给内核的接收缓冲区环 */
+    size_t                  buf_ring_size;
+    unsigned char*          bufs;           /* 接收缓冲区 */
+    unsigned short          buf_tail;       /* 缓冲区环的尾部 */
+} uring_t;
+
+/*
+ * 创建 io_uring 并注册接收缓冲区。
+ * 内核不支持 multishot accept 、 multishot recv 或缓冲区环时失败。
+ * 创建成功则返回 uring_t 类型指针，失败则返回 NULL 。
+ */
+uring_t* uring_create();
+
+/*
+ * 保证提交队列中至少有 n 个空闲的提交项，不够时先提交已有的项。
+ * 链式操作必须在同一次提交中，填写前先预留整条链。成功返回 0 ，提交队列一直腾不出空间时返回 -1 。
+ */
+int uring_reserve(uring_t* uring, unsigned n);
+
+/*
+ * 获取一个空闲的提交项，提交队列已满时先提交已有的项。
+ * 返回的提交项已清零，提交队列一直腾不出空间时返回 NULL 。
+ */
+io_uring_sqe* uring_get_sqe(uring_t* uring);
+
+/*
+ * 提交所有填写好的提交项，并等待至少一个完成事件，最多等待 timeout 毫秒， -1 表示一直等待。
+ * 返回提交的数量，内核暂时无法接收时返回 URING_AGAIN ，出错返回 -1 。
+ */
+int uring_submit_and_wait(uring_t* uring, int timeout);
+
+/*
+ * 取一个完成事件，没有则返回 NULL 。处理完毕后需调用 uring_cqe_seen 。
+ */
+io_uring_cqe* uring_peek_cqe(uring_t* uring);
+
+/*
+ * 标记一个完成事件已处理。
+ */
+void uring_cqe_seen(uring_t* uring);
+
+/*
+ * 获取编号为 bid 的接收缓冲区。
+ */
+void* uring_buffer(uring_t* uring, unsigned bid);
+
+/*
+ * 将编号为 bid 的接收缓冲区还给内核。
+ */
+void uring_recycle_buffer(uring_t* uring, unsigned bid);
+
+/*
+ * 释放所申请的空间资源。
+ */
+int uring_free(uring_t* uring);
+
+#endif /* _URING_H_ */
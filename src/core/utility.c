@@ -16,6 +16,7 @@
 #include <sys/resource.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <time.h>
 
 /*
  * 设置文件描述符为非阻塞，返回旧的选项。
@@ -62,6 +63,18 @@ int ignore_sigpipe()
     return 0;
 }
 
+/*
+ * 获取单调时钟的当前时间，单位毫秒。
+ */
+unsigned long monotonic_msec()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+
+    return ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
 /*
  * 初始化进程为守护进程。
  */
@@ -16,6 +16,11 @@ int set_nonblocking(int fd);
  */
 int ignore_sigpipe();
 
+/*
+ * 获取单调时钟的当前时间，单位毫秒。
+ */
+unsigned long monotonic_msec();
+
 /*
  * 初始化进程为守护进程。
  */
@@ -5,21 +5,25 @@
 
 #include "http.h"
 
+#include "coroutine.h"
+#include "http_builder.h"
+#include "http_output.h"
+#include "http_range.h"
 #include "http_request.h"
 #include "http_timer.h"
 #include "log.h"
-#include "rio.h"
+#include "times.h"
 #include "utility.h"
 
 #include <arpa/inet.h>
 #include <errno.h>
 #include <fcntl.h>
 #include <netinet/in.h>
-#include <sys/mman.h>
 #include <sys/socket.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <time.h>
 #include <unistd.h>
@@ -54,12 +58,41 @@ static mime_type_t mimes[] = {
     {NULL, NULL}
 };
 
+/* 过载时发送的 503 响应，预先构造好，发送时不需要再格式化 */
+static const char overload_response[] =
+    PROTOCOL " 503 Service Unavailable\r\n"
+    "Server: " SERVER_NAME "\r\n"
+    "Connection: close\r\n"
+    "Retry-After: 1\r\n"
+    "Content-length: 0\r\n"
+    "\r\n";
+
+/* 预先生成的错误响应：头部与错误页面连续存放，按状态码索引，只有 Date 头部行在发送时写入头部的副本 */
+typedef struct {
+    size_t              headers_len;    /* 头部长度 */
+    size_t              date_off;       /* Date 头部行在头部中的偏移 */
+    size_t              body_len;       /* 错误页面长度 */
+    char                data[];         /* 头部与错误页面 */
+} http_error_page_t;
+
+static http_error_page_t* error_pages[HTTP_STATUS_MAX];
+
+/* multipart/byteranges 的分隔符序号，每个响应取一个 */
+static unsigned long boundary_seq;
+
 static unsigned parse_uri(http_request_t* rq, char* filename);
-static int serve_headers(http_request_t* rq, http_headers_out_t* out, char* mime_type, off_t length, unsigned errstatus);
-static int serve_static(http_request_t* rq, http_headers_out_t* out, char* filename, off_t length);
-static int serve_error(http_request_t* rq, unsigned status);
-static char* get_shortmsg(unsigned status);
-static char* get_mime_type(char* filename);
+static void build_headers(http_request_t* rq, http_headers_out_t* out, const char* mime_type, off_t length,
+                          unsigned errstatus, http_response_t* resp);
+static void use_cached_response(http_response_t* resp, http_cached_t* cached);
+static void build_range_response(http_request_t* rq, http_headers_out_t* out, http_file_t* file,
+                                 const off_t* first, const off_t* last, unsigned num, http_response_t* resp);
+static void build_error(http_response_t* resp, unsigned status);
+static int queue_response(http_request_t* rq, http_response_t* resp);
+static void serve_connection(void* http_request);
+static ssize_t read_request(http_request_t* rq, size_t remain);
+static void wait_event(http_request_t* rq, unsigned events);
+static int send_output(http_request_t* rq);
+static void serve_error(http_request_t* rq, http_response_t* resp, unsigned status);
 
 /*
  * 对已连接描述符的事件进行初始化。
@@ -89,8 +122,9 @@ int http_init_connection(int connfd, epoll_t* epoll, config_t* config) {
 }
 /*
  * 创建监听描述符。
+ * reuseport 非 0 时设置 SO_REUSEPORT ，允许多个事件循环各自绑定同一端口，由内核分发连接。
  */
-int create_listenfd(unsigned short port) {
+int create_listenfd(unsigned short port, int reuseport) {
     int listenfd;
     int optval;
     struct sockaddr_in servaddr;
@@ -101,12 +135,22 @@ int create_listenfd(unsigned short port) {
         return -1;
     }
 
+    optval = 1;
+
     /* 设置 SO_REUSEADDR 关闭服务端的 TIME_WAIT */
     if (setsockopt(listenfd, SOL_SOCKET, SO_REUSEADDR, (const void *)&optval , sizeof(int)) < 0) {
         log_error("set listenfd reuse adress error.");
+        close(listenfd);
 	    return -1;
     }
 
+    /* 设置 SO_REUSEPORT ，每个事件循环拥有独立的监听描述符 */
+    if (reuseport && setsockopt(listenfd, SOL_SOCKET, SO_REUSEPORT, (const void *)&optval , sizeof(int)) < 0) {
+        log_error("set listenfd reuse port error.");
+        close(listenfd);
+        return -1;
+    }
+
     /* 设置地址与端口号 */
     bzero(&servaddr, sizeof(servaddr));
     servaddr.sin_family = AF_INET;
@@ -116,12 +160,14 @@ int create_listenfd(unsigned short port) {
     /* 绑定地址与端口号 */
     if (bind(listenfd, (struct sockaddr*)&servaddr, sizeof(servaddr)) < 0) {
         log_error("bind error.");
+        close(listenfd);
         return -1;
     }
 
     /* 将描述符设置为监听描述符 */
     if (listen(listenfd, BACKLOG) < 0) {
         log_error("listen error.");
+        close(listenfd);
         return -1;
     }
 
@@ -130,190 +176,285 @@ int create_listenfd(unsigned short port) {
 
 /*
  * 执行请求。
+ * 每个连接的请求在自己的协程中执行，读写遇到 EAGAIN 时协程挂起，连接改为监听协程等待的事件，
+ * 事件就绪后再次执行到这里时恢复协程。协程返回表示需要关闭连接。
  */
 void* execute_request(void* http_request) {
     http_request_t* rq;
-    http_headers_out_t* out;
     struct epoll_event epev;
-    char filename[MAXLINE] = {'\0'};
-    struct stat statbuf;
-    size_t remain;
-    ssize_t size;
-    int ret;
 
     rq = (http_request_t*)http_request;
 
-    if ((out = http_headers_out_init()) == NULL) {
-        log_error("http_headers_out_t init failed.");
+    delete_timer((void*)rq);
+
+    if (rq->co == NULL && (rq->co = coroutine_create(serve_connection, (void*)rq)) == NULL) {
+        log_error("create coroutine failed.");
+        http_close_connection(rq);
         return NULL;
     }
 
-    delete_timer((void*)rq);
+    if (coroutine_resume(rq->co) == COROUTINE_DEAD) {
+        coroutine_free(rq->co);
+        rq->co = NULL;
 
-    for ( ;; ) {
-        remain = &(rq->buf[BUF_SIZE - 1]) - rq->bufed;
+        /* 协程因连接空闲而退出时连接继续等待下一个请求，届时再创建协程，否则关闭连接 */
+        if (!rq->idle) {
+            http_close_connection(rq);
+            return NULL;
+        }
 
-        if (remain <= 0) {
-            serve_error(rq, HTTP_BAD_REQUEST);
+        rq->idle = 0;
+        rq->wait_events = EPOLLIN;
+    }
 
-            goto close;
-        }
+    /* 协程挂起后才能重新监听，否则其他线程可能在协程挂起之前就恢复它 */
+    /* 先定时再监听，避免事件先于定时器被处理 */
+    add_timer((void*)rq, rq->timeout, http_close_connection);
 
-        size = rio_readn(rq->fd, rq->bufed, &remain);
-
-        /* size 返回 -1 */
-        /* 1. 读到 EAGAIN ，所读字节数作为值-结果参数返回 */
-        /* 2. 其他 errno ，出错 */
-
-        /* size 返回大于等于 0 */
-        /* 3. 读到 EOF 返回不足值 */
-        /* 4. 读到 EOF 返回 0 */
-        /* 5. 没读到 EOF 返回所读的值，此时缓冲区已满 */
-        if (size < 0) {
-            if (errno != EAGAIN) {
-                log_error("read error.");
-                serve_error(rq, HTTP_INTERNAL_SERVER_ERROR);
-                
-                goto close;
-            }
-            
-            if (remain == 0) {
-                break;
-            }
+    epev.data.ptr = (void*)rq;
+    epev.events = rq->wait_events | EPOLLET | EPOLLONESHOT;
+    epoll_modify_fd((epoll_t*)rq->epoll, rq->fd, &epev);
 
-            rq->bufed += remain;
-        } else if (size == 0) {
-            goto close;
-        } else {
-            rq->bufed += size;
-        }
+    return NULL;
+}
 
-        /* 解析请求头，直到出错或完成 */
-        if ((ret = rq->handler(rq)) == REQUEST_AGAIN) {
-            if (size > 0 && size < remain) {
-                goto close;
-            }
+/*
+ * 过载时拒绝请求：发送预先构造好的 503 响应并关闭连接。
+ */
+void* http_shed_request(void* http_request) {
+    http_request_t* rq;
+    char drain[1024];
+    ssize_t n;
 
-            continue;
-        } else if (ret != REQUEST_OK) {
-            serve_error(rq, HTTP_BAD_REQUEST);
-            
-            goto close;
-        }
+    rq = (http_request_t*)http_request;
 
-        /* TODO: CGI&POST */
-        if (rq->method != HTTP_GET && rq->method != HTTP_HEAD) {
-            serve_error(rq, HTTP_NOT_IMPLEMENTED);
+    delete_timer((void*)rq);
 
-            goto close;
-        }
+    /* 正在发送响应的连接不能再插入 503 ，直接关闭 */
+    if (!http_output_empty(rq)) {
+        http_close_connection(rq);
+        return NULL;
+    }
 
-        /* http 版本号超过 1.1 则不支持 */
-        if (rq->http_version_major * 1000 + rq->http_version_minor > 1001) {
-            serve_error(rq, HTTP_VERSION_NOT_SUPPORTED);
+    /* 先读走已到达的请求，避免带着未读数据关闭连接时内核发送 RST 导致客户端收不到 503 */
+    do {
+        n = read(rq->fd, drain, sizeof(drain));
+    } while (n > 0);
 
-            goto close;
-        }
+    /* 非阻塞套接字上只尝试写一次，写不完也直接关闭 */
+    if (write(rq->fd, overload_response, sizeof(overload_response) - 1) < 0) {
+        log_error("write error.");
+    }
 
-        memset(filename, 0, sizeof(filename));
-        parse_uri(rq, filename);
+    http_close_connection(rq);
 
-        /* 没找到改文件，返回 404 */
-        if (stat(filename, &statbuf) != 0) {
-            serve_error(rq, HTTP_NOT_FOUND);
+    return NULL;
+}
 
-            goto close;
-        }
+/*
+ * 关闭连接并释放内存。
+ */
+int http_close_connection(void* http_request) {
+    http_request_t* rq;
+
+    rq = (http_request_t*) http_request;
+    
+    close(rq->fd);
 
-        /* 权限不够，返回 403 */
-        if (!S_ISREG(statbuf.st_mode) || !(statbuf.st_mode & S_IRUSR)) {
-            serve_error(rq, HTTP_FORBIDDEN);
+    http_request_destroy(rq);
 
-            goto close;
-        }
+    log_info("connection closed.");
 
-        out->keep_alive = 0;
-        out->if_modified = 0;
-        out->if_unmodified = 0;
-        out->status = 0;
-        out->mtime = statbuf.st_mtime;
-
-        /* 分析首部字段 */
-        if (http_analyze_headers(rq, out) != 0) {
-            log_error("analyze headers failed.");
-            serve_error(rq, HTTP_INTERNAL_SERVER_ERROR);
-            
-            goto close;
-        }
+    return 0;
+}
 
-        if (out->if_modified == 2) {
-            serve_error(rq, HTTP_NOT_MODIFIED);
+/*
+ * 请求解析完毕后生成响应，包括检查方法与版本、查找文件、分析首部字段与生成响应头部。
+ * 出错时生成相应的错误响应，此时 resp->keep_alive 为 0 。
+ */
+int http_prepare_response(http_request_t* rq, http_headers_out_t* out, http_response_t* resp) {
+    char filename[MAXLINE] = {'\0'};
+    off_t first[HTTP_RANGES_MAX];
+    off_t last[HTTP_RANGES_MAX];
+    http_cached_t* cached;
+    http_file_t* file;
+    unsigned status;
+    unsigned num;
+
+    /* TODO: CGI&POST */
+    if (rq->method != HTTP_GET && rq->method != HTTP_HEAD) {
+        http_prepare_error(rq, resp, HTTP_NOT_IMPLEMENTED);
+        return 0;
+    }
 
-            goto close;
-        }
+    /* http 版本号超过 1.1 则不支持 */
+    if (rq->http_version_major * 1000 + rq->http_version_minor > 1001) {
+        http_prepare_error(rq, resp, HTTP_VERSION_NOT_SUPPORTED);
+        return 0;
+    }
 
-        if (out->if_unmodified) {
-            serve_error(rq, HTTP_PRECONDITION_FAILED);
+    if (parse_uri(rq, filename) != 0) {
+        http_prepare_error(rq, resp, HTTP_BAD_REQUEST);
+        return 0;
+    }
 
-            goto close;
-        }
+    /* 从打开文件缓存中获取文件，没找到返回 404 ，不是普通文件或权限不够返回 403 */
+    if ((status = http_file_get(filename, &file)) != HTTP_OK) {
+        http_file_release(file);
+        http_prepare_error(rq, resp, status);
+        return 0;
+    }
 
-        if (out->status == 0) {
-            out->status = HTTP_OK;
-        }
+    /* HTTP/1.1 默认保持连接， HTTP/1.0 只在请求 keep-alive 时保持，随后由 Connection 首部修改 */
+    out->keep_alive = rq->http_version_major > 1 || (rq->http_version_major == 1 && rq->http_version_minor >= 1);
+    out->if_modified = 0;
+    out->if_unmodified = 0;
+    out->if_range = 0;
+    out->status = 0;
+    out->mtime = file->mtime;
+    out->last_modified = file->last_modified;
+    out->range_start = NULL;
+    out->range_end = NULL;
+
+    /* 分析首部字段 */
+    if (http_analyze_headers(rq, out) != 0) {
+        log_error("analyze headers failed.");
+        http_file_release(file);
+        http_prepare_error(rq, resp, HTTP_INTERNAL_SERVER_ERROR);
+        return 0;
+    }
+
+    if (out->if_modified == 2) {
+        http_file_release(file);
+        http_prepare_error(rq, resp, HTTP_NOT_MODIFIED);
+        return 0;
+    }
+
+    if (out->if_unmodified) {
+        http_file_release(file);
+        http_prepare_error(rq, resp, HTTP_PRECONDITION_FAILED);
+        return 0;
+    }
 
-        /* 发送静态文件 */
-        serve_static(rq, out, filename, statbuf.st_size);
+    if (out->status == 0) {
+        out->status = HTTP_OK;
+    }
+
+    resp->keep_alive = out->keep_alive;
 
-        if (!out->keep_alive) {
-            goto close;
+    /* 区间请求，带 If-Range 时文件变化了则忽略 Range 发送整个文件；区间响应不经过响应缓存 */
+    if (out->range_start && out->if_range != 2) {
+        status = http_range_parse(out->range_start, out->range_end, file->size, first, last, &num);
+
+        if (status == HTTP_RANGE_NOT_SATISFIABLE) {
+            http_prepare_error(rq, resp, status);
+            http_range_content_range(resp, -1, -1, file->size);
+            http_file_release(file);
+            return 0;
         }
 
-        if (size > 0 && size < remain) {
-            goto close;
+        if (status == HTTP_PARTIAL_CONTENT) {
+            build_range_response(rq, out, file, first, last, num, resp);
+            return 0;
         }
+    }
 
-        /* 长连接处理第二个请求， HTTP/1.1 请求不会并行执行 */
-        rq->bufst = &(rq->buf[0]);
-        rq->bufed = &(rq->buf[0]);
-        
+    /* 小文件的完整响应可能已在缓存中，带 Last-Modified 的条件请求的响应不缓存 */
+    if (rq->method == HTTP_GET && !out->if_modified &&
+        (cached = http_response_cache_get(file, out->keep_alive, rq->timeout)) != NULL) {
+        http_file_release(file);
+        use_cached_response(resp, cached);
+        return 0;
     }
 
-    /* 当前读完，但是没有关闭连接（返回 EAGAIN） */
-    /* 则需要再次设置 epoll 监听（边缘触发） */
-    epev.data.ptr = (void*)rq;
-    epev.events = EPOLLIN | EPOLLET | EPOLLONESHOT;
-    epoll_modify_fd((epoll_t*)rq->epoll, rq->fd, &epev);
+    build_headers(rq, out, file->mime, file->size, 0, resp);
 
-    /* 再次定时 */
-    add_timer((void*)rq, rq->timeout, http_close_connection);
-    
-    http_headers_out_destroy(out);
-    
-    return NULL;
+    /* 未命中时由生成的头部与文件内容生成缓存条目，本次响应也直接使用它 */
+    if (rq->method == HTTP_GET && !out->if_modified &&
+        (cached = http_response_cache_put(file, out->keep_alive, rq->timeout, resp->headers, resp->headers_len,
+                                          resp->date_off)) != NULL) {
+        http_file_release(file);
+        use_cached_response(resp, cached);
+        return 0;
+    }
 
-close:
+    /* 响应体为静态文件 */
+    resp->body = NULL;
+    resp->body_len = 0;
+    resp->cached = NULL;
+    resp->file = file;
+    resp->file_off = 0;
+    resp->file_len = file->size;
+    resp->part_num = 0;
 
-    /* 关闭连接 */
-    http_close_connection(rq);
-    http_headers_out_destroy(out);
+    return 0;
+}
 
-    return NULL;
+/*
+ * 生成状态码为 status 的错误响应，响应体为简单的错误页面，发送后关闭连接。
+ */
+void http_prepare_error(http_request_t* rq, http_response_t* resp, unsigned status) {
+    http_error_page_t* page;
+
+    if (status >= HTTP_STATUS_MAX || (page = error_pages[status]) == NULL) {
+        build_error(resp, status);
+    } else {
+        /* 复制预先生成的头部并写入当前的 Date 头部行，错误页面直接引用 */
+        memcpy(resp->headers, page->data, page->headers_len);
+        memcpy(resp->headers + page->date_off, current_http_date(), HTTP_DATE_LINE_LEN);
+
+        resp->headers_len = page->headers_len;
+        resp->date_off = page->date_off;
+        resp->body = page->data + page->headers_len;
+        resp->body_len = page->body_len;
+    }
+
+    resp->cached = NULL;
+    resp->file = NULL;
+    resp->file_off = 0;
+    resp->file_len = 0;
+    resp->part_num = 0;
+    resp->keep_alive = 0;
 }
 
 /*
- * 关闭连接并释放内存。
+ * 为每个有原因短语的状态码预先生成错误响应，应在启动工作线程之前调用。
+ * 成功返回 0 ，失败返回 -1 。
  */
-int http_close_connection(void* http_request) {
-    http_request_t* rq;
+int http_init_error_pages() {
+    http_response_t* resp;
+    http_error_page_t* page;
+    unsigned status;
+
+    /* 响应结构体较大，不放在栈上 */
+    if ((resp = (http_response_t*)malloc(sizeof(http_response_t))) == NULL) {
+        log_error("http_response_t malloc failed.");
+        return -1;
+    }
 
-    rq = (http_request_t*) http_request;
-    
-    close(rq->fd);
+    for (status = 100; status < HTTP_STATUS_MAX; ++ status) {
+        if (http_status_reason(status)[0] == '\0') {
+            continue;
+        }
 
-    http_request_destroy(rq);
+        build_error(resp, status);
 
-    log_info("connection closed.");
+        if ((page = (http_error_page_t*)malloc(sizeof(http_error_page_t) + resp->headers_len + resp->body_len)) == NULL) {
+            log_error("http_error_page_t malloc failed.");
+            free(resp);
+            return -1;
+        }
+
+        memcpy(page->data, resp->headers, resp->headers_len);
+        memcpy(page->data + resp->headers_len, resp->body, resp->body_len);
+        page->headers_len = resp->headers_len;
+        page->date_off = resp->date_off;
+        page->body_len = resp->body_len;
+
+        error_pages[status] = page;
+    }
+
+    free(resp);
 
     return 0;
 }
@@ -329,6 +470,11 @@ static unsigned parse_uri(http_request_t* rq, char* filename) {
     } else {
         len = rq->uri_end - rq->uri_start + 1;
 
+        /* 请求行可以长于 MAXLINE ，文件名放不下（包括可能追加的默认文件）时视为错误请求 */
+        if (strlen(rq->root) + len + (rq->defile ? strlen(rq->defile) : strlen("index.html")) >= MAXLINE) {
+            return HTTP_BAD_REQUEST;
+        }
+
         strcpy(filename, rq->root);
         strncat(filename, rq->uri_start, len);
 
@@ -354,192 +500,372 @@ static unsigned parse_uri(http_request_t* rq, char* filename) {
 }
 
 /*
- * 发送响应头部。
+ * 生成响应头部，保存至 resp->headers ，并设置头部长度与 Date 头部行的偏移。
+ * out 为 NULL 时生成状态码为 errstatus 、发送后关闭连接的错误响应头部，此时不使用 rq 。
  */
-static int serve_headers(http_request_t* rq, http_headers_out_t* out, char* mime_type, off_t length, unsigned errstatus) {
-    char headers[MAXMSG] = { '\0' };
-    char buf[MAXLINE] = { '\0' };
-    struct tm tm;
-    time_t now;
-    size_t size;
+static void build_headers(http_request_t* rq, http_headers_out_t* out, const char* mime_type, off_t length,
+                          unsigned errstatus, http_response_t* resp) {
+    http_builder_t b;
 
-    if (out == NULL) {
-        sprintf(headers, "%s %u %s\r\n", PROTOCOL, errstatus, get_shortmsg(errstatus));
+    http_builder_init(&b, resp->headers, MAXMSG);
 
-        sprintf(headers, "%sServer: %s\r\n", headers, SERVER_NAME);
+    http_builder_status_line(&b, out ? out->status : errstatus);
+    http_builder_literal(&b, "Server: " SERVER_NAME "\r\n");
+    resp->date_off = http_builder_len(&b);
+    http_builder_append(&b, current_http_date(), HTTP_DATE_LINE_LEN);
 
-        now = time((time_t *)0);
-        strftime(buf, MAXLINE, "%a, %d %b %Y %H:%M:%S GMT", gmtime(&now));
-        sprintf(headers, "%sDate: %s\r\n", headers, buf);
+    if (out && out->keep_alive) {
+        http_builder_literal(&b, "Connection: keep-alive\r\n");
+        http_builder_keep_alive(&b, rq->timeout);
+    } else {
+        http_builder_literal(&b, "Connection: close\r\n");
+    }
 
-        sprintf(headers, "%sConnection: close\r\n", headers);
+    /* 静态文件支持区间请求 */
+    if (out) {
+        http_builder_literal(&b, "Accept-Ranges: bytes\r\n");
+    }
 
-        if (mime_type) {
-            sprintf(headers, "%sContent-type: %s\r\n", headers, mime_type);
-        }
+    if (mime_type) {
+        http_builder_literal(&b, "Content-type: ");
+        http_builder_str(&b, mime_type);
+        http_builder_literal(&b, "\r\n");
+    }
 
-        if (length >= 0) {
-            sprintf(headers, "%sContent-length: %lld\r\n", headers, (long long)length);
-        }
+    if (length >= 0) {
+        http_builder_literal(&b, "Content-length: ");
+        http_builder_uint(&b, length);
+        http_builder_literal(&b, "\r\n");
+    }
 
-        sprintf(headers, "%s\r\n", headers);
-    } else {
-        sprintf(headers, "%s %u %s\r\n", PROTOCOL, out->status, get_shortmsg(out->status));
+    if (out && out->if_modified) {
+        http_builder_append(&b, out->last_modified, HTTP_LAST_MODIFIED_LEN);
+    }
 
-        sprintf(headers, "%sServer: %s\r\n", headers, SERVER_NAME);
+    http_builder_literal(&b, "\r\n");
 
-        now = time((time_t *)0);
-        strftime(buf, MAXLINE, "%a, %d %b %Y %H:%M:%S GMT", gmtime(&now));
-        sprintf(headers, "%sDate: %s\r\n", headers, buf);
+    if (b.overflow) {
+        log_error("response headers overflow.");
+    }
 
-        if (out->keep_alive) {
-            sprintf(headers, "%sConnection: keep-alive\r\n", headers);
-            sprintf(headers, "%sKeep-Alive: timeout=%lu\r\n", headers, rq->timeout);
-        }
+    resp->headers_len = http_builder_len(&b);
+}
 
-        if (mime_type) {
-            sprintf(headers, "%sContent-type: %s\r\n", headers, mime_type);
-        }
+/*
+ * 以缓存的完整响应作为响应：复制头部并写入当前的 Date 头部行，响应体直接引用缓存条目，条目的引用转交给响应。
+ * 缓存中的头部被多个线程同时发送，不能原地修改日期。
+ */
+static void use_cached_response(http_response_t* resp, http_cached_t* cached) {
+    memcpy(resp->headers, cached->data, cached->headers_len);
+    memcpy(resp->headers + cached->date_off, current_http_date(), HTTP_DATE_LINE_LEN);
+
+    resp->headers_len = cached->headers_len;
+    resp->date_off = cached->date_off;
+    resp->body = cached->data + cached->headers_len;
+    resp->body_len = cached->body_len;
+    resp->cached = cached;
+    resp->file = NULL;
+    resp->file_off = 0;
+    resp->file_len = 0;
+    resp->part_num = 0;
+}
 
-        if (length >= 0) {
-            sprintf(headers, "%sContent-length: %lld\r\n", headers, (long long)length);
-        }
+/*
+ * 生成区间响应，文件的引用转交给响应。
+ * 单个区间时响应体为文件的该区间；多个区间时响应体为 multipart/byteranges ，
+ * 各部分的分隔行与部分头部写入 resp->page ，文件区间由 I/O 后端直接从文件发送。
+ */
+static void build_range_response(http_request_t* rq, http_headers_out_t* out, http_file_t* file,
+                                 const off_t* first, const off_t* last, unsigned num, http_response_t* resp) {
+    char boundary[sizeof("multipart/byteranges; boundary=") + 20];
+    const char* delimiter;
+    off_t length;
+
+    out->status = HTTP_PARTIAL_CONTENT;
+
+    resp->body = NULL;
+    resp->body_len = 0;
+    resp->cached = NULL;
+    resp->file = file;
+
+    if (num == 1) {
+        build_headers(rq, out, file->mime, last[0] - first[0] + 1, 0, resp);
+        http_range_content_range(resp, first[0], last[0], file->size);
+
+        resp->file_off = first[0];
+        resp->file_len = last[0] - first[0] + 1;
+        resp->part_num = 0;
+        return;
+    }
 
-        if (out->if_modified) {
-            localtime_r(&(out->mtime), &tm);
-            strftime(buf, MAXLINE, "%a, %d %b %Y %H:%M:%S GMT", &tm);
-            sprintf(headers, "%sLast-Modified: %s\r\n", headers, buf);
-        }
+    /* 分隔符为 20 位数字，打散序号使相邻响应的分隔符差别较大 */
+    snprintf(boundary, sizeof(boundary), "multipart/byteranges; boundary=%020lu",
+             __atomic_add_fetch(&boundary_seq, 1, __ATOMIC_RELAXED) * 0x9e3779b97f4a7c15ul);
+    delimiter = boundary + sizeof("multipart/byteranges; boundary=") - 1;
 
-        sprintf(headers, "%s\r\n", headers);
-    }
+    length = http_range_multipart(resp, delimiter, file->mime, file->size, first, last, num);
 
-    size = rio_writen(rq->fd, headers, strlen(headers));
+    resp->file_off = 0;
+    resp->file_len = 0;
 
-    if (size < 0) {
-        log_error("send headers error.");
-        return -1;
-    }
+    build_headers(rq, out, boundary, length, 0, resp);
+}
 
-    return 0;
+/*
+ * 生成状态码为 status 的错误页面与发送后关闭连接的错误响应头部。
+ */
+static void build_error(http_response_t* resp, unsigned status) {
+    http_builder_t b;
+
+    http_builder_init(&b, resp->page, MAXMSG);
+
+    http_builder_literal(&b, "<html><head><title>");
+    http_builder_uint(&b, status);
+    http_builder_literal(&b, " ");
+    http_builder_str(&b, http_status_reason(status));
+    http_builder_literal(&b, "</title></head><body bgcolor=\"LightSkyBlue\" align=\"center\"><h1>");
+    http_builder_uint(&b, status);
+    http_builder_literal(&b, " ");
+    http_builder_str(&b, http_status_reason(status));
+    http_builder_literal(&b, "</h1><hr><em>" SERVER_NAME "</em></body></html>");
+
+    resp->body = resp->page;
+    resp->body_len = http_builder_len(&b);
+    build_headers(NULL, NULL, "text/html; charset=UTF-8", resp->body_len, status, resp);
 }
 
 /*
- * 发送静态文件。
+ * 将响应追加到输出队列：头部与内存中的响应体复制到同一个缓冲区，缓存的响应体直接引用，
+ * 静态文件作为文件区间，发送时由 http_output_flush 合并为一次 writev 。
+ * 成功返回 REQUEST_OK ，失败返回 REQUEST_ERROR 。
  */
-static int serve_static(http_request_t* rq, http_headers_out_t* out, char* filename, off_t length) {
-    int srcfd;
-    char* srcaddr;
-    size_t size;
+static int queue_response(http_request_t* rq, http_response_t* resp) {
+    struct iovec iov[2];
+    http_part_t* part;
+    unsigned i;
+
+    iov[0].iov_base = resp->headers;
+    iov[0].iov_len = resp->headers_len;
+    iov[1].iov_base = (void*)resp->body;
+    iov[1].iov_len = resp->cached ? 0 : resp->body_len;
+
+    if (http_output_bufv(rq, iov, 2) != 0) {
+        http_cached_release(resp->cached);
+        http_file_release(resp->file);
+        return REQUEST_ERROR;
+    }
 
-    serve_headers(rq, out, get_mime_type(filename), length, 0);
+    /* 缓存条目的引用转交给输出队列 */
+    if (resp->cached && http_output_cached(rq, resp->cached, resp->body, resp->body_len) != 0) {
+        http_file_release(resp->file);
+        return REQUEST_ERROR;
+    }
 
-    if ((srcfd = open(filename, O_RDONLY, 0)) <= 2) {
-        log_error("open file error.");
-        return -1;
+    rq->output_close = !resp->keep_alive;
+
+    /* 多个区间：各部分的分隔行复制到输出队列，文件区间各持有一个文件的引用 */
+    for (i = 0; i < resp->part_num; ++ i) {
+        part = &(resp->parts[i]);
+
+        if (http_output_buf(rq, resp->page + part->head_off, part->head_len) != 0 ||
+            (part->file_len > 0 &&
+             http_output_file(rq, http_file_hold(resp->file), part->file_off, part->file_len) != 0)) {
+            http_file_release(resp->file);
+            return REQUEST_ERROR;
+        }
     }
 
-    /* 将文件映射到虚拟地址空间，不用将文件先读到用户态，高效读取文件 */
-    if ((srcaddr = mmap(NULL, length, PROT_READ, MAP_PRIVATE, srcfd, 0)) == (void*)-1) {
-        log_error("mmap error.");
-        close(srcfd);
-        return -1;
+    if (resp->file == NULL || resp->file_len == 0) {
+        http_file_release(resp->file);
+        return REQUEST_OK;
     }
-    
-    close(srcfd);
 
-    if ((size = rio_writen(rq->fd, srcaddr, length)) < 0) {
-        log_error("write error.");
-        munmap(srcaddr, length);
-        return -1;
+    /* 文件的引用转交给输出队列 */
+    if (http_output_file(rq, resp->file, resp->file_off, resp->file_len) != 0) {
+        return REQUEST_ERROR;
     }
 
-    munmap(srcaddr, length);
+    return REQUEST_OK;
+}
 
-    return 0;
+/*
+ * 连接的协程函数：循环读取、解析请求并发送响应。
+ * 流水线上的请求逐个解析，响应依次追加到输出队列，缓冲区中没有完整的请求时再一并发送，
+ * 多个响应由 http_output_flush 合并为一次 writev 。
+ * 两个请求之间没有任何数据时置 rq->idle 并返回，连接空闲期间不占用协程栈与读缓冲区；其余情况返回时关闭连接。
+ */
+static void serve_connection(void* http_request) {
+    http_request_t* rq;
+    http_headers_out_t out;
+    http_response_t resp;
+    unsigned batched;
+    unsigned pending;
+    size_t remain;
+    ssize_t size;
+    int ret;
 
+    rq = (http_request_t*)http_request;
+    batched = 0;
+    pending = 0;
+
+    for ( ;; ) {
+        /* 从缓冲区缓存中取缓冲区很便宜，所以直接挂上缓冲区读取，不必先 MSG_PEEK 探测 */
+        if (http_request_attach_buffer(rq) != 0) {
+            return;
+        }
+
+        /* 上一个请求之后缓冲区中还有数据时先解析，解析不出完整的请求再读 */
+        if (!pending) {
+            /* 当前缓冲区已满而请求头部尚未结束时追加大缓冲区，超过 large_header_buffers 时返回 400 */
+            if (rq->bufed == rq->buflast && http_request_grow_buffer(rq) != 0) {
+                serve_error(rq, &resp, HTTP_BAD_REQUEST);
+                return;
+            }
+
+            remain = rq->buflast - rq->bufed;
+
+            if ((size = read_request(rq, remain)) == REQUEST_AGAIN) {
+                /* 等待数据之前先发送已生成的响应，客户端收到响应后才会发送后续的请求 */
+                if (!http_output_empty(rq)) {
+                    batched = 0;
+
+                    if (send_output(rq) != REQUEST_OK) {
+                        return;
+                    }
+
+                    continue;
+                }
+
+                /* 两个请求之间没有任何数据时归还缓冲区并退出协程 */
+                http_request_release_buffer(rq);
+
+                if (rq->buffer == NULL) {
+                    rq->idle = 1;
+                    return;
+                }
+
+                wait_event(rq, EPOLLIN);
+                continue;
+            }
+
+            if (size == REQUEST_ERROR) {
+                serve_error(rq, &resp, HTTP_INTERNAL_SERVER_ERROR);
+                return;
+            }
+
+            /* 对端关闭连接，已生成的响应照常发送 */
+            if (size == 0) {
+                send_output(rq);
+                return;
+            }
+
+            rq->bufed += size;
+        }
+
+        /* 解析请求头，直到出错或完成 */
+        if ((ret = rq->handler(rq)) == REQUEST_AGAIN) {
+            pending = 0;
+            continue;
+        } else if (ret != REQUEST_OK) {
+            serve_error(rq, &resp, HTTP_BAD_REQUEST);
+            return;
+        }
+
+        /* 生成响应并追加到输出队列 */
+        http_prepare_response(rq, &out, &resp);
+
+        if (queue_response(rq, &resp) != REQUEST_OK) {
+            return;
+        }
+
+        /* 长连接处理下一个请求，缓冲区中尚未解析的数据移动到缓冲区开头 */
+        http_request_reset(rq);
+
+        /* 缓冲区中还有数据时先解析下一个请求，本批未满时响应留在输出队列中稍后一并发送 */
+        pending = rq->bufst != rq->bufed;
+
+        if (!rq->output_close && pending && ++ batched < HTTP_PIPELINE_MAX) {
+            continue;
+        }
+
+        batched = 0;
+
+        if (send_output(rq) != REQUEST_OK) {
+            return;
+        }
+    }
 }
 
 /*
- * 发送错误信息。
+ * 读取请求追加到缓冲区，最多读 remain 字节。
+ * 返回读到的字节数，对端关闭返回 0 ，暂时没有数据返回 REQUEST_AGAIN ，出错返回 REQUEST_ERROR 。
+ * errno 只在这里读取，不能内联到协程函数中。
  */
-static int serve_error(http_request_t* rq, unsigned status) {
-    char body[MAXMSG] = { '\0' };
-    int length;
+static __attribute__((noinline)) ssize_t read_request(http_request_t* rq, size_t remain) {
+    ssize_t n;
 
-    sprintf(body, "<html><head>");
-    sprintf(body, "%s<title>%d %s</title></head>", body, status, get_shortmsg(status));
-    sprintf(body, "%s<body bgcolor=\"LightSkyBlue\" align=\"center\">", body);
-    sprintf(body, "%s<h1>%d %s</h1><hr>", body, status, get_shortmsg(status));
-    sprintf(body, "%s<em>%s</em>", body, SERVER_NAME);
-    sprintf(body, "%s</body></html>", body);
+    for ( ;; ) {
+        if ((n = read(rq->fd, rq->bufed, remain)) >= 0) {
+            return n;
+        }
 
-    length = strlen(body);
+        if (errno == EINTR) {
+            continue;
+        }
 
-    serve_headers(rq, NULL, "text/html; charset=UTF-8", length, status);
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            return REQUEST_AGAIN;
+        }
 
-    if (rio_writen(rq->fd, body, length) < 0) {
-        log_error("write error.");
-        return -1;
+        log_error("read error.");
+        return REQUEST_ERROR;
     }
+}
 
-    return 0;
+/*
+ * 挂起协程，等待连接上的 events 事件就绪。
+ */
+static void wait_event(http_request_t* rq, unsigned events) {
+    rq->wait_events = events;
+    coroutine_yield(rq->co);
 }
 
 /*
- * 通过状态码获取短消息。
+ * 发送输出队列直到全部发送完毕，套接字写满或达到单次发送上限时挂起等待可写。
+ * 全部发送完毕且连接保持时返回 REQUEST_OK ，需要关闭连接时返回 REQUEST_ERROR 。
  */
-static char* get_shortmsg(unsigned status) {
-    switch (status) {
-    case HTTP_CONTINUE:
-        return "Continue";
-
-    case HTTP_OK:
-        return "OK";
-
-    case HTTP_MOVED_PERMANENTLY:
-        return "Moved Permanently";
-
-    case HTTP_MOVED_TEMPORARILY:
-        return "Found";
-        
-    case HTTP_NOT_MODIFIED:
-        return "Not Modified";
-        
-    case HTTP_BAD_REQUEST:
-        return "Bad Request";
-        
-    case HTTP_FORBIDDEN:
-        return "Forbidden";
-        
-    case HTTP_NOT_FOUND:
-        return "Not Found";
-    
-    case HTTP_PRECONDITION_FAILED:
-        return "Precondition Failed";
-        
-    case HTTP_INTERNAL_SERVER_ERROR:
-        return "Internal Server Error";
+static int send_output(http_request_t* rq) {
+    int ret;
 
-    case HTTP_NOT_IMPLEMENTED:
-        return "Not Implemented";
+    while ((ret = http_output_flush(rq)) == REQUEST_AGAIN) {
+        wait_event(rq, EPOLLOUT);
+    }
 
-    case HTTP_VERSION_NOT_SUPPORTED:
-        return "HTTP Version not supported";
-    
-    default:
-        break;
+    if (ret != REQUEST_OK || rq->output_close) {
+        return REQUEST_ERROR;
     }
 
-    return "";
+    return REQUEST_OK;
+}
+
+/*
+ * 发送错误信息，发送完毕后由调用者关闭连接。
+ * resp 使用 serve_connection 栈上的响应，协程栈上不再放第二个 http_response_t 。
+ */
+static void serve_error(http_request_t* rq, http_response_t* resp, unsigned status) {
+    http_prepare_error(rq, resp, status);
+
+    if (queue_response(rq, resp) == REQUEST_OK) {
+        send_output(rq);
+    }
 }
 
 /*
  * 通过文件名获取文件类型。
  */
-static char* get_mime_type(char* filename) {
-    char* suffix;
-    mime_type_t* it;
+const char* http_mime_type(const char* filename) {
+    const char* suffix;
+    const mime_type_t* it;
 
     suffix = strrchr(filename, '.');
 
@@ -8,6 +8,11 @@
 
 #include "config.h"
 #include "epoll.h"
+#include "http_file_cache.h"
+#include "http_request.h"
+#include "http_response_cache.h"
+
+#include <sys/types.h>
 
 #define PROTOCOL    "HTTP/1.1"
 #define SERVER_NAME "bohttpd/1.0"
@@ -16,12 +21,45 @@
 #define MAXLINE     512
 #define MAXMSG      4096
 
+#define HTTP_STATUS_MAX     600         /* 状态码的上限，预先生成的错误响应按状态码索引 */
+
+/* 流水线上最多连续解析的请求数，达到后先发送已生成的响应，限制输出队列占用的内存与文件描述符 */
+#define HTTP_PIPELINE_MAX   16
+
+/* 一个请求最多的区间数，超过时忽略 Range 发送整个文件 */
+#define HTTP_RANGES_MAX     16
+
 /* 文件后缀到完整类型的映射 */
 typedef struct {
     char* suffix;   /* 文件后缀 */
     char* type;     /* 文件类型 */
 } mime_type_t;
 
+/* multipart/byteranges 响应体的一部分：分隔行与部分头部，之后是文件的一个区间；最后一部分只有结束分隔行 */
+typedef struct {
+    size_t          head_off;           /* 分隔行与部分头部在 page 中的偏移 */
+    size_t          head_len;           /* 分隔行与部分头部的长度 */
+    off_t           file_off;           /* 文件区间的起始偏移 */
+    off_t           file_len;           /* 文件区间的长度 */
+} http_part_t;
+
+/* 待发送的响应，由 http_prepare_response 或 http_prepare_error 生成，由 I/O 后端发送 */
+typedef struct {
+    char            headers[MAXMSG];    /* 响应头部 */
+    size_t          headers_len;        /* 响应头部长度 */
+    size_t          date_off;           /* Date 头部行在响应头部中的偏移 */
+    char            page[MAXMSG];       /* 错误页面，或多个区间时各部分的分隔行与部分头部 */
+    const char*     body;               /* 内存中的响应体，指向错误页面或缓存的响应 */
+    size_t          body_len;           /* 响应体长度 */
+    http_cached_t*  cached;             /* 响应体所在的缓存条目，持有一个引用， NULL 表示没有 */
+    http_file_t*    file;               /* 作为响应体发送的静态文件，持有一个引用， NULL 表示没有 */
+    off_t           file_off;           /* 作为响应体发送的文件区间的起始偏移 */
+    off_t           file_len;           /* 文件区间的长度 */
+    http_part_t     parts[HTTP_RANGES_MAX + 1]; /* 多个区间时响应体的各部分，由 I/O 后端逐个发送 */
+    unsigned        part_num;           /* 部分数， 0 表示响应体不分部分 */
+    unsigned        keep_alive:1;       /* 发送完毕后是否保持连接 */
+} http_response_t;
+
 /*
  * 对已连接描述符的事件进行初始化。
  */
@@ -29,17 +67,45 @@ int http_init_connection(int connfd, epoll_t* epoll, config_t* config);
 
 /*
  * 创建监听描述符。
+ * reuseport 非 0 时设置 SO_REUSEPORT ，允许多个事件循环各自绑定同一端口，由内核分发连接。
  */
-int create_listenfd(unsigned short port);
+int create_listenfd(unsigned short port, int reuseport);
 
 /*
  * 执行请求。
  */
 void* execute_request(void* http_request);
 
+/*
+ * 过载时拒绝请求：发送预先构造好的 503 响应并关闭连接。
+ */
+void* http_shed_request(void* http_request);
+
 /*
  * 关闭连接并释放内存。
  */
 int http_close_connection(void* http_request);
 
+/*
+ * 请求解析完毕后生成响应，包括检查方法与版本、查找文件、分析首部字段与生成响应头部。
+ * 出错时生成相应的错误响应，此时 resp->keep_alive 为 0 。
+ */
+int http_prepare_response(http_request_t* rq, http_headers_out_t* out, http_response_t* resp);
+
+/*
+ * 生成状态码为 status 的错误响应，响应体为简单的错误页面，发送后关闭连接。
+ */
+void http_prepare_error(http_request_t* rq, http_response_t* resp, unsigned status);
+
+/*
+ * 为每个有原因短语的状态码预先生成错误响应，应在启动工作线程之前调用。
+ * 成功返回 0 ，失败返回 -1 。
+ */
+int http_init_error_pages();
+
+/*
+ * 通过文件名获取文件类型。
+ */
+const char* http_mime_type(const char* filename);
+
 #endif /* _HTTP_H_ */
\ No newline at end of file
@@ -0,0 +1,144 @@
+/**
+ * @author ttoobne
+ * @date 2026/10/17
+ */
+
+#include "http_buffer.h"
+
+#include "log.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+
+#define BUFFER_CLASSES      2           /* 缓存的缓冲区大小种类： BUF_SIZE 与 BUF_LARGE_SIZE */
+
+/* 一种大小的空闲读缓冲区，由没有自己的缓存的线程共用 */
+typedef struct {
+    http_buffer_t*      buffers[BUFFER_CACHE_MAX];
+    int                 num;
+} buffer_cache_t;
+
+static buffer_cache_t   shared_cache[BUFFER_CLASSES];
+static pthread_mutex_t  cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static __thread pool_cache_t* local_cache[BUFFER_CLASSES];  /* 当前线程的缓存，下标同 shared_cache */
+
+static int buffer_class(size_t size);
+
+/*
+ * 为当前线程创建读缓冲区缓存，之后当前线程分配的缓冲区归还到这里。
+ * 只能由不会退出的线程（事件循环线程）调用。成功返回 0 ，失败返回 -1 ，失败时使用共用的缓存。
+ */
+int http_buffer_init_local() {
+    pool_cache_t* cache[BUFFER_CLASSES];
+    int i;
+
+    if (local_cache[0]) {
+        return 0;
+    }
+
+    for (i = 0; i < BUFFER_CLASSES; i ++ ) {
+        if ((cache[i] = pool_cache_create(BUFFER_CACHE_MAX)) == NULL) {
+            while (i -- ) {
+                free(cache[i]);
+            }
+            return -1;
+        }
+    }
+
+    for (i = 0; i < BUFFER_CLASSES; i ++ ) {
+        local_cache[i] = cache[i];
+    }
+
+    return 0;
+}
+
+/*
+ * 分配 data 大小为 size 的读缓冲区， size 为 BUF_SIZE 或 BUF_LARGE_SIZE 时优先使用缓存。失败返回 NULL 。
+ */
+http_buffer_t* http_buffer_alloc(size_t size) {
+    buffer_cache_t* shared;
+    pool_cache_t* owner;
+    http_buffer_t* buffer;
+    int i;
+
+    buffer = NULL;
+    owner = NULL;
+
+    if ((i = buffer_class(size)) >= 0) {
+        if ((owner = local_cache[i]) != NULL) {
+            buffer = (http_buffer_t*)pool_cache_get(owner);
+        } else {
+            shared = &shared_cache[i];
+
+            pthread_mutex_lock(&cache_mutex);
+
+            if (shared->num > 0) {
+                buffer = shared->buffers[ -- shared->num];
+            }
+
+            pthread_mutex_unlock(&cache_mutex);
+        }
+    }
+
+    if (buffer == NULL && (buffer = (http_buffer_t*)malloc(sizeof(http_buffer_t) + size)) == NULL) {
+        log_error("read buffer malloc failed.");
+        return NULL;
+    }
+
+    buffer->node.cache = owner;
+    buffer->next = NULL;
+    buffer->size = size;
+
+    return buffer;
+}
+
+/*
+ * 归还 buffer 及链中所有更早的缓冲区，可以在任意线程调用。
+ */
+void http_buffer_free(http_buffer_t* buffer) {
+    buffer_cache_t* shared;
+    http_buffer_t* next;
+    int i;
+
+    for ( ; buffer; buffer = next) {
+        next = buffer->next;
+
+        if ((i = buffer_class(buffer->size)) >= 0) {
+            if (buffer->node.cache) {
+                /* 归还给分配它的线程，所属线程的缓存已满时释放 */
+                if (pool_cache_put(local_cache[i], &(buffer->node)) == 0) {
+                    continue;
+                }
+            } else {
+                shared = &shared_cache[i];
+
+                pthread_mutex_lock(&cache_mutex);
+
+                if (shared->num < BUFFER_CACHE_MAX) {
+                    shared->buffers[shared->num ++ ] = buffer;
+                    buffer = NULL;
+                }
+
+                pthread_mutex_unlock(&cache_mutex);
+            }
+        }
+
+        free(buffer);
+    }
+}
+
+/*
+ * 获取 size 对应的缓存下标，不缓存的大小返回 -1 。
+ */
+static int buffer_class(size_t size) {
+    if (size == BUF_SIZE) {
+        return 0;
+    }
+
+    if (size == BUF_LARGE_SIZE) {
+        return 1;
+    }
+
+    return -1;
+}
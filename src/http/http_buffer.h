@@ -0,0 +1,48 @@
+/**
+ * @author ttoobne
+ * @date 2026/10/17
+ */
+
+#ifndef _HTTP_BUFFER_H_
+#define _HTTP_BUFFER_H_
+
+#include "pool.h"
+
+#include <stddef.h>
+
+#define BUF_SIZE            1024        /* 连接上第一块读缓冲区的大小 */
+#define BUF_LARGE_SIZE      8192        /* 请求头部放不下时追加的大缓冲区的大小，单个请求行或首部字段不能超过它 */
+#define BUFFER_CACHE_MAX    1024        /* 每个缓存中每种大小最多保留的空闲读缓冲区数 */
+
+/*
+ * 读缓冲区只在连接上有未处理完的数据时才挂在连接上，连接空闲时归还。
+ * 请求头部在第一块缓冲区中放不下时追加大缓冲区，多块缓冲区通过 next 连成链，链头为当前正在读入的缓冲区。
+ * 空闲的缓冲区按大小缓存起来供之后的连接使用，缓存满时才释放。
+ * 事件循环线程各有自己的缓存，缓冲区归还给分配它的线程；没有自己的缓存的线程（线程池中的工作线程）共用一个加锁的缓存。
+ */
+typedef struct http_buffer_s http_buffer_t;
+
+struct http_buffer_s {
+    pool_node_t         node;           /* 缓存中的链接，必须是第一个成员 */
+    http_buffer_t*      next;           /* 链中更早的缓冲区 */
+    size_t              size;           /* data 的大小， BUF_SIZE 或 BUF_LARGE_SIZE */
+    unsigned char       data[];         /* 缓冲区 */
+};
+
+/*
+ * 为当前线程创建读缓冲区缓存，之后当前线程分配的缓冲区归还到这里。
+ * 只能由不会退出的线程（事件循环线程）调用。成功返回 0 ，失败返回 -1 ，失败时使用共用的缓存。
+ */
+int http_buffer_init_local();
+
+/*
+ * 分配 data 大小为 size 的读缓冲区， size 为 BUF_SIZE 或 BUF_LARGE_SIZE 时优先使用缓存。失败返回 NULL 。
+ */
+http_buffer_t* http_buffer_alloc(size_t size);
+
+/*
+ * 归还 buffer 及链中所有更早的缓冲区，可以在任意线程调用。
+ */
+void http_buffer_free(http_buffer_t* buffer);
+
+#endif /* _HTTP_BUFFER_H_ */
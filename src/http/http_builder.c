@@ -0,0 +1,205 @@
+/**
+ * @author ttoobne
+ * @date 2026/10/17
+ */
+
+#include "http_builder.h"
+
+#include "http.h"
+
+#include <string.h>
+
+/* 预先生成的状态行 */
+typedef struct {
+    unsigned            status;         /* 状态码 */
+    const char*         reason;         /* 原因短语 */
+    const char*         line;           /* 完整的状态行 */
+    size_t              len;            /* 状态行长度 */
+} http_status_line_t;
+
+#define http_status_line(status, reason) \
+    { status, reason, PROTOCOL " " #status " " reason "\r\n", sizeof(PROTOCOL " " #status " " reason "\r\n") - 1 }
+
+static const http_status_line_t status_lines[] = {
+    http_status_line(200, "OK"),
+    http_status_line(206, "Partial Content"),
+    http_status_line(304, "Not Modified"),
+    http_status_line(404, "Not Found"),
+    http_status_line(100, "Continue"),
+    http_status_line(301, "Moved Permanently"),
+    http_status_line(302, "Found"),
+    http_status_line(400, "Bad Request"),
+    http_status_line(403, "Forbidden"),
+    http_status_line(412, "Precondition Failed"),
+    http_status_line(416, "Range Not Satisfiable"),
+    http_status_line(500, "Internal Server Error"),
+    http_status_line(501, "Not Implemented"),
+    http_status_line(503, "Service Unavailable"),
+    http_status_line(505, "HTTP Version not supported"),
+    { 0, NULL, NULL, 0 }
+};
+
+static const char week_names[7][4] = { "Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat" };
+static const char month_names[12][4] = {
+    "Jan", "Feb", "Mar", "Apr", "May", "Jun", "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"
+};
+
+/* 最近一次生成的 Keep-Alive 头部行，超时时间取自配置，几乎不变 */
+static __thread char            keep_alive_line[64];
+static __thread size_t          keep_alive_len;
+static __thread unsigned long   keep_alive_timeout = (unsigned long)-1;
+
+static const http_status_line_t* http_find_status(unsigned status);
+static void http_builder_2digits(http_builder_t* b, unsigned n);
+
+/*
+ * 以 size 字节的 buf 初始化构造器。
+ */
+void http_builder_init(http_builder_t* b, char* buf, size_t size) {
+    b->start = buf;
+    b->pos = buf;
+    b->last = buf + size;
+    b->overflow = 0;
+}
+
+/*
+ * 追加 len 字节的 data 。
+ */
+void http_builder_append(http_builder_t* b, const char* data, size_t len) {
+    if (len > (size_t)(b->last - b->pos)) {
+        len = b->last - b->pos;
+        b->overflow = 1;
+    }
+
+    memcpy(b->pos, data, len);
+    b->pos += len;
+}
+
+/*
+ * 追加以 '\0' 结尾的字符串。
+ */
+void http_builder_str(http_builder_t* b, const char* s) {
+    http_builder_append(b, s, strlen(s));
+}
+
+/*
+ * 追加无符号整数的十进制表示。
+ */
+void http_builder_uint(http_builder_t* b, unsigned long long n) {
+    char digits[20];
+    char* p;
+
+    /* 从低位向高位写入临时缓冲区的末尾 */
+    p = digits + sizeof(digits);
+
+    do {
+        *( -- p) = '0' + n % 10;
+        n /= 10;
+    } while (n);
+
+    http_builder_append(b, p, digits + sizeof(digits) - p);
+}
+
+/*
+ * 追加 IMF-fixdate 格式的时间，如 "Sun, 06 Nov 1994 08:49:37 GMT" 。
+ */
+void http_builder_http_date(http_builder_t* b, time_t t) {
+    struct tm tm;
+
+    if (gmtime_r(&t, &tm) == NULL) {
+        b->overflow = 1;
+        return;
+    }
+
+    http_builder_append(b, week_names[tm.tm_wday], 3);
+    http_builder_literal(b, ", ");
+    http_builder_2digits(b, tm.tm_mday);
+    http_builder_literal(b, " ");
+    http_builder_append(b, month_names[tm.tm_mon], 3);
+    http_builder_literal(b, " ");
+    http_builder_uint(b, tm.tm_year + 1900);
+    http_builder_literal(b, " ");
+    http_builder_2digits(b, tm.tm_hour);
+    http_builder_literal(b, ":");
+    http_builder_2digits(b, tm.tm_min);
+    http_builder_literal(b, ":");
+    http_builder_2digits(b, tm.tm_sec);
+    http_builder_literal(b, " GMT");
+}
+
+/*
+ * 追加预先生成的状态行，如 "HTTP/1.1 200 OK\r\n" 。
+ */
+void http_builder_status_line(http_builder_t* b, unsigned status) {
+    const http_status_line_t* it;
+
+    if ((it = http_find_status(status)) != NULL) {
+        http_builder_append(b, it->line, it->len);
+        return;
+    }
+
+    /* 没有预先生成的状态码，原因短语留空 */
+    http_builder_literal(b, PROTOCOL " ");
+    http_builder_uint(b, status);
+    http_builder_literal(b, " \r\n");
+}
+
+/*
+ * 追加 "Keep-Alive: timeout=<秒>\r\n" ，timeout 单位为毫秒，不足一秒的部分向上取整。
+ * 每个线程缓存最近一次生成的行，超时时间不变时直接复制。
+ */
+void http_builder_keep_alive(http_builder_t* b, unsigned long timeout) {
+    http_builder_t line;
+
+    if (timeout != keep_alive_timeout) {
+        http_builder_init(&line, keep_alive_line, sizeof(keep_alive_line));
+        http_builder_literal(&line, "Keep-Alive: timeout=");
+        http_builder_uint(&line, (timeout + 999) / 1000);
+        http_builder_literal(&line, "\r\n");
+
+        keep_alive_len = http_builder_len(&line);
+        keep_alive_timeout = timeout;
+    }
+
+    http_builder_append(b, keep_alive_line, keep_alive_len);
+}
+
+/*
+ * 获取状态码对应的原因短语，未知的状态码返回空字符串。
+ */
+const char* http_status_reason(unsigned status) {
+    const http_status_line_t* it;
+
+    if ((it = http_find_status(status)) != NULL) {
+        return it->reason;
+    }
+
+    return "";
+}
+
+/*
+ * 查找预先生成的状态行，最常见的状态码排在前面。没有时返回 NULL 。
+ */
+static const http_status_line_t* http_find_status(unsigned status) {
+    const http_status_line_t* it;
+
+    for (it = status_lines; it->line != NULL; ++ it) {
+        if (it->status == status) {
+            return it;
+        }
+    }
+
+    return NULL;
+}
+
+/*
+ * 追加两位的十进制数，不足两位补 0 。
+ */
+static void http_builder_2digits(http_builder_t* b, unsigned n) {
+    char digits[2];
+
+    digits[0] = '0' + n / 10 % 10;
+    digits[1] = '0' + n % 10;
+
+    http_builder_append(b, digits, 2);
+}
@@ -0,0 +1,71 @@
+/**
+ * @author ttoobne
+ * @date 2026/10/17
+ */
+
+#ifndef _HTTP_BUILDER_H_
+#define _HTTP_BUILDER_H_
+
+#include <stddef.h>
+#include <time.h>
+
+/*
+ * 响应头部的构造器：依次追加到调用者提供的缓冲区中，不需要每次从头扫描已写入的内容。
+ * 状态行等固定的部分预先生成，整数与日期直接转换，不经过 printf 。
+ * 缓冲区写满后的追加全部截断并置 overflow ，调用者只需在最后检查一次。
+ */
+typedef struct {
+    char*               pos;            /* 下一个写入的位置 */
+    char*               last;           /* 缓冲区的结束地址 */
+    char*               start;          /* 缓冲区的起始地址 */
+    unsigned            overflow;       /* 有内容因缓冲区已满而被截断 */
+} http_builder_t;
+
+/* 追加字符串常量，长度在编译期确定 */
+#define http_builder_literal(b, s)      http_builder_append(b, s, sizeof(s) - 1)
+
+/* 已写入的字节数 */
+#define http_builder_len(b)             ((size_t)((b)->pos - (b)->start))
+
+/*
+ * 以 size 字节的 buf 初始化构造器。
+ */
+void http_builder_init(http_builder_t* b, char* buf, size_t size);
+
+/*
+ * 追加 len 字节的 data 。
+ */
+void http_builder_append(http_builder_t* b, const char* data, size_t len);
+
+/*
+ * 追加以 '\0' 结尾的字符串。
+ */
+void http_builder_str(http_builder_t* b, const char* s);
+
+/*
+ * 追加无符号整数的十进制表示。
+ */
+void http_builder_uint(http_builder_t* b, unsigned long long n);
+
+/*
+ * 追加 IMF-fixdate 格式的时间，如 "Sun, 06 Nov 1994 08:49:37 GMT" 。
+ */
+void http_builder_http_date(http_builder_t* b, time_t t);
+
+/*
+ * 追加预先生成的状态行，如 "HTTP/1.1 200 OK\r\n" 。
+ */
+void http_builder_status_line(http_builder_t* b, unsigned status);
+
+/*
+ * 追加 "Keep-Alive: timeout=<秒>\r\n" ，timeout 单位为毫秒。
+ * 每个线程缓存最近一次生成的行，超时时间不变时直接复制。
+ */
+void http_builder_keep_alive(http_builder_t* b, unsigned long timeout);
+
+/*
+ * 获取状态码对应的原因短语，未知的状态码返回空字符串。
+ */
+const char* http_status_reason(unsigned status);
+
+#endif /* _HTTP_BUILDER_H_ */
@@ -0,0 +1,807 @@
+/**
+ * @author ttoobne
+ * @date 2026/10/17
+ */
+
+#include "http_file_cache.h"
+
+#include "http.h"
+#include "http_builder.h"
+#include "log.h"
+#include "times.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* 监视的事件：目录中的文件被修改、改变属性、创建、删除或移动，以及目录本身被删除或移动 */
+#define FILE_WATCH_MASK     (IN_ATTRIB | IN_CLOSE_WRITE | IN_MODIFY | IN_CREATE | IN_DELETE | \
+                             IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF)
+
+/*
+ * 正在进行的加载。同一文件同时未命中时只有第一个请求打开文件，其余的请求等待并共享它的结果，
+ * 新文件上线或文件刚变化时大量请求不会同时 open 、 fstat 同一个文件。
+ * 加载者与等待者各持有一个引用，最后一个释放。
+ */
+typedef struct file_flight_s file_flight_t;
+
+struct file_flight_s {
+    file_flight_t*      next;           /* 分片中的下一个加载 */
+    uint64_t            hash;           /* 文件名的哈希值 */
+    const char*         name;           /* 规范化的文件名，属于加载者，只在加载完成之前访问 */
+    size_t              name_len;
+    unsigned            refs;           /* 引用计数 */
+    unsigned            done;           /* 加载已完成 */
+    unsigned            status;         /* 加载的结果 */
+    http_file_t*        file;           /* 加载得到的条目，有等待者时持有一个引用 */
+};
+
+/* 分片：桶号的低位相同的桶属于同一分片 */
+typedef struct {
+    pthread_rwlock_t    lock;           /* 查找加读锁，插入、移动与删除加写锁 */
+    list_head_t         lru;            /* LRU 链表，尾部为最近使用的条目 */
+    unsigned long       num;            /* 条目数 */
+    list_head_t         negative;       /* 否定条目（不存在或不可读的文件）单独的 LRU 链表，大量不存在的路径不会挤掉正常条目 */
+    unsigned long       negative_num;   /* 否定条目数 */
+    pthread_mutex_t     flight_lock;    /* 保护正在进行的加载 */
+    pthread_cond_t      flight_cond;    /* 加载完成时唤醒等待者 */
+    file_flight_t*      flights;        /* 正在进行的加载 */
+} file_shard_t;
+
+static file_shard_t     shards[FILE_CACHE_SHARDS];
+static http_file_t**    buckets;        /* 哈希桶 */
+static size_t           buckets_mask;
+static unsigned long    shard_max;      /* 每个分片最多的条目数， 0 表示不缓存 */
+static unsigned long    valid;          /* inotify 不可用时条目的有效时间 */
+static unsigned long    negative_max;   /* 每个分片最多的否定条目数， 0 表示不缓存否定结果 */
+static unsigned long    negative_valid; /* 否定条目的有效时间，即使 inotify 可用也会过期 */
+static int              watching;       /* inotify 正在监视整个根目录树，条目不会过期 */
+static unsigned         generation;     /* 每次失效加一，打开文件期间发生过失效时不插入，避免插入过时的条目 */
+static unsigned long    loads;          /* 打开文件的次数 */
+static unsigned long    coalesced;      /* 等待其他请求打开同一文件的次数 */
+
+/* inotify 的监视描述符到目录名的映射，初始化之后只有监视线程访问 */
+static int              inotify_fd = -1;
+static char**           watch_dirs;
+static int              watch_num;
+
+static unsigned http_file_open(const char* name, size_t len, uint64_t hash, http_file_t** file);
+static void http_file_insert(http_file_t* file, unsigned gen);
+static int http_file_flight_begin(file_shard_t* shard, const char* name, size_t len, uint64_t hash,
+                                  file_flight_t** flight, unsigned* status, http_file_t** file);
+static void http_file_flight_finish(file_shard_t* shard, file_flight_t* flight, unsigned status, http_file_t* file);
+static void http_file_unlink(file_shard_t* shard, http_file_t* file);
+static list_head_t* http_file_lru(file_shard_t* shard, http_file_t* file);
+static void http_file_invalidate(const char* filename);
+static void http_file_flush();
+static size_t http_file_normalize(const char* filename, char* name);
+static uint64_t http_file_hash(const char* name, size_t len);
+static file_shard_t* http_file_shard(uint64_t hash);
+static int http_file_watch_tree(const char* dir);
+static void* http_file_watch(void* arg);
+static void http_file_event(const struct inotify_event* ev);
+
+/*
+ * 按配置初始化缓存， open_file_cache 为 0 时不缓存。inotify 可用时启动监视线程监视根目录树。
+ * 应在启动工作线程之前调用。成功返回 0 ，失败返回 -1 。
+ */
+int http_file_cache_init(config_t* config) {
+    pthread_attr_t attr;
+    pthread_t tid;
+    size_t size;
+    int i;
+
+    shard_max = (config->open_file_cache + FILE_CACHE_SHARDS - 1) / FILE_CACHE_SHARDS;
+    valid = config->open_file_cache_valid;
+    negative_valid = config->negative_cache_valid;
+
+    if (shard_max == 0) {
+        return 0;
+    }
+
+    /* 否定条目最多占总条目数的 1 / FILE_CACHE_NEGATIVE */
+    if (negative_valid > 0) {
+        negative_max = (shard_max + FILE_CACHE_NEGATIVE - 1) / FILE_CACHE_NEGATIVE;
+    }
+
+    for (i = 0; i < FILE_CACHE_SHARDS; ++ i) {
+        pthread_rwlock_init(&(shards[i].lock), NULL);
+        init_list_head(&(shards[i].lru));
+        shards[i].num = 0;
+        init_list_head(&(shards[i].negative));
+        shards[i].negative_num = 0;
+        pthread_mutex_init(&(shards[i].flight_lock), NULL);
+        pthread_cond_init(&(shards[i].flight_cond), NULL);
+        shards[i].flights = NULL;
+    }
+
+    /* 桶数为不小于条目数的 2 的幂 */
+    for (size = FILE_CACHE_SHARDS; size < shard_max * FILE_CACHE_SHARDS; size <<= 1);
+
+    if ((buckets = (http_file_t**)calloc(size, sizeof(http_file_t*))) == NULL) {
+        log_error("file cache buckets malloc failed.");
+        return -1;
+    }
+
+    buckets_mask = size - 1;
+
+    /* 监视整个根目录树，失败时退回按有效时间过期 */
+    if ((inotify_fd = inotify_init1(IN_CLOEXEC)) < 0 || http_file_watch_tree(config->root) != 0) {
+        log_warn("can not watch %s with inotify, cached files expire after %lu ms.", config->root, valid);
+
+        if (inotify_fd >= 0) {
+            close(inotify_fd);
+            inotify_fd = -1;
+        }
+
+        return 0;
+    }
+
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+
+    if (pthread_create(&tid, &attr, http_file_watch, NULL) != 0) {
+        log_warn("create file watch thread failed, cached files expire after %lu ms.", valid);
+        close(inotify_fd);
+        inotify_fd = -1;
+    } else {
+        watching = 1;
+    }
+
+    pthread_attr_destroy(&attr);
+
+    return 0;
+}
+
+/*
+ * 获取文件，返回 HTTP_OK 、 HTTP_FORBIDDEN 或 HTTP_NOT_FOUND 时 *file 为持有一个引用的条目，用完后调用 http_file_release ；
+ * 打开失败返回 HTTP_INTERNAL_SERVER_ERROR ，此时 *file 为 NULL 。
+ */
+unsigned http_file_get(const char* filename, http_file_t** file) {
+    char name[MAXLINE];
+    file_shard_t* shard;
+    file_flight_t* flight;
+    http_file_t* it;
+    unsigned long now;
+    uint64_t hash;
+    size_t len;
+    unsigned gen;
+    unsigned status;
+    int touch;
+
+    len = http_file_normalize(filename, name);
+    hash = http_file_hash(name, len);
+
+    if (shard_max == 0) {
+        return http_file_open(name, len, hash, file);
+    }
+
+    shard = http_file_shard(hash);
+    now = current_msec();
+    touch = 0;
+
+    pthread_rwlock_rdlock(&(shard->lock));
+
+    for (it = buckets[hash & buckets_mask]; it; it = it->next) {
+        if (it->hash == hash && it->name_len == len && memcmp(it->name, name, len) == 0) {
+            break;
+        }
+    }
+
+    /* 否定条目同样随目录变化失效，此外总在有效时间后过期，作为遗漏 inotify 事件时的兜底 */
+    if (it && ((it->status == HTTP_OK && __atomic_load_n(&watching, __ATOMIC_RELAXED)) || now < it->expires)) {
+        __atomic_add_fetch(&(it->refs), 1, __ATOMIC_RELAXED);
+        touch = now - __atomic_load_n(&(it->touched), __ATOMIC_RELAXED) >= FILE_CACHE_TOUCH;
+    } else {
+        it = NULL;
+    }
+
+    pthread_rwlock_unlock(&(shard->lock));
+
+    if (it) {
+        /* 持有引用，条目不会被释放，但可能已被淘汰 */
+        if (touch) {
+            pthread_rwlock_wrlock(&(shard->lock));
+
+            if (it->cached) {
+                list_del(&(it->lru_node));
+                list_add_tail(&(it->lru_node), http_file_lru(shard, it));
+                it->touched = now;
+            }
+
+            pthread_rwlock_unlock(&(shard->lock));
+        }
+
+        *file = it;
+        return it->status;
+    }
+
+    /* 未命中或已过期，同一文件已有请求在打开时等待它的结果 */
+    if (!http_file_flight_begin(shard, name, len, hash, &flight, &status, file)) {
+        return status;
+    }
+
+    /* 打开之前记下失效计数 */
+    gen = __atomic_load_n(&generation, __ATOMIC_ACQUIRE);
+
+    if ((status = http_file_open(name, len, hash, file)) == HTTP_OK ||
+        (status != HTTP_INTERNAL_SERVER_ERROR && negative_max > 0)) {
+        http_file_insert(*file, gen);
+    }
+
+    http_file_flight_finish(shard, flight, status, *file);
+
+    return status;
+}
+
+/*
+ * 增加一个引用，返回 file 。
+ */
+http_file_t* http_file_hold(http_file_t* file) {
+    __atomic_add_fetch(&(file->refs), 1, __ATOMIC_RELAXED);
+
+    return file;
+}
+
+/*
+ * 释放 http_file_get 得到的引用，可以在任意线程调用。
+ */
+void http_file_release(http_file_t* file) {
+    if (file == NULL || __atomic_sub_fetch(&(file->refs), 1, __ATOMIC_ACQ_REL) > 0) {
+        return;
+    }
+
+    if (file->fd >= 0) {
+        close(file->fd);
+    }
+
+    free(file);
+}
+
+/*
+ * 获取打开文件的统计：打开文件的次数，等待其他请求打开同一文件的次数。
+ */
+void http_file_cache_get_stats(unsigned long* load_num, unsigned long* coalesced_num) {
+    *load_num = __atomic_load_n(&loads, __ATOMIC_RELAXED);
+    *coalesced_num = __atomic_load_n(&coalesced, __ATOMIC_RELAXED);
+}
+
+/*
+ * 打开文件并生成不在缓存中、持有一个引用的条目。返回值与 http_file_get 相同。
+ */
+static unsigned http_file_open(const char* name, size_t len, uint64_t hash, http_file_t** file) {
+    http_builder_t b;
+    http_file_t* f;
+    struct stat st;
+    uint64_t version[7];
+    unsigned status;
+    int fd;
+
+    *file = NULL;
+
+    __atomic_add_fetch(&loads, 1, __ATOMIC_RELAXED);
+
+    /* 先打开再 fstat ，元数据与打开的文件一定一致；非阻塞打开，避免在命名管道上阻塞 */
+    if ((fd = open(name, O_RDONLY | O_NONBLOCK | O_CLOEXEC)) < 0) {
+        if (errno == EMFILE || errno == ENFILE || errno == ENOMEM) {
+            log_error("open file error.");
+            return HTTP_INTERNAL_SERVER_ERROR;
+        }
+
+        status = errno == EACCES ? HTTP_FORBIDDEN : HTTP_NOT_FOUND;
+    } else if (fstat(fd, &st) != 0) {
+        log_error("fstat error.");
+        close(fd);
+        return HTTP_INTERNAL_SERVER_ERROR;
+    } else if (!S_ISREG(st.st_mode) || !(st.st_mode & S_IRUSR)) {
+        /* 不是普通文件或没有读权限 */
+        close(fd);
+        fd = -1;
+        status = HTTP_FORBIDDEN;
+    } else {
+        status = HTTP_OK;
+    }
+
+    if ((f = (http_file_t*)malloc(sizeof(http_file_t) + len + 1)) == NULL) {
+        log_error("http_file_t malloc failed.");
+
+        if (fd >= 0) {
+            close(fd);
+        }
+
+        return HTTP_INTERNAL_SERVER_ERROR;
+    }
+
+    f->next = NULL;
+    f->hash = hash;
+    f->refs = 1;
+    f->cached = 0;
+    f->touched = current_msec();
+    f->expires = f->touched + (status == HTTP_OK ? valid : negative_valid);
+    f->fd = fd;
+    f->status = status;
+    memcpy(f->name, name, len);
+    f->name[len] = '\0';
+    f->name_len = len;
+
+    /* 否定条目只记录状态码 */
+    if (status != HTTP_OK) {
+        f->size = 0;
+        f->mtime = 0;
+        f->version = 0;
+        f->mime = NULL;
+        f->last_modified[0] = '\0';
+
+        *file = f;
+        return status;
+    }
+
+    f->size = st.st_size;
+    f->mtime = st.st_mtime;
+
+    /* 状态变化时间无法由用户设置，内容或元数据的任何修改都会更新它 */
+    version[0] = st.st_dev;
+    version[1] = st.st_ino;
+    version[2] = st.st_size;
+    version[3] = st.st_mtim.tv_sec;
+    version[4] = st.st_mtim.tv_nsec;
+    version[5] = st.st_ctim.tv_sec;
+    version[6] = st.st_ctim.tv_nsec;
+    f->version = http_file_hash((const char*)version, sizeof(version));
+    f->mime = http_mime_type(f->name);
+
+    http_builder_init(&b, f->last_modified, HTTP_LAST_MODIFIED_LEN);
+    http_builder_literal(&b, "Last-Modified: ");
+    http_builder_http_date(&b, f->mtime);
+    http_builder_literal(&b, "\r\n");
+    f->last_modified[http_builder_len(&b)] = '\0';
+
+    *file = f;
+    return HTTP_OK;
+}
+
+/*
+ * 把新打开的条目插入缓存，替换同名的旧条目，超过容量时从 LRU 链表头部淘汰最久未使用的条目。
+ * gen 为打开文件之前的失效计数，期间发生过失效时文件可能已经变化，不插入。
+ */
+static void http_file_insert(http_file_t* file, unsigned gen) {
+    file_shard_t* shard;
+    http_file_t** pos;
+    http_file_t* it;
+
+    shard = http_file_shard(file->hash);
+
+    pthread_rwlock_wrlock(&(shard->lock));
+
+    if (gen != __atomic_load_n(&generation, __ATOMIC_ACQUIRE)) {
+        pthread_rwlock_unlock(&(shard->lock));
+        return;
+    }
+
+    for (pos = &(buckets[file->hash & buckets_mask]); (it = *pos) != NULL; pos = &(it->next)) {
+        if (it->hash == file->hash && it->name_len == file->name_len && memcmp(it->name, file->name, it->name_len) == 0) {
+            http_file_unlink(shard, it);
+            break;
+        }
+    }
+
+    file->next = buckets[file->hash & buckets_mask];
+    buckets[file->hash & buckets_mask] = file;
+    list_add_tail(&(file->lru_node), http_file_lru(shard, file));
+    file->cached = 1;
+
+    if (file->status == HTTP_OK) {
+        shard->num ++ ;
+    } else {
+        shard->negative_num ++ ;
+    }
+
+    /* 缓存持有一个引用 */
+    __atomic_add_fetch(&(file->refs), 1, __ATOMIC_RELAXED);
+
+    while (shard->num > shard_max) {
+        http_file_unlink(shard, list_entry(shard->lru.next, http_file_t, lru_node));
+    }
+
+    while (shard->negative_num > negative_max) {
+        http_file_unlink(shard, list_entry(shard->negative.next, http_file_t, lru_node));
+    }
+
+    pthread_rwlock_unlock(&(shard->lock));
+}
+
+/*
+ * 开始加载文件 name 。同一文件已有加载在进行时等待它完成，通过 status 与 file 返回它的结果（ file 持有一个引用），返回 0 ；
+ * 否则登记新的加载并返回 1 ，调用者打开文件后调用 http_file_flight_finish 。
+ * 登记失败时返回 0 ， status 为 HTTP_INTERNAL_SERVER_ERROR 。
+ */
+static int http_file_flight_begin(file_shard_t* shard, const char* name, size_t len, uint64_t hash,
+                                  file_flight_t** flight, unsigned* status, http_file_t** file) {
+    file_flight_t* it;
+    int last;
+
+    pthread_mutex_lock(&(shard->flight_lock));
+
+    for (it = shard->flights; it; it = it->next) {
+        if (it->hash == hash && it->name_len == len && memcmp(it->name, name, len) == 0) {
+            break;
+        }
+    }
+
+    if (it) {
+        it->refs ++ ;
+        __atomic_add_fetch(&coalesced, 1, __ATOMIC_RELAXED);
+
+        /* 加载者打开文件期间不会让出线程，等待的时间不超过一次 open 与 fstat */
+        while (!it->done) {
+            pthread_cond_wait(&(shard->flight_cond), &(shard->flight_lock));
+        }
+
+        *status = it->status;
+
+        if ((*file = it->file) != NULL) {
+            __atomic_add_fetch(&((*file)->refs), 1, __ATOMIC_RELAXED);
+        }
+
+        last = -- it->refs == 0;
+
+        pthread_mutex_unlock(&(shard->flight_lock));
+
+        if (last) {
+            http_file_release(it->file);
+            free(it);
+        }
+
+        return 0;
+    }
+
+    if ((it = (file_flight_t*)malloc(sizeof(file_flight_t))) == NULL) {
+        pthread_mutex_unlock(&(shard->flight_lock));
+        log_error("file_flight_t malloc failed.");
+        *status = HTTP_INTERNAL_SERVER_ERROR;
+        *file = NULL;
+        return 0;
+    }
+
+    it->hash = hash;
+    it->name = name;
+    it->name_len = len;
+    it->refs = 1;
+    it->done = 0;
+    it->status = HTTP_INTERNAL_SERVER_ERROR;
+    it->file = NULL;
+    it->next = shard->flights;
+    shard->flights = it;
+
+    pthread_mutex_unlock(&(shard->flight_lock));
+
+    *flight = it;
+    return 1;
+}
+
+/*
+ * 加载完成，移除登记并把结果交给等待者。
+ */
+static void http_file_flight_finish(file_shard_t* shard, file_flight_t* flight, unsigned status, http_file_t* file) {
+    file_flight_t** pos;
+
+    pthread_mutex_lock(&(shard->flight_lock));
+
+    for (pos = &(shard->flights); *pos != flight; pos = &((*pos)->next));
+
+    *pos = flight->next;
+
+    /* 没有等待者 */
+    if ( -- flight->refs == 0) {
+        pthread_mutex_unlock(&(shard->flight_lock));
+        free(flight);
+        return;
+    }
+
+    /* 最后一个等待者释放这个引用 */
+    if (file) {
+        __atomic_add_fetch(&(file->refs), 1, __ATOMIC_RELAXED);
+    }
+
+    flight->done = 1;
+    flight->status = status;
+    flight->file = file;
+
+    pthread_cond_broadcast(&(shard->flight_cond));
+    pthread_mutex_unlock(&(shard->flight_lock));
+}
+
+/*
+ * 把条目移出缓存并释放缓存持有的引用，调用者持有分片的写锁。
+ */
+static void http_file_unlink(file_shard_t* shard, http_file_t* file) {
+    http_file_t** pos;
+
+    for (pos = &(buckets[file->hash & buckets_mask]); *pos != file; pos = &((*pos)->next));
+
+    *pos = file->next;
+    list_del(&(file->lru_node));
+    file->cached = 0;
+
+    if (file->status == HTTP_OK) {
+        shard->num -- ;
+    } else {
+        shard->negative_num -- ;
+    }
+
+    http_file_release(file);
+}
+
+/*
+ * 条目所属的 LRU 链表。
+ */
+static list_head_t* http_file_lru(file_shard_t* shard, http_file_t* file) {
+    return file->status == HTTP_OK ? &(shard->lru) : &(shard->negative);
+}
+
+/*
+ * 文件发生变化，移出缓存中的条目。
+ */
+static void http_file_invalidate(const char* filename) {
+    char name[MAXLINE];
+    file_shard_t* shard;
+    http_file_t* it;
+    uint64_t hash;
+    size_t len;
+
+    if (strlen(filename) >= MAXLINE) {
+        return;
+    }
+
+    len = http_file_normalize(filename, name);
+    hash = http_file_hash(name, len);
+    shard = http_file_shard(hash);
+
+    /* 先增加失效计数再删除，此后插入的条目要么被删除，要么因计数变化而不插入 */
+    __atomic_add_fetch(&generation, 1, __ATOMIC_ACQ_REL);
+
+    pthread_rwlock_wrlock(&(shard->lock));
+
+    for (it = buckets[hash & buckets_mask]; it; it = it->next) {
+        if (it->hash == hash && it->name_len == len && memcmp(it->name, name, len) == 0) {
+            http_file_unlink(shard, it);
+            break;
+        }
+    }
+
+    pthread_rwlock_unlock(&(shard->lock));
+}
+
+/*
+ * 移出缓存中的所有条目，用于目录变化与事件队列溢出等无法确定具体文件的情况。
+ */
+static void http_file_flush() {
+    file_shard_t* shard;
+    int i;
+
+    __atomic_add_fetch(&generation, 1, __ATOMIC_ACQ_REL);
+
+    for (i = 0; i < FILE_CACHE_SHARDS; ++ i) {
+        shard = &(shards[i]);
+
+        pthread_rwlock_wrlock(&(shard->lock));
+
+        while (!list_empty(&(shard->lru))) {
+            http_file_unlink(shard, list_entry(shard->lru.next, http_file_t, lru_node));
+        }
+
+        while (!list_empty(&(shard->negative))) {
+            http_file_unlink(shard, list_entry(shard->negative.next, http_file_t, lru_node));
+        }
+
+        pthread_rwlock_unlock(&(shard->lock));
+    }
+}
+
+/*
+ * 规范化文件名：合并连续的 '/' ，去掉 "/./" 中的 "./" ，使请求的文件名与 inotify 事件拼出的文件名一致。
+ * 文件名不含 "/../" ，由 parse_uri 保证。返回规范化后的长度。
+ */
+static size_t http_file_normalize(const char* filename, char* name) {
+    const char* p;
+    char* q;
+
+    for (p = filename, q = name; *p != '\0'; ) {
+        if (q > name && q[-1] == '/') {
+            if (*p == '/') {
+                p ++ ;
+                continue;
+            }
+
+            if (*p == '.' && (p[1] == '/' || p[1] == '\0')) {
+                p += p[1] == '/' ? 2 : 1;
+                continue;
+            }
+        }
+
+        *(q ++ ) = *(p ++ );
+    }
+
+    *q = '\0';
+
+    return q - name;
+}
+
+/*
+ * FNV-1a 哈希。
+ */
+static uint64_t http_file_hash(const char* name, size_t len) {
+    uint64_t hash;
+    size_t i;
+
+    hash = 0xcbf29ce484222325ull;
+
+    for (i = 0; i < len; ++ i) {
+        hash ^= (unsigned char)name[i];
+        hash *= 0x100000001b3ull;
+    }
+
+    return hash;
+}
+
+/*
+ * 哈希值所在桶所属的分片。
+ */
+static file_shard_t* http_file_shard(uint64_t hash) {
+    return &(shards[hash & buckets_mask & (FILE_CACHE_SHARDS - 1)]);
+}
+
+/*
+ * 监视 dir 及其下所有子目录。目录树中有符号链接时链接目标的变化无法监视，视为失败。
+ * 成功返回 0 ，失败返回 -1 。
+ */
+static int http_file_watch_tree(const char* dir) {
+    char path[MAXLINE];
+    struct dirent* entry;
+    char** dirs;
+    DIR* dp;
+    int ret;
+    int wd;
+    int n;
+
+    if ((wd = inotify_add_watch(inotify_fd, dir, FILE_WATCH_MASK | IN_ONLYDIR)) < 0) {
+        log_warn("inotify watch %s failed.", dir);
+        return -1;
+    }
+
+    /* 同一目录再次监视时得到相同的监视描述符，只更新目录名 */
+    if (wd >= watch_num) {
+        if ((dirs = (char**)realloc(watch_dirs, (wd + 1) * sizeof(char*))) == NULL) {
+            log_error("watch dirs malloc failed.");
+            return -1;
+        }
+
+        memset(dirs + watch_num, 0, (wd + 1 - watch_num) * sizeof(char*));
+        watch_dirs = dirs;
+        watch_num = wd + 1;
+    }
+
+    free(watch_dirs[wd]);
+
+    if ((watch_dirs[wd] = strdup(dir)) == NULL) {
+        log_error("watch dir malloc failed.");
+        return -1;
+    }
+
+    if ((dp = opendir(dir)) == NULL) {
+        log_warn("open directory %s failed.", dir);
+        return -1;
+    }
+
+    ret = 0;
+
+    while (ret == 0 && (entry = readdir(dp)) != NULL) {
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
+            continue;
+        }
+
+        if (entry->d_type == DT_LNK) {
+            log_warn("%s/%s is a symbolic link.", dir, entry->d_name);
+            ret = -1;
+        } else if (entry->d_type == DT_DIR) {
+            n = snprintf(path, sizeof(path), "%s/%s", dir, entry->d_name);
+
+            if (n < 0 || (size_t)n >= sizeof(path)) {
+                ret = -1;
+                break;
+            }
+
+            ret = http_file_watch_tree(path);
+        }
+    }
+
+    closedir(dp);
+
+    return ret;
+}
+
+/*
+ * 监视线程：读取 inotify 事件，使变化的文件失效。
+ */
+static void* http_file_watch(void* arg) {
+    char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    const struct inotify_event* ev;
+    char* p;
+    ssize_t n;
+
+    for ( ;; ) {
+        if ((n = read(inotify_fd, buf, sizeof(buf))) <= 0) {
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+
+            log_error("read inotify events error, cached files expire after %lu ms.", valid);
+            __atomic_store_n(&watching, 0, __ATOMIC_RELAXED);
+            http_file_flush();
+            return NULL;
+        }
+
+        for (p = buf; p < buf + n; p += sizeof(struct inotify_event) + ev->len) {
+            ev = (const struct inotify_event*)p;
+            http_file_event(ev);
+        }
+    }
+
+    return NULL;
+}
+
+/*
+ * 处理一个 inotify 事件。
+ */
+static void http_file_event(const struct inotify_event* ev) {
+    char path[MAXLINE];
+    const char* dir;
+    int n;
+
+    /* 事件队列溢出，丢失了哪些事件无法得知 */
+    if (ev->mask & IN_Q_OVERFLOW) {
+        log_warn("inotify event queue overflow.");
+        http_file_flush();
+        return;
+    }
+
+    if (ev->wd < 0 || ev->wd >= watch_num || (dir = watch_dirs[ev->wd]) == NULL) {
+        return;
+    }
+
+    /* 目录已被删除，监视随之移除 */
+    if (ev->mask & IN_IGNORED) {
+        free(watch_dirs[ev->wd]);
+        watch_dirs[ev->wd] = NULL;
+        return;
+    }
+
+    if (ev->len == 0 || (n = snprintf(path, sizeof(path), "%s/%s", dir, ev->name)) < 0 || (size_t)n >= sizeof(path)) {
+        /* 被监视的目录本身被删除或移动，其下的文件名全部失效 */
+        if (ev->mask & (IN_DELETE_SELF | IN_MOVE_SELF)) {
+            http_file_flush();
+        }
+
+        return;
+    }
+
+    /* 子目录变化时其下的文件名都受影响，全部失效；新出现的子目录加入监视 */
+    if (ev->mask & IN_ISDIR) {
+        if ((ev->mask & (IN_CREATE | IN_MOVED_TO)) && http_file_watch_tree(path) != 0) {
+            log_warn("can not watch %s with inotify, cached files expire after %lu ms.", path, valid);
+            __atomic_store_n(&watching, 0, __ATOMIC_RELAXED);
+        }
+
+        http_file_flush();
+        return;
+    }
+
+    http_file_invalidate(path);
+}
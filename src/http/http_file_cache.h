@@ -0,0 +1,80 @@
+/**
+ * @author ttoobne
+ * @date 2026/10/17
+ */
+
+#ifndef _HTTP_FILE_CACHE_H_
+#define _HTTP_FILE_CACHE_H_
+
+#include "config.h"
+#include "list.h"
+
+#include <stdint.h>
+#include <sys/types.h>
+#include <time.h>
+
+#define FILE_CACHE_SHARDS       16          /* 分片数，每个分片一把读写锁与一个 LRU 链表 */
+#define FILE_CACHE_NEGATIVE     4           /* 否定条目最多占条目数的 1 / FILE_CACHE_NEGATIVE */
+#define FILE_CACHE_TOUCH        1000        /* 命中的条目至少间隔该时间（毫秒）才移到 LRU 链表尾部，热门文件不必每次加写锁 */
+
+#define HTTP_LAST_MODIFIED_LINE "Last-Modified: Sun, 06 Nov 1994 08:49:37 GMT\r\n"
+#define HTTP_LAST_MODIFIED_LEN  (sizeof(HTTP_LAST_MODIFIED_LINE) - 1)   /* 预先格式化的 Last-Modified 头部行的长度 */
+
+/*
+ * 打开的静态文件及其元数据，按规范化后的文件名缓存。
+ * 条目带引用计数：缓存本身持有一个，正在发送的响应各持有一个，条目被淘汰或失效后由最后一个使用者关闭文件并释放。
+ * 缓存根目录树用 inotify 监视，文件变化时立即失效，命中时不需要任何文件系统调用；
+ * inotify 不可用时条目在 open_file_cache_valid 毫秒后过期重新打开。
+ * 不存在或不可读的路径也缓存为否定条目，在 negative_cache_valid 毫秒内重复请求不再访问文件系统。
+ * 同一文件同时未命中时只由第一个请求打开，其余的请求等待并共享它的结果。
+ */
+typedef struct http_file_s http_file_t;
+
+struct http_file_s {
+    http_file_t*        next;           /* 哈希桶中的下一个条目 */
+    list_head_t         lru_node;       /* 连入分片的 LRU 链表，尾部为最近使用的条目 */
+    uint64_t            hash;           /* 文件名的哈希值 */
+    unsigned            refs;           /* 引用计数 */
+    unsigned            cached;         /* 仍在缓存中，只在持有分片写锁时修改 */
+    unsigned long       expires;        /* 过期时间（ current_msec ），只在 inotify 不可用时检查 */
+    unsigned long       touched;        /* 上次移到 LRU 链表尾部的时间 */
+
+    unsigned            status;         /* HTTP_OK ；否定条目为 HTTP_NOT_FOUND ，或者不是普通文件、没有读权限时为 HTTP_FORBIDDEN */
+    int                 fd;             /* 只读打开的文件，否定条目为 -1 */
+    off_t               size;           /* 文件大小 */
+    time_t              mtime;          /* 修改时间 */
+    uint64_t            version;        /* 文件版本：设备号、 inode 、大小与修改、状态变化时间的哈希值，文件变化后不同 */
+    const char*         mime;           /* 文件类型 */
+    char                last_modified[HTTP_LAST_MODIFIED_LEN + 1];  /* 预先格式化的 Last-Modified 头部行 */
+    size_t              name_len;       /* 文件名长度 */
+    char                name[];         /* 规范化后的文件名 */
+};
+
+/*
+ * 按配置初始化缓存， open_file_cache 为 0 时不缓存。inotify 可用时启动监视线程监视根目录树。
+ * 应在启动工作线程之前调用。成功返回 0 ，失败返回 -1 。
+ */
+int http_file_cache_init(config_t* config);
+
+/*
+ * 获取文件，返回 HTTP_OK 、 HTTP_FORBIDDEN 或 HTTP_NOT_FOUND 时 *file 为持有一个引用的条目，用完后调用 http_file_release ；
+ * 打开失败返回 HTTP_INTERNAL_SERVER_ERROR ，此时 *file 为 NULL 。
+ */
+unsigned http_file_get(const char* filename, http_file_t** file);
+
+/*
+ * 增加一个引用，返回 file 。
+ */
+http_file_t* http_file_hold(http_file_t* file);
+
+/*
+ * 释放 http_file_get 得到的引用，可以在任意线程调用。
+ */
+void http_file_release(http_file_t* file);
+
+/*
+ * 获取打开文件的统计：打开文件的次数，等待其他请求打开同一文件（请求合并）的次数。
+ */
+void http_file_cache_get_stats(unsigned long* load_num, unsigned long* coalesced_num);
+
+#endif /* _HTTP_FILE_CACHE_H_ */
@@ -0,0 +1,48 @@
+/**
+ * @author ttoobne
+ * @date 2026/10/17
+ */
+
+#include "http_header.h"
+
+#include "http_header_hash.h"
+
+#define HTTP_HEADER_NAME(id, name)      [HTTP_HEADER_##id] = name,
+#define HTTP_HEADER_LEN(id, name)       [HTTP_HEADER_##id] = sizeof(name) - 1,
+
+/* 按编号索引的字段名与长度 */
+const char* const http_header_names[HTTP_HEADER_NUM] = {
+    [HTTP_HEADER_UNKNOWN] = "",
+    HTTP_HEADERS(HTTP_HEADER_NAME)
+};
+
+const unsigned char http_header_lens[HTTP_HEADER_NUM] = {
+    HTTP_HEADERS(HTTP_HEADER_LEN)
+};
+
+/*
+ * 查找长度为 len 的字段名的编号，不区分大小写，不是已知的首部字段时返回 HTTP_HEADER_UNKNOWN 。
+ * 哈希对已知字段名没有冲突，每个槽最多对应一个字段名，只需与它比较一次。
+ * 字段名只含 token 字符，其中只有字母受 | 0x20 影响，所以逐字节 | 0x20 后比较即不区分大小写的比较。
+ */
+unsigned http_header_id(const unsigned char* name, size_t len) {
+    const char* known;
+    unsigned id;
+    size_t i;
+
+    id = http_header_slots[http_header_hash_slot(http_header_hash_key(name, len))];
+
+    if (id == HTTP_HEADER_UNKNOWN || http_header_lens[id] != len) {
+        return HTTP_HEADER_UNKNOWN;
+    }
+
+    known = http_header_names[id];
+
+    for (i = 0; i < len; ++ i) {
+        if ((name[i] | 0x20) != (known[i] | 0x20)) {
+            return HTTP_HEADER_UNKNOWN;
+        }
+    }
+
+    return id;
+}
@@ -0,0 +1,113 @@
+/**
+ * @author ttoobne
+ * @date 2026/10/17
+ */
+
+#ifndef _HTTP_HEADER_H_
+#define _HTTP_HEADER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * 已知的请求首部字段。解析器在字段名解析完毕时用完美哈希查出编号，保存在首部字段中，
+ * 之后按编号直接取处理函数，不再比较字符串。
+ * 增删字段后需要重新生成 http_header_hash.h ，见 test/gen_header_hash.c 。
+ */
+#define HTTP_HEADERS(X) \
+    X(ACCEPT,                           "Accept") \
+    X(ACCEPT_CHARSET,                   "Accept-Charset") \
+    X(ACCEPT_ENCODING,                  "Accept-Encoding") \
+    X(ACCEPT_LANGUAGE,                  "Accept-Language") \
+    X(ACCESS_CONTROL_REQUEST_HEADERS,   "Access-Control-Request-Headers") \
+    X(ACCESS_CONTROL_REQUEST_METHOD,    "Access-Control-Request-Method") \
+    X(AUTHORIZATION,                    "Authorization") \
+    X(CACHE_CONTROL,                    "Cache-Control") \
+    X(CONNECTION,                       "Connection") \
+    X(CONTENT_ENCODING,                 "Content-Encoding") \
+    X(CONTENT_LENGTH,                   "Content-Length") \
+    X(CONTENT_TYPE,                     "Content-Type") \
+    X(COOKIE,                           "Cookie") \
+    X(DATE,                             "Date") \
+    X(DNT,                              "DNT") \
+    X(EARLY_DATA,                       "Early-Data") \
+    X(EXPECT,                           "Expect") \
+    X(FORWARDED,                        "Forwarded") \
+    X(FROM,                             "From") \
+    X(HOST,                             "Host") \
+    X(IF_MATCH,                         "If-Match") \
+    X(IF_MODIFIED_SINCE,                "If-Modified-Since") \
+    X(IF_NONE_MATCH,                    "If-None-Match") \
+    X(IF_RANGE,                         "If-Range") \
+    X(IF_UNMODIFIED_SINCE,              "If-Unmodified-Since") \
+    X(KEEP_ALIVE,                       "Keep-Alive") \
+    X(MAX_FORWARDS,                     "Max-Forwards") \
+    X(ORIGIN,                           "Origin") \
+    X(PRAGMA,                           "Pragma") \
+    X(PRIORITY,                         "Priority") \
+    X(PROXY_AUTHORIZATION,              "Proxy-Authorization") \
+    X(PROXY_CONNECTION,                 "Proxy-Connection") \
+    X(PURPOSE,                          "Purpose") \
+    X(RANGE,                            "Range") \
+    X(REFERER,                          "Referer") \
+    X(SEC_CH_UA,                        "Sec-CH-UA") \
+    X(SEC_CH_UA_MOBILE,                 "Sec-CH-UA-Mobile") \
+    X(SEC_CH_UA_PLATFORM,               "Sec-CH-UA-Platform") \
+    X(SEC_FETCH_DEST,                   "Sec-Fetch-Dest") \
+    X(SEC_FETCH_MODE,                   "Sec-Fetch-Mode") \
+    X(SEC_FETCH_SITE,                   "Sec-Fetch-Site") \
+    X(SEC_FETCH_USER,                   "Sec-Fetch-User") \
+    X(SEC_PURPOSE,                      "Sec-Purpose") \
+    X(SEC_WEBSOCKET_EXTENSIONS,         "Sec-WebSocket-Extensions") \
+    X(SEC_WEBSOCKET_KEY,                "Sec-WebSocket-Key") \
+    X(SEC_WEBSOCKET_PROTOCOL,           "Sec-WebSocket-Protocol") \
+    X(SEC_WEBSOCKET_VERSION,            "Sec-WebSocket-Version") \
+    X(TE,                               "TE") \
+    X(TRAILER,                          "Trailer") \
+    X(TRANSFER_ENCODING,                "Transfer-Encoding") \
+    X(UPGRADE,                          "Upgrade") \
+    X(UPGRADE_INSECURE_REQUESTS,        "Upgrade-Insecure-Requests") \
+    X(USER_AGENT,                       "User-Agent") \
+    X(VIA,                              "Via") \
+    X(WARNING,                          "Warning") \
+    X(X_FORWARDED_FOR,                  "X-Forwarded-For") \
+    X(X_FORWARDED_HOST,                 "X-Forwarded-Host") \
+    X(X_FORWARDED_PROTO,                "X-Forwarded-Proto") \
+    X(X_REAL_IP,                        "X-Real-IP") \
+    X(X_REQUEST_ID,                     "X-Request-ID") \
+    X(X_REQUESTED_WITH,                 "X-Requested-With")
+
+#define HTTP_HEADER_ENUM(id, name)      HTTP_HEADER_##id,
+
+/* 首部字段编号， 0 表示未知的首部字段 */
+enum {
+    HTTP_HEADER_UNKNOWN = 0,
+    HTTP_HEADERS(HTTP_HEADER_ENUM)
+    HTTP_HEADER_NUM
+};
+
+/*
+ * 字段名的哈希：长度与第一、第二、中间、倒数第二、最后一个字节拼成 64 位的键，乘以 HTTP_HEADER_HASH_MUL 后取最高的
+ * HTTP_HEADER_HASH_BITS 位作为槽。只读固定的几个字节，代价与字段名长度无关；
+ * 字节均 | 0x20 ， token 字符中只有字母受影响，所以哈希不区分大小写。 len 至少为 1 。
+ */
+#define HTTP_HEADER_HASH_BITS           8
+#define HTTP_HEADER_HASH_SIZE           (1 << HTTP_HEADER_HASH_BITS)
+
+#define http_header_hash_byte(name, i)  ((uint64_t)((name)[i] | 0x20))
+#define http_header_hash_key(name, len) \
+    ((uint64_t)(len) | http_header_hash_byte(name, 0) << 8 | http_header_hash_byte(name, (len) > 1) << 16 | \
+     http_header_hash_byte(name, (len) / 2) << 24 | http_header_hash_byte(name, (len) - 1 - ((len) > 1)) << 32 | \
+     http_header_hash_byte(name, (len) - 1) << 40)
+#define http_header_hash_slot(key)      ((unsigned)(((key) * HTTP_HEADER_HASH_MUL) >> (64 - HTTP_HEADER_HASH_BITS)))
+
+/* 按编号索引的字段名与长度 */
+extern const char* const http_header_names[HTTP_HEADER_NUM];
+extern const unsigned char http_header_lens[HTTP_HEADER_NUM];
+
+/*
+ * 查找长度为 len 的字段名的编号，不区分大小写，不是已知的首部字段时返回 HTTP_HEADER_UNKNOWN 。
+ */
+unsigned http_header_id(const unsigned char* name, size_t len);
+
+#endif /* _HTTP_HEADER_H_ */
@@ -0,0 +1,80 @@
+/**
+ * @author ttoobne
+ * @date 2026/10/17
+ */
+
+/* 由 test/gen_header_hash.c 生成，不要手动修改。 */
+
+#ifndef _HTTP_HEADER_HASH_H_
+#define _HTTP_HEADER_HASH_H_
+
+#include "http_header.h"
+
+#define HTTP_HEADER_HASH_MUL    0x59cfa0565a0f8ad1ull
+
+/* 槽到首部字段编号，空槽为 HTTP_HEADER_UNKNOWN */
+static const unsigned char http_header_slots[HTTP_HEADER_HASH_SIZE] = {
+    [  7] = HTTP_HEADER_CONTENT_LENGTH,
+    [ 12] = HTTP_HEADER_TE,
+    [ 13] = HTTP_HEADER_EARLY_DATA,
+    [ 19] = HTTP_HEADER_IF_UNMODIFIED_SINCE,
+    [ 21] = HTTP_HEADER_COOKIE,
+    [ 30] = HTTP_HEADER_EXPECT,
+    [ 31] = HTTP_HEADER_X_REAL_IP,
+    [ 32] = HTTP_HEADER_SEC_CH_UA,
+    [ 37] = HTTP_HEADER_SEC_FETCH_MODE,
+    [ 38] = HTTP_HEADER_ACCESS_CONTROL_REQUEST_METHOD,
+    [ 50] = HTTP_HEADER_X_FORWARDED_FOR,
+    [ 66] = HTTP_HEADER_UPGRADE,
+    [ 73] = HTTP_HEADER_SEC_FETCH_USER,
+    [ 75] = HTTP_HEADER_ACCEPT,
+    [ 81] = HTTP_HEADER_PRAGMA,
+    [ 84] = HTTP_HEADER_DATE,
+    [ 85] = HTTP_HEADER_SEC_FETCH_DEST,
+    [ 90] = HTTP_HEADER_X_FORWARDED_HOST,
+    [ 95] = HTTP_HEADER_X_REQUESTED_WITH,
+    [ 98] = HTTP_HEADER_IF_MODIFIED_SINCE,
+    [111] = HTTP_HEADER_RANGE,
+    [112] = HTTP_HEADER_SEC_PURPOSE,
+    [113] = HTTP_HEADER_CONNECTION,
+    [114] = HTTP_HEADER_CONTENT_ENCODING,
+    [142] = HTTP_HEADER_ACCEPT_CHARSET,
+    [144] = HTTP_HEADER_HOST,
+    [147] = HTTP_HEADER_TRANSFER_ENCODING,
+    [155] = HTTP_HEADER_CACHE_CONTROL,
+    [163] = HTTP_HEADER_FROM,
+    [166] = HTTP_HEADER_PRIORITY,
+    [168] = HTTP_HEADER_AUTHORIZATION,
+    [174] = HTTP_HEADER_PROXY_CONNECTION,
+    [175] = HTTP_HEADER_CONTENT_TYPE,
+    [177] = HTTP_HEADER_REFERER,
+    [181] = HTTP_HEADER_PROXY_AUTHORIZATION,
+    [182] = HTTP_HEADER_IF_MATCH,
+    [183] = HTTP_HEADER_SEC_WEBSOCKET_VERSION,
+    [186] = HTTP_HEADER_FORWARDED,
+    [188] = HTTP_HEADER_ACCEPT_LANGUAGE,
+    [189] = HTTP_HEADER_ACCESS_CONTROL_REQUEST_HEADERS,
+    [190] = HTTP_HEADER_SEC_CH_UA_PLATFORM,
+    [192] = HTTP_HEADER_X_FORWARDED_PROTO,
+    [193] = HTTP_HEADER_SEC_WEBSOCKET_EXTENSIONS,
+    [195] = HTTP_HEADER_VIA,
+    [198] = HTTP_HEADER_SEC_FETCH_SITE,
+    [199] = HTTP_HEADER_WARNING,
+    [204] = HTTP_HEADER_X_REQUEST_ID,
+    [206] = HTTP_HEADER_TRAILER,
+    [207] = HTTP_HEADER_SEC_WEBSOCKET_KEY,
+    [208] = HTTP_HEADER_IF_NONE_MATCH,
+    [226] = HTTP_HEADER_USER_AGENT,
+    [228] = HTTP_HEADER_ORIGIN,
+    [229] = HTTP_HEADER_DNT,
+    [233] = HTTP_HEADER_KEEP_ALIVE,
+    [235] = HTTP_HEADER_SEC_WEBSOCKET_PROTOCOL,
+    [239] = HTTP_HEADER_IF_RANGE,
+    [240] = HTTP_HEADER_PURPOSE,
+    [245] = HTTP_HEADER_ACCEPT_ENCODING,
+    [251] = HTTP_HEADER_MAX_FORWARDS,
+    [252] = HTTP_HEADER_SEC_CH_UA_MOBILE,
+    [254] = HTTP_HEADER_UPGRADE_INSECURE_REQUESTS,
+};
+
+#endif /* _HTTP_HEADER_HASH_H_ */
@@ -0,0 +1,451 @@
+/**
+ * @author ttoobne
+ * @date 2026/10/17
+ */
+
+#include "http_output.h"
+
+#include "config.h"
+#include "log.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/sendfile.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+static int output_mode = STATIC_SENDFILE;           /* 静态文件的发送方式 */
+static size_t output_copy_max = STATICCOPY_DEF;     /* 读入内存的文件区间大小上限 */
+
+static http_output_t* http_output_alloc(http_request_t* rq, unsigned type, size_t extra);
+static int http_output_read(http_request_t* rq, http_file_t* file, off_t offset, size_t len);
+static int http_output_map(http_output_t* output);
+static ssize_t http_output_sendfile(http_request_t* rq, http_output_t* output, size_t len);
+static size_t http_output_remain(http_output_t* output);
+static void http_output_consume(http_request_t* rq, size_t n);
+static void http_output_free(http_output_t* output);
+
+/*
+ * 设置静态文件的发送方式： mode 为 STATIC_SENDFILE 或 STATIC_MMAP ，不超过 copy_max 字节的文件区间读入内存。
+ * 应在启动工作线程之前调用；不调用时使用 sendfile 。
+ */
+void http_output_init(int mode, size_t copy_max) {
+    output_mode = mode;
+    output_copy_max = copy_max;
+}
+
+/*
+ * 复制 len 字节的 data 追加到输出队列。
+ * 成功返回 0 ，失败返回 -1 。
+ */
+int http_output_buf(http_request_t* rq, const void* data, size_t len) {
+    struct iovec iov;
+
+    iov.iov_base = (void*)data;
+    iov.iov_len = len;
+
+    return http_output_bufv(rq, &iov, 1);
+}
+
+/*
+ * 把 iovcnt 段数据依次复制到同一个缓冲区中追加到输出队列，如响应头部与内存中的响应体。
+ * 成功返回 0 ，失败返回 -1 。
+ */
+int http_output_bufv(http_request_t* rq, const struct iovec* iov, int iovcnt) {
+    http_output_t* output;
+    size_t len;
+    int i;
+
+    len = 0;
+
+    for (i = 0; i < iovcnt; ++ i) {
+        len += iov[i].iov_len;
+    }
+
+    if (len == 0) {
+        return 0;
+    }
+
+    /* 数据紧跟在节点之后，一次分配 */
+    if ((output = http_output_alloc(rq, OUTPUT_BUF, len)) == NULL) {
+        return -1;
+    }
+
+    output->data = (char*)(output + 1);
+    output->len = len;
+
+    for (i = 0, len = 0; i < iovcnt; ++ i) {
+        memcpy(output->data + len, iov[i].iov_base, iov[i].iov_len);
+        len += iov[i].iov_len;
+    }
+
+    return 0;
+}
+
+/*
+ * 将缓存条目 cached 中 len 字节的 data 追加到输出队列，不复制。
+ * 无论成功与否，调用者持有的 cached 的引用都转交给输出队列。成功返回 0 ，失败返回 -1 。
+ */
+int http_output_cached(http_request_t* rq, http_cached_t* cached, const char* data, size_t len) {
+    http_output_t* output;
+
+    if (len == 0) {
+        http_cached_release(cached);
+        return 0;
+    }
+
+    if ((output = http_output_alloc(rq, OUTPUT_CACHED, 0)) == NULL) {
+        http_cached_release(cached);
+        return -1;
+    }
+
+    output->cached = cached;
+    output->data = (char*)data;
+    output->len = len;
+
+    return 0;
+}
+
+/*
+ * 将文件 file 的 [offset, offset + len) 区间追加到输出队列。不超过 copy_max 的区间读入内存；
+ * 其余的按发送方式用 sendfile 发送，或者小文件整体映射、大文件按窗口映射。
+ * 无论成功与否，调用者持有的 file 的引用都转交给输出队列。成功返回 0 ，失败返回 -1 。
+ */
+int http_output_file(http_request_t* rq, http_file_t* file, off_t offset, off_t len) {
+    http_output_t* output;
+    unsigned type;
+
+    if (len <= 0) {
+        http_file_release(file);
+        return 0;
+    }
+
+    /* 小文件复制一次的代价低于建立映射，并且可以与响应头部合并为一次 writev */
+    if (len <= (off_t)output_copy_max) {
+        return http_output_read(rq, file, offset, len);
+    }
+
+    if (output_mode == STATIC_SENDFILE) {
+        type = OUTPUT_SENDFILE;
+    } else {
+        type = len > OUTPUT_WINDOW ? OUTPUT_FILE : OUTPUT_MMAP;
+    }
+
+    if ((output = http_output_alloc(rq, type, 0)) == NULL) {
+        http_file_release(file);
+        return -1;
+    }
+
+    output->file = file;
+    output->fd = file->fd;
+    output->offset = offset;
+    output->end = offset + len;
+
+    if (output->type != OUTPUT_MMAP) {
+        return 0;
+    }
+
+    /* 小文件一次映射完毕后即可释放 */
+    if (http_output_map(output) != 0) {
+        list_del(&(output->list_node));
+        http_output_free(output);
+        return -1;
+    }
+
+    http_file_release(file);
+    output->file = NULL;
+    output->fd = -1;
+    output->data = output->window + (offset - output->window_off);
+    output->len = len;
+
+    return 0;
+}
+
+/*
+ * 发送输出队列，每次最多发送 OUTPUT_SLICE 字节。
+ * 全部发送完毕返回 REQUEST_OK ，套接字已写满或达到本次上限返回 REQUEST_AGAIN ，出错返回 REQUEST_ERROR 。
+ */
+int http_output_flush(http_request_t* rq) {
+    struct iovec iov[OUTPUT_IOV_MAX];
+    struct msghdr msg;
+    http_output_t* output;
+    list_head_t* head;
+    list_head_t* pos;
+    size_t budget;
+    size_t left;
+    size_t len;
+    ssize_t n;
+    int flags;
+
+    head = &(rq->output_list_head);
+    budget = OUTPUT_SLICE;
+
+    while (!list_empty(head)) {
+        /* 达到本次上限，让出线程给其他连接 */
+        if (budget == 0) {
+            return REQUEST_AGAIN;
+        }
+
+        output = list_entry(head->next, http_output_t, list_node);
+
+        if (output->type == OUTPUT_SENDFILE) {
+            n = http_output_sendfile(rq, output, budget);
+        } else {
+            /* 将队首的若干输出合并为一次 sendmsg ，遇到 sendfile 的输出为止 */
+            memset(&msg, 0, sizeof(msg));
+            msg.msg_iov = iov;
+            left = budget;
+            flags = 0;
+
+            list_for_each(pos, head) {
+                output = list_entry(pos, http_output_t, list_node);
+
+                /* 紧接着 sendfile 时暂缓发出不满一个报文段的尾部，让头部与文件内容合并成报文段 */
+                if (output->type == OUTPUT_SENDFILE) {
+                    flags = MSG_MORE;
+                    break;
+                }
+
+                if (output->type == OUTPUT_FILE) {
+                    if (http_output_map(output) != 0) {
+                        return REQUEST_ERROR;
+                    }
+
+                    iov[msg.msg_iovlen].iov_base = output->window + (output->offset - output->window_off);
+                    len = output->window_off + output->window_len - output->offset;
+                } else {
+                    iov[msg.msg_iovlen].iov_base = output->data + output->pos;
+                    len = output->len - output->pos;
+                }
+
+                if (len > left) {
+                    len = left;
+                }
+
+                iov[msg.msg_iovlen ++ ].iov_len = len;
+                left -= len;
+
+                /* 窗口之后还有未映射的部分时，后面的输出不能提前发送 */
+                if (msg.msg_iovlen == OUTPUT_IOV_MAX || left == 0 || len < http_output_remain(output)) {
+                    break;
+                }
+            }
+
+            n = sendmsg(rq->fd, &msg, flags);
+        }
+
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                return REQUEST_AGAIN;
+            }
+
+            log_error("send output error.");
+            return REQUEST_ERROR;
+        }
+
+        budget -= n;
+        http_output_consume(rq, n);
+    }
+
+    return REQUEST_OK;
+}
+
+/*
+ * 输出队列是否为空。
+ */
+int http_output_empty(http_request_t* rq) {
+    return list_empty(&(rq->output_list_head));
+}
+
+/*
+ * 丢弃输出队列中的所有输出并释放资源。
+ */
+void http_output_clear(http_request_t* rq) {
+    http_output_t* output;
+    list_head_t* head;
+
+    head = &(rq->output_list_head);
+
+    while (!list_empty(head)) {
+        output = list_entry(head->next, http_output_t, list_node);
+        list_del(&(output->list_node));
+        http_output_free(output);
+    }
+}
+
+/*
+ * 分配一个输出并追加到队尾， extra 为紧跟在节点之后的数据长度。
+ */
+static http_output_t* http_output_alloc(http_request_t* rq, unsigned type, size_t extra) {
+    http_output_t* output;
+
+    if ((output = (http_output_t*)malloc(sizeof(http_output_t) + extra)) == NULL) {
+        log_error("http_output_t malloc failed.");
+        return NULL;
+    }
+
+    memset(output, 0, sizeof(http_output_t));
+    output->type = type;
+    output->fd = -1;
+
+    list_add_tail(&(output->list_node), &(rq->output_list_head));
+
+    return output;
+}
+
+/*
+ * 把文件区间读入内存追加到输出队列，读完后释放文件。
+ * 成功返回 0 ，失败返回 -1 。
+ */
+static int http_output_read(http_request_t* rq, http_file_t* file, off_t offset, size_t len) {
+    http_output_t* output;
+    size_t done;
+    ssize_t n;
+
+    if ((output = http_output_alloc(rq, OUTPUT_BUF, len)) == NULL) {
+        http_file_release(file);
+        return -1;
+    }
+
+    output->data = (char*)(output + 1);
+    output->len = len;
+
+    for (done = 0; done < len; done += n) {
+        if ((n = pread(file->fd, output->data + done, len - done, offset + done)) > 0) {
+            continue;
+        }
+
+        if (n < 0 && errno == EINTR) {
+            n = 0;
+            continue;
+        }
+
+        /* 文件被截断或读取出错 */
+        log_error("read file error.");
+        http_file_release(file);
+        list_del(&(output->list_node));
+        http_output_free(output);
+        return -1;
+    }
+
+    http_file_release(file);
+
+    return 0;
+}
+
+/*
+ * 保证文件区间的下一个字节在映射的窗口中，窗口起始按页对齐。
+ * 成功返回 0 ，失败返回 -1 。
+ */
+static int http_output_map(http_output_t* output) {
+    off_t start;
+    size_t len;
+
+    if (output->window && output->offset < output->window_off + (off_t)output->window_len) {
+        return 0;
+    }
+
+    if (output->window) {
+        munmap(output->window, output->window_len);
+        output->window = NULL;
+    }
+
+    start = output->offset & ~((off_t)sysconf(_SC_PAGESIZE) - 1);
+    len = output->end - start;
+
+    if (output->type == OUTPUT_FILE && len > OUTPUT_WINDOW) {
+        len = OUTPUT_WINDOW;
+    }
+
+    if ((output->window = mmap(NULL, len, PROT_READ, MAP_PRIVATE, output->fd, start)) == MAP_FAILED) {
+        output->window = NULL;
+        log_error("mmap error.");
+        return -1;
+    }
+
+    output->window_off = start;
+    output->window_len = len;
+
+    return 0;
+}
+
+/*
+ * 用 sendfile 发送文件区间，最多发送 len 字节，偏移由 http_output_consume 推进。
+ * 返回发送的字节数，出错返回 -1 并设置 errno ；文件被截断时视为出错。
+ */
+static ssize_t http_output_sendfile(http_request_t* rq, http_output_t* output, size_t len) {
+    off_t offset;
+    ssize_t n;
+
+    if (len > (size_t)(output->end - output->offset)) {
+        len = output->end - output->offset;
+    }
+
+    offset = output->offset;
+
+    if ((n = sendfile(rq->fd, output->fd, &offset, len)) == 0) {
+        log_error("file truncated while sending.");
+        errno = EIO;
+        return -1;
+    }
+
+    return n;
+}
+
+/*
+ * 输出尚未发送的字节数。
+ */
+static size_t http_output_remain(http_output_t* output) {
+    if (output->type == OUTPUT_FILE || output->type == OUTPUT_SENDFILE) {
+        return output->end - output->offset;
+    }
+
+    return output->len - output->pos;
+}
+
+/*
+ * 从队首开始标记 n 字节已发送，释放发送完毕的输出。
+ */
+static void http_output_consume(http_request_t* rq, size_t n) {
+    http_output_t* output;
+    size_t remain;
+
+    while (n > 0 && !list_empty(&(rq->output_list_head))) {
+        output = list_entry(rq->output_list_head.next, http_output_t, list_node);
+        remain = http_output_remain(output);
+
+        if (n < remain) {
+            if (output->type == OUTPUT_FILE || output->type == OUTPUT_SENDFILE) {
+                output->offset += n;
+            } else {
+                output->pos += n;
+            }
+
+            return;
+        }
+
+        n -= remain;
+        list_del(&(output->list_node));
+        http_output_free(output);
+    }
+}
+
+/*
+ * 释放一个输出占用的资源。
+ */
+static void http_output_free(http_output_t* output) {
+    if (output->window) {
+        munmap(output->window, output->window_len);
+    }
+
+    http_cached_release(output->cached);
+    http_file_release(output->file);
+    free(output);
+}
@@ -0,0 +1,93 @@
+/**
+ * @author ttoobne
+ * @date 2026/10/17
+ */
+
+#ifndef _HTTP_OUTPUT_H_
+#define _HTTP_OUTPUT_H_
+
+#include "http_file_cache.h"
+#include "http_request.h"
+#include "http_response_cache.h"
+#include "list.h"
+
+#include <sys/types.h>
+#include <sys/uio.h>
+
+#define OUTPUT_BUF          0           /* 内存缓冲区，随节点一起释放 */
+#define OUTPUT_MMAP         1           /* 映射到内存的整个文件，发送完毕后 munmap */
+#define OUTPUT_FILE         2           /* 文件区间，每次只映射一个窗口，发送完毕后释放文件 */
+#define OUTPUT_SENDFILE     3           /* 文件区间，用 sendfile 从页缓存直接发送，发送完毕后释放文件 */
+#define OUTPUT_CACHED       4           /* 缓存的响应中的一段内存，发送完毕后释放缓存条目 */
+
+#define OUTPUT_WINDOW       (1 << 20)   /* 文件区间每次映射的大小，不超过它的文件整体映射 */
+#define OUTPUT_SLICE        (1 << 20)   /* 每次 http_output_flush 最多发送的字节数，超过则让出线程 */
+#define OUTPUT_IOV_MAX      32          /* 每次 writev 最多合并的输出数，足够容纳一批流水线响应 */
+
+/* 输出队列中的一项。 */
+typedef struct {
+    list_head_t         list_node;      /* 连入输出队列 */
+    unsigned            type;           /* 输出类型 */
+
+    char*               data;           /* OUTPUT_BUF 、 OUTPUT_MMAP 与 OUTPUT_CACHED ：起始地址 */
+    size_t              len;            /* 总长度 */
+    size_t              pos;            /* 已发送的字节数 */
+
+    http_cached_t*      cached;         /* OUTPUT_CACHED ：持有引用的缓存条目 */
+    http_file_t*        file;           /* OUTPUT_FILE 与 OUTPUT_SENDFILE ：持有引用的文件 */
+    int                 fd;             /* 文件描述符，即 file->fd */
+    off_t               offset;         /* 下一个要发送的文件偏移 */
+    off_t               end;            /* 区间结束的文件偏移 */
+    char*               window;         /* 当前映射的窗口 */
+    off_t               window_off;     /* 窗口起始的文件偏移，按页对齐 */
+    size_t              window_len;     /* 窗口长度 */
+} http_output_t;
+
+/*
+ * 设置静态文件的发送方式： mode 为 STATIC_SENDFILE 或 STATIC_MMAP ，不超过 copy_max 字节的文件区间读入内存。
+ * 应在启动工作线程之前调用；不调用时使用 sendfile 。
+ */
+void http_output_init(int mode, size_t copy_max);
+
+/*
+ * 复制 len 字节的 data 追加到输出队列。
+ * 成功返回 0 ，失败返回 -1 。
+ */
+int http_output_buf(http_request_t* rq, const void* data, size_t len);
+
+/*
+ * 把 iovcnt 段数据依次复制到同一个缓冲区中追加到输出队列，如响应头部与内存中的响应体。
+ * 成功返回 0 ，失败返回 -1 。
+ */
+int http_output_bufv(http_request_t* rq, const struct iovec* iov, int iovcnt);
+
+/*
+ * 将缓存条目 cached 中 len 字节的 data 追加到输出队列，不复制。
+ * 无论成功与否，调用者持有的 cached 的引用都转交给输出队列。成功返回 0 ，失败返回 -1 。
+ */
+int http_output_cached(http_request_t* rq, http_cached_t* cached, const char* data, size_t len);
+
+/*
+ * 将文件 file 的 [offset, offset + len) 区间追加到输出队列。不超过 copy_max 的区间读入内存；
+ * 其余的按发送方式用 sendfile 发送，或者小文件整体映射、大文件按窗口映射。
+ * 无论成功与否，调用者持有的 file 的引用都转交给输出队列。成功返回 0 ，失败返回 -1 。
+ */
+int http_output_file(http_request_t* rq, http_file_t* file, off_t offset, off_t len);
+
+/*
+ * 发送输出队列，每次最多发送 OUTPUT_SLICE 字节。
+ * 全部发送完毕返回 REQUEST_OK ，套接字已写满或达到本次上限返回 REQUEST_AGAIN ，出错返回 REQUEST_ERROR 。
+ */
+int http_output_flush(http_request_t* rq);
+
+/*
+ * 输出队列是否为空。
+ */
+int http_output_empty(http_request_t* rq);
+
+/*
+ * 丢弃输出队列中的所有输出并释放资源。
+ */
+void http_output_clear(http_request_t* rq);
+
+#endif /* _HTTP_OUTPUT_H_ */
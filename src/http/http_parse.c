@@ -5,11 +5,15 @@
 
 #include "http_parse.h"
 
+#include "http_header.h"
 #include "http_request.h"
-#include "list.h"
+#include "http_scan.h"
 
 #include <stdlib.h>
 
+static unsigned char* http_trim_value(http_request_t* rq, unsigned char* eol);
+static int http_add_header(http_request_t* rq);
+
 /*
  * 解析请求行。
  */
@@ -150,6 +154,8 @@ int http_parse_request_line(void* http_request) {
                 break;
 
             default:
+                /* 跳过 uri 中的普通字符，停在下一个空格或 '?' 之前 */
+                p = http_scan_uri(p + 1, rq->bufed) - 1;
                 break;
             }
 
@@ -348,7 +354,6 @@ done:
  */
 int http_parse_request_headers(void* http_request) {
     http_request_t* rq;
-    http_header_t* cur_header;
     unsigned char ch;
     unsigned char* p;
 
@@ -362,7 +367,6 @@ int http_parse_request_headers(void* http_request) {
         spaces_after_name,
         spaces_after_colon,
         value,
-        spaces_after_value,
         cur_header_almost_done,
         almost_done
     } state;
@@ -389,6 +393,10 @@ int http_parse_request_headers(void* http_request) {
                 goto done;
 
             default:
+                if (!http_token_char(ch)) {
+                    return HTTP_PARSE_INVALID_HEADER;
+                }
+
                 rq->cur_header_name_start = p;
                 state = name;
                 break;
@@ -411,6 +419,12 @@ int http_parse_request_headers(void* http_request) {
                 break;
             
             default:
+                if (!http_token_char(ch)) {
+                    return HTTP_PARSE_INVALID_HEADER;
+                }
+
+                /* 跳过字段名中的 token 字符 */
+                p = http_scan_token(p + 1, rq->bufed) - 1;
                 break;
             }
 
@@ -437,84 +451,66 @@ int http_parse_request_headers(void* http_request) {
             switch (ch) {
             case ' ':
                 break;
-            
-            default:
-                rq->cur_header_value_start = p;
-                state = value;
-                break;
-            }
-
-            break;  /* case spaces_after_colon */
-
-        /* 首部字段值 */
-        case value:
-            //DBG("value.\n");
-            switch (ch) {
-            case ' ':
-                rq->cur_header_value_end = p - 1;
-                state = spaces_after_value;
-                break;
 
+            /* 字段值为空 */
             case CR:
+                rq->cur_header_value_start = p;
                 rq->cur_header_value_end = p - 1;
                 state = cur_header_almost_done;
                 break;
-            
+
             case LF:
+                rq->cur_header_value_start = p;
                 rq->cur_header_value_end = p - 1;
 
-                cur_header = (http_header_t*)malloc(sizeof(http_header_t));
-                cur_header->header_name_start = rq->cur_header_name_start;
-                cur_header->header_name_end = rq->cur_header_name_end;
-                cur_header->header_value_start = rq->cur_header_value_start;
-                cur_header->header_value_end = rq->cur_header_value_end;
-                list_add(&(cur_header->list_node), &(rq->headers_list_head));
+                if (http_add_header(rq) != 0) {
+                    return HTTP_PARSE_INVALID_HEADER;
+                }
 
                 state = start;  /* 继续解析下一行的首部字段 */
                 break;
             
             default:
+                rq->cur_header_value_start = p;
+                state = value;
                 break;
             }
 
-            break;  /* case value */
+            break;  /* case spaces_after_colon */
 
-        case spaces_after_value:
+        /* 首部字段值，字段值中可以有空格，结尾的空格不属于字段值 */
+        case value:
+            //DBG("value.\n");
             switch (ch) {
-            case ' ':
-                break;
-            
             case CR:
+                rq->cur_header_value_end = http_trim_value(rq, p);
                 state = cur_header_almost_done;
                 break;
-
+            
             case LF:
-                cur_header = (http_header_t*)malloc(sizeof(http_header_t));
-                cur_header->header_name_start = rq->cur_header_name_start;
-                cur_header->header_name_end = rq->cur_header_name_end;
-                cur_header->header_value_start = rq->cur_header_value_start;
-                cur_header->header_value_end = rq->cur_header_value_end;
-                list_add(&(cur_header->list_node), &(rq->headers_list_head));
+                rq->cur_header_value_end = http_trim_value(rq, p);
+
+                if (http_add_header(rq) != 0) {
+                    return HTTP_PARSE_INVALID_HEADER;
+                }
 
                 state = start;  /* 继续解析下一行的首部字段 */
                 break;
-
+            
             default:
-                state = value;  /* 首部字段值可能会有空格 */
+                /* 跳到行尾 */
+                p = http_scan_line(p + 1, rq->bufed) - 1;
                 break;
             }
 
-            break;  /* case spaces_after_value */
-            
+            break;  /* case value */
+
         case cur_header_almost_done:
             switch (ch) {
             case LF:
-                cur_header = (http_header_t*)malloc(sizeof(http_header_t));
-                cur_header->header_name_start = rq->cur_header_name_start;
-                cur_header->header_name_end = rq->cur_header_name_end;
-                cur_header->header_value_start = rq->cur_header_value_start;
-                cur_header->header_value_end = rq->cur_header_value_end;
-                list_add(&(cur_header->list_node), &(rq->headers_list_head));
+                if (http_add_header(rq) != 0) {
+                    return HTTP_PARSE_INVALID_HEADER;
+                }
 
                 state = start;  /* 继续解析下一行的首部字段 */
                 break;
@@ -560,4 +556,49 @@ done:
     rq->state = start;
 
     return REQUEST_OK;
-}
\ No newline at end of file
+}
+
+/*
+ * 去掉字段值结尾的空格， eol 为行尾的 CR 或 LF ，返回字段值最后一个字符的位置。
+ * 字段值的第一个字符不是空格，所以不会越过字段值的开头。
+ */
+static unsigned char* http_trim_value(http_request_t* rq, unsigned char* eol) {
+    unsigned char* p;
+
+    for (p = eol - 1; p > (unsigned char*)rq->cur_header_value_start && *p == ' '; -- p) {
+    }
+
+    return p;
+}
+
+/*
+ * 把解析完的首部字段加入请求并查出已知首部字段的编号，
+ * 前 HTTP_HEADERS_INLINE 个直接保存在请求结构体内，超出时才分配溢出区。
+ * 成功返回 0 ，首部字段超过 HTTP_HEADERS_MAX 个或分配溢出区失败时返回 -1 。
+ */
+static int http_add_header(http_request_t* rq) {
+    http_header_t* cur_header;
+
+    if (rq->headers_num >= HTTP_HEADERS_MAX) {
+        return -1;
+    }
+
+    if (rq->headers_num == HTTP_HEADERS_INLINE && rq->headers_spill == NULL) {
+        rq->headers_spill = (http_header_t*)malloc((HTTP_HEADERS_MAX - HTTP_HEADERS_INLINE) * sizeof(http_header_t));
+
+        if (rq->headers_spill == NULL) {
+            return -1;
+        }
+    }
+
+    cur_header = http_request_header(rq, rq->headers_num);
+    cur_header->id = http_header_id(rq->cur_header_name_start,
+                                    (unsigned char*)rq->cur_header_name_end - (unsigned char*)rq->cur_header_name_start + 1);
+    cur_header->header_name_start = rq->cur_header_name_start;
+    cur_header->header_name_end = rq->cur_header_name_end;
+    cur_header->header_value_start = rq->cur_header_value_start;
+    cur_header->header_value_end = rq->cur_header_value_end;
+    rq->headers_num ++ ;
+
+    return 0;
+}
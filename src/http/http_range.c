@@ -0,0 +1,208 @@
+/**
+ * @author ttoobne
+ * @date 2026/10/17
+ */
+
+#include "http_range.h"
+
+#include "http_builder.h"
+#include "log.h"
+
+#include <strings.h>
+
+static const char* parse_offset(const char* p, const char* ed, off_t size, off_t* n);
+
+/*
+ * 解析 Range 字段值 [st, ed] ，选出长度为 size 的文件中可满足的区间，保存至 first 与 last （包含），
+ * 两个数组至少有 HTTP_RANGES_MAX 个元素，区间数保存至 num 。
+ * 有可满足的区间时返回 HTTP_PARTIAL_CONTENT ，区间都从文件末尾之后开始时返回 HTTP_RANGE_NOT_SATISFIABLE ；
+ * 格式错误、区间多于 HTTP_RANGES_MAX 或总长度超过文件长度（重叠的区间会成倍放大响应）时返回 HTTP_OK ，
+ * 此时忽略 Range 发送整个文件。
+ */
+unsigned http_range_parse(const char* st, const char* ed, off_t size, off_t* first, off_t* last, unsigned* num) {
+    const char* p;
+    off_t start;
+    off_t end;
+    off_t total;
+    unsigned valid;
+    unsigned n;
+
+    if (ed - st + 1 < 6 || strncasecmp(st, "bytes=", 6) != 0) {
+        return HTTP_OK;
+    }
+
+    total = 0;
+    valid = 0;
+    n = 0;
+
+    for (p = st + 6; p <= ed; ) {
+        /* 跳过空白与空的列表元素 */
+        if (*p == ' ' || *p == '\t' || *p == ',') {
+            p ++ ;
+            continue;
+        }
+
+        start = -1;
+        end = -1;
+
+        if (*p >= '0' && *p <= '9') {
+            p = parse_offset(p, ed, size, &start);
+        }
+
+        if (p > ed || *p != '-') {
+            return HTTP_OK;
+        }
+
+        p ++ ;
+
+        if (p <= ed && *p >= '0' && *p <= '9') {
+            p = parse_offset(p, ed, size, &end);
+        }
+
+        while (p <= ed && (*p == ' ' || *p == '\t')) {
+            p ++ ;
+        }
+
+        if ((p <= ed && *p != ',') || (start < 0 && end < 0) || (start >= 0 && end >= 0 && end < start)) {
+            return HTTP_OK;
+        }
+
+        valid ++ ;
+
+        if (start < 0) {
+            /* 后缀区间：文件的最后 end 字节 */
+            if (end == 0 || size == 0) {
+                continue;
+            }
+
+            start = end < size ? size - end : 0;
+            end = size - 1;
+        } else {
+            if (start >= size) {
+                continue;
+            }
+
+            if (end < 0 || end >= size) {
+                end = size - 1;
+            }
+        }
+
+        total += end - start + 1;
+
+        if (n == HTTP_RANGES_MAX || total > size) {
+            return HTTP_OK;
+        }
+
+        first[n] = start;
+        last[n] = end;
+        n ++ ;
+    }
+
+    if (valid == 0) {
+        return HTTP_OK;
+    }
+
+    *num = n;
+
+    return n > 0 ? HTTP_PARTIAL_CONTENT : HTTP_RANGE_NOT_SATISFIABLE;
+}
+
+/*
+ * 生成 multipart/byteranges 响应体的各部分：长度为 size 、类型为 mime 的文件的 num 个区间，分隔符为 delimiter 。
+ * 分隔行与部分头部写入 resp->page ，各部分保存至 resp->parts ，最后一部分只有结束分隔行。返回响应体的总长度。
+ */
+off_t http_range_multipart(http_response_t* resp, const char* delimiter, const char* mime, off_t size,
+                           const off_t* first, const off_t* last, unsigned num) {
+    http_part_t* part;
+    http_builder_t b;
+    off_t length;
+    unsigned i;
+
+    http_builder_init(&b, resp->page, MAXMSG);
+    length = 0;
+
+    for (i = 0; i <= num; ++ i) {
+        part = &(resp->parts[i]);
+        part->head_off = http_builder_len(&b);
+
+        http_builder_literal(&b, "\r\n--");
+        http_builder_str(&b, delimiter);
+
+        if (i == num) {
+            /* 结束分隔行 */
+            http_builder_literal(&b, "--\r\n");
+            part->file_off = 0;
+            part->file_len = 0;
+        } else {
+            http_builder_literal(&b, "\r\nContent-type: ");
+            http_builder_str(&b, mime);
+            http_builder_literal(&b, "\r\nContent-Range: bytes ");
+            http_builder_uint(&b, first[i]);
+            http_builder_literal(&b, "-");
+            http_builder_uint(&b, last[i]);
+            http_builder_literal(&b, "/");
+            http_builder_uint(&b, size);
+            http_builder_literal(&b, "\r\n\r\n");
+            part->file_off = first[i];
+            part->file_len = last[i] - first[i] + 1;
+        }
+
+        part->head_len = http_builder_len(&b) - part->head_off;
+        length += part->head_len + part->file_len;
+    }
+
+    if (b.overflow) {
+        log_error("multipart headers overflow.");
+    }
+
+    resp->part_num = num + 1;
+
+    return length;
+}
+
+/*
+ * 在响应头部末尾的空行之前追加 Content-Range 头部行， first 小于 0 时用星号代替区间，用于不可满足的区间响应。
+ */
+void http_range_content_range(http_response_t* resp, off_t first, off_t last, off_t size) {
+    http_builder_t b;
+
+    http_builder_init(&b, resp->headers, MAXMSG);
+    b.pos += resp->headers_len - 2;
+
+    http_builder_literal(&b, "Content-Range: bytes ");
+
+    if (first < 0) {
+        http_builder_literal(&b, "*");
+    } else {
+        http_builder_uint(&b, first);
+        http_builder_literal(&b, "-");
+        http_builder_uint(&b, last);
+    }
+
+    http_builder_literal(&b, "/");
+    http_builder_uint(&b, size);
+    http_builder_literal(&b, "\r\n\r\n");
+
+    if (b.overflow) {
+        log_error("response headers overflow.");
+    }
+
+    resp->headers_len = http_builder_len(&b);
+}
+
+/*
+ * 解析 p 开始的十进制数字，不超过 ed ，大于 size 的值按 size 处理，不会溢出。返回数字之后的位置。
+ */
+static const char* parse_offset(const char* p, const char* ed, off_t size, off_t* n) {
+    off_t v;
+
+    for (v = 0; p <= ed && *p >= '0' && *p <= '9'; ++ p) {
+        if (v <= size) {
+            v = v * 10 + (*p - '0');
+        }
+    }
+
+    *n = v <= size ? v : size;
+
+    return p;
+}
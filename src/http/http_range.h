@@ -0,0 +1,34 @@
+/**
+ * @author ttoobne
+ * @date 2026/10/17
+ */
+
+#ifndef _HTTP_RANGE_H_
+#define _HTTP_RANGE_H_
+
+#include "http.h"
+
+#include <sys/types.h>
+
+/*
+ * 解析 Range 字段值 [st, ed] ，选出长度为 size 的文件中可满足的区间，保存至 first 与 last （包含），
+ * 两个数组至少有 HTTP_RANGES_MAX 个元素，区间数保存至 num 。
+ * 有可满足的区间时返回 HTTP_PARTIAL_CONTENT ，区间都从文件末尾之后开始时返回 HTTP_RANGE_NOT_SATISFIABLE ；
+ * 格式错误、区间多于 HTTP_RANGES_MAX 或总长度超过文件长度（重叠的区间会成倍放大响应）时返回 HTTP_OK ，
+ * 此时忽略 Range 发送整个文件。
+ */
+unsigned http_range_parse(const char* st, const char* ed, off_t size, off_t* first, off_t* last, unsigned* num);
+
+/*
+ * 生成 multipart/byteranges 响应体的各部分：长度为 size 、类型为 mime 的文件的 num 个区间，分隔符为 delimiter 。
+ * 分隔行与部分头部写入 resp->page ，各部分保存至 resp->parts ，最后一部分只有结束分隔行。返回响应体的总长度。
+ */
+off_t http_range_multipart(http_response_t* resp, const char* delimiter, const char* mime, off_t size,
+                           const off_t* first, const off_t* last, unsigned num);
+
+/*
+ * 在响应头部末尾的空行之前追加 Content-Range 头部行， first 小于 0 时用星号代替区间，用于不可满足的区间响应。
+ */
+void http_range_content_range(http_response_t* resp, off_t first, off_t last, off_t size);
+
+#endif /* _HTTP_RANGE_H_ */
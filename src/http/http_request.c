@@ -6,60 +6,229 @@
 #include "http_request.h"
 
 #include "http.h"
+#include "http_buffer.h"
+#include "http_header.h"
+#include "http_output.h"
 #include "http_parse.h"
 #include "log.h"
+#include "pool.h"
 
+#include <stddef.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
 
 static int http_process_request_line(http_request_t* rq);
 static int http_process_request_headers(http_request_t* rq);
+static void http_relocate(void** ptr, unsigned char* from, unsigned char* to, ptrdiff_t delta);
 
 static int http_process_date(http_request_t* rq, http_headers_out_t* out, char* st, char* ed);
 static int http_process_connection(http_request_t* rq, http_headers_out_t* out, char* st, char* ed);
 static int http_process_if_modified_since(http_request_t* rq, http_headers_out_t* out, char* st, char* ed);
 static int http_process_if_unmodified_since(http_request_t* rq, http_headers_out_t* out, char* st, char* ed);
-
-/* 首部字段名映射到处理函数的函数指针 */
-http_headers_in_t http_headers_in[] = {
-    {"Connection", http_process_connection},
-    {"Date", http_process_date},
-    {"Host", NULL}, /* TODO: Host */
-    {"If-Modified-Since", http_process_if_modified_since},
-    {"If-Unmodified-Since", http_process_if_unmodified_since},
-    {"", NULL}
+static int http_process_range(http_request_t* rq, http_headers_out_t* out, char* st, char* ed);
+static int http_process_if_range(http_request_t* rq, http_headers_out_t* out, char* st, char* ed);
+
+/* 首部字段编号映射到处理函数的函数指针，没有处理函数的首部字段直接跳过 */
+static http_headers_handler_t* http_headers_in[HTTP_HEADER_NUM] = {
+    [HTTP_HEADER_CONNECTION] = http_process_connection,
+    [HTTP_HEADER_DATE] = http_process_date,
+    [HTTP_HEADER_HOST] = NULL, /* TODO: Host */
+    [HTTP_HEADER_IF_MODIFIED_SINCE] = http_process_if_modified_since,
+    [HTTP_HEADER_IF_UNMODIFIED_SINCE] = http_process_if_unmodified_since,
+    [HTTP_HEADER_IF_RANGE] = http_process_if_range,
+    [HTTP_HEADER_RANGE] = http_process_range,
 };
 
 /*
  * 初始化 http_request_t 结构体，如果成功返回结构体指针，失败则返回 NULL 。
+ * 结构体优先从当前事件循环的连接对象池中分配。
  */
 http_request_t* http_request_init(int fd, epoll_t* epoll, config_t* config) {
     http_request_t* rq;
 
-    if ((rq = (http_request_t*)malloc(sizeof(http_request_t))) == NULL) {
-        log_error("http_request_t malloc failed.");
+    if ((rq = (http_request_t*)pool_alloc(sizeof(http_request_t))) == NULL) {
+        log_error("http_request_t alloc failed.");
         return NULL;
     }
 
+    http_request_setup(rq, fd, epoll, config);
+
+    return rq;
+}
+
+/*
+ * 初始化已分配好的 http_request_t 结构体，供嵌入在其他结构体中的请求使用。
+ */
+void http_request_setup(http_request_t* rq, int fd, epoll_t* epoll, config_t* config) {
     rq->fd = fd;
     rq->epoll = epoll;
     rq->state = 0;
     rq->have_args = 0;
-    rq->bufst = &(rq->buf[0]);
-    rq->bufed = &(rq->buf[0]);
+    rq->buffer = NULL;                          /* 有数据到达时才挂上读缓冲区 */
+    rq->buf = NULL;
+    rq->buflast = NULL;
+    rq->bufst = NULL;
+    rq->bufed = NULL;
+    rq->large_num = 0;
+    rq->large_max = 0;
     rq->handler = http_process_request_line;    /* 初始时解析请求行 */
     rq->timer.timer_set = 0;
+    rq->timer.timeout = 0;
+    rq->timer.linked = 0;
+    rq->timer.expired = 0;
+    rq->timer.wheel = NULL;
+    rq->timer.next = NULL;
     rq->timer.handler = http_close_connection;  /* 定时器超时回调函数 */
     if (config) {
         rq->root = config->root;
         rq->defile = config->defile;
         rq->timeout = config->timeout;
+        rq->large_max = config->large_header_buffers;
     }
     
-    init_list_head(&(rq->headers_list_head));   /* 初始化链表 */
+    rq->headers_spill = NULL;
+    rq->headers_num = 0;
+    init_list_head(&(rq->output_list_head));
+    rq->output_close = 0;
+    rq->co = NULL;
+    rq->wait_events = 0;
+    rq->idle = 0;
+}
 
-    return rq;
+/*
+ * 一个请求处理完毕后重置解析状态，准备解析同一连接上的下一个请求。
+ * 更早的缓冲区只保存着已处理完的请求，全部归还；当前缓冲区中尚未解析的数据移动到缓冲区开头。
+ */
+void http_request_reset(http_request_t* rq) {
+    size_t n;
+
+    rq->state = 0;
+    rq->have_args = 0;
+    rq->handler = http_process_request_line;    /* 重新从请求行开始解析 */
+    rq->headers_num = 0;
+
+    if (rq->headers_spill) {
+        free(rq->headers_spill);
+        rq->headers_spill = NULL;
+    }
+
+    if (rq->buffer == NULL) {
+        return;
+    }
+
+    http_buffer_free(rq->buffer->next);
+    rq->buffer->next = NULL;
+    rq->large_num = rq->buffer->size == BUF_LARGE_SIZE;
+
+    n = rq->bufed - rq->bufst;
+
+    if (n > 0 && rq->bufst != &(rq->buf[0])) {
+        memmove(rq->buf, rq->bufst, n);
+    }
+
+    rq->bufst = &(rq->buf[0]);
+    rq->bufed = &(rq->buf[n]);
+}
+
+/*
+ * 为请求挂上读缓冲区，已有则不做任何事。成功返回 0 ，失败返回 -1 。
+ */
+int http_request_attach_buffer(http_request_t* rq) {
+    if (rq->buffer) {
+        return 0;
+    }
+
+    if ((rq->buffer = http_buffer_alloc(BUF_SIZE)) == NULL) {
+        return -1;
+    }
+
+    rq->buf = rq->buffer->data;
+    rq->buflast = rq->buf + rq->buffer->size;
+    rq->bufst = rq->buf;
+    rq->bufed = rq->buf;
+    rq->large_num = 0;
+
+    return 0;
+}
+
+/*
+ * 缓冲区中没有任何数据时归还读缓冲区，连接空闲期间只占用请求结构体本身。
+ * 解析到一半的请求中的指针指向缓冲区，所以只要读到过数据就不能归还，直到 http_request_reset 。
+ */
+void http_request_release_buffer(http_request_t* rq) {
+    if (rq->buffer == NULL || rq->bufed != rq->buf || rq->buffer->next) {
+        return;
+    }
+
+    http_buffer_free(rq->buffer);
+
+    rq->buffer = NULL;
+    rq->buf = NULL;
+    rq->buflast = NULL;
+    rq->bufst = NULL;
+    rq->bufed = NULL;
+}
+
+/*
+ * 当前缓冲区已满时追加一块大缓冲区，把正在解析的请求行或首部字段移到新缓冲区中继续读入。
+ * 已解析完的请求行与首部字段留在原来的缓冲区中，指向它们的指针不变，原来的缓冲区留在链中直到 http_request_reset ；
+ * 正在解析的部分一定位于当前缓冲区，指向它的指针随数据一起移动。
+ * 成功返回 0 ；大缓冲区已用完或单个请求行、首部字段超过 BUF_LARGE_SIZE 时返回 -1 。
+ */
+int http_request_grow_buffer(http_request_t* rq) {
+    http_buffer_t* buffer;
+    unsigned char* from;
+    unsigned char* live;
+    ptrdiff_t delta;
+    size_t n;
+
+    if (rq->large_num >= rq->large_max) {
+        return -1;
+    }
+
+    /* 从正在解析的请求行或首部字段的开头开始移动，没有正在解析的部分时只移动未解析的数据 */
+    from = rq->bufst;
+
+    if (rq->state != 0) {
+        live = rq->handler == http_process_request_line ? rq->request_start : rq->cur_header_name_start;
+
+        if (live >= rq->buf && live < from) {
+            from = live;
+        }
+    }
+
+    if ((n = rq->bufed - from) >= BUF_LARGE_SIZE) {
+        return -1;
+    }
+
+    if ((buffer = http_buffer_alloc(BUF_LARGE_SIZE)) == NULL) {
+        return -1;
+    }
+
+    memcpy(buffer->data, from, n);
+    delta = buffer->data - from;
+
+    http_relocate(&(rq->request_start), from, rq->bufed, delta);
+    http_relocate(&(rq->method_start), from, rq->bufed, delta);
+    http_relocate(&(rq->method_end), from, rq->bufed, delta);
+    http_relocate(&(rq->uri_start), from, rq->bufed, delta);
+    http_relocate(&(rq->args_start), from, rq->bufed, delta);
+    http_relocate(&(rq->uri_end), from, rq->bufed, delta);
+    http_relocate(&(rq->cur_header_name_start), from, rq->bufed, delta);
+    http_relocate(&(rq->cur_header_name_end), from, rq->bufed, delta);
+    http_relocate(&(rq->cur_header_value_start), from, rq->bufed, delta);
+    http_relocate(&(rq->cur_header_value_end), from, rq->bufed, delta);
+
+    buffer->next = rq->buffer;
+    rq->buffer = buffer;
+    rq->buf = buffer->data;
+    rq->buflast = rq->buf + buffer->size;
+    rq->bufst += delta;
+    rq->bufed += delta;
+    rq->large_num ++ ;
+
+    return 0;
 }
 
 /*
@@ -76,52 +245,30 @@ http_headers_out_t* http_headers_out_init() {
     out->keep_alive = 0;
     out->if_modified = 0;
     out->if_unmodified = 0;
+    out->if_range = 0;
     out->status = 0;
+    out->range_start = NULL;
+    out->range_end = NULL;
 
     return out;
 }
 
 /*
- * 分析首部字段链表中的所有首部字段，并将结果信息保存至 out 指向的结构体。
+ * 分析请求的所有首部字段，并将结果信息保存至 out 指向的结构体。
+ * 首部字段指向读缓冲区，不需要逐个释放，请求结束时由 http_request_reset 一并清空。
  */
 int http_analyze_headers(http_request_t* rq, http_headers_out_t* out) {
     http_header_t* pos;
-    list_head_t* head;
-    list_head_t* now;
-    list_head_t* next;
-    http_headers_in_t* in;
-    int len;
-
-    /* 获取链表头 */
-    head = &(rq->headers_list_head);
-
-    /* 遍历链表中的每一个节点 */
-    list_for_each_entry(pos, head, list_node) {
-        /* 对于每一个节点循环判断与每一个字段名是否匹配 */
-        len = pos->header_name_end - pos->header_name_start + 1;
-        for (in = http_headers_in; strlen(in->name) > 0; ++ in) {
-            /* 如果匹配，则执行相应处理函数 */
-            if (!strncmp(in->name, pos->header_name_start, len)) {
-                if (in->handler != NULL) {
-                    in->handler(rq, out, pos->header_value_start, pos->header_value_end);
-                }
-
-                break;
-            }
-        }
-    }
+    http_headers_handler_t* handler;
+    unsigned i;
 
-    /* 销毁链表中的所有节点 */
-    now = head->next;
-    while (now != head) {
-        next = now->next;
-        pos = list_entry(now, http_header_t, list_node);
+    for (i = 0; i < rq->headers_num; ++ i) {
+        pos = http_request_header(rq, i);
 
-        list_del(now);
-        free(pos);
-        pos = NULL;
-
-        now = next;
+        /* 解析时已查出编号，按编号直接执行相应处理函数 */
+        if ((handler = http_headers_in[pos->id]) != NULL) {
+            handler(rq, out, pos->header_value_start, pos->header_value_end);
+        }
     }
 
     return 0;
@@ -132,7 +279,12 @@ int http_analyze_headers(http_request_t* rq, http_headers_out_t* out) {
  */
 int http_request_destroy(http_request_t* rq) {
     if (rq) {
-        free(rq);
+        detach_timer((void*)rq);
+        http_output_clear(rq);
+        coroutine_free(rq->co);
+        http_buffer_free(rq->buffer);
+        free(rq->headers_spill);
+        pool_free(rq);
     }
 
     return 0;
@@ -179,9 +331,33 @@ static int http_process_request_headers(http_request_t* rq) {
     return http_parse_request_headers(rq);
 }
 
+/*
+ * Connection 的值是逗号分隔的选项列表： close 关闭连接，优先于 keep-alive ； keep-alive 使 HTTP/1.0 保持连接。
+ */
 static int http_process_connection(http_request_t* rq, http_headers_out_t* out, char* st, char* ed) {
-    if (!strncasecmp(st, "keep-alive", 10)) {
-        out->keep_alive = 1;
+    char* p;
+
+    while (st <= ed) {
+        if (*st == ' ' || *st == '\t' || *st == ',') {
+            ++ st;
+            continue;
+        }
+
+        p = st;
+        while (p <= ed && *p != ' ' && *p != '\t' && *p != ',') {
+            ++ p;
+        }
+
+        if (p - st == 5 && !strncasecmp(st, "close", 5)) {
+            out->keep_alive = 0;
+            return REQUEST_OK;
+        }
+
+        if (p - st == 10 && !strncasecmp(st, "keep-alive", 10)) {
+            out->keep_alive = 1;
+        }
+
+        st = p;
     }
 
     return REQUEST_OK;
@@ -240,3 +416,46 @@ static int http_process_if_unmodified_since(http_request_t* rq, http_headers_out
 
     return HTTP_OK;
 }
+
+/*
+ * 只记录字段值，文件长度已知后再由 http_prepare_response 解析区间。
+ */
+static int http_process_range(http_request_t* rq, http_headers_out_t* out, char* st, char* ed) {
+    out->range_start = st;
+    out->range_end = ed;
+
+    return HTTP_OK;
+}
+
+/*
+ * 没有实体标签，只支持日期形式：与文件的 Last-Modified 完全相同时才发送区间。
+ */
+static int http_process_if_range(http_request_t* rq, http_headers_out_t* out, char* st, char* ed) {
+    const char* date;
+    size_t len;
+
+    /* Last-Modified 头部行去掉字段名与行尾 */
+    date = out->last_modified + sizeof("Last-Modified: ") - 1;
+    len = HTTP_LAST_MODIFIED_LEN - (sizeof("Last-Modified: ") - 1) - 2;
+
+    if ((size_t)(ed - st + 1) == len && memcmp(st, date, len) == 0) {
+        out->if_range = 1;
+    } else {
+        out->if_range = 2;
+    }
+
+    return HTTP_OK;
+}
+
+/*
+ * 指针位于 [from, to) 时移动 delta 字节。
+ */
+static void http_relocate(void** ptr, unsigned char* from, unsigned char* to, ptrdiff_t delta) {
+    unsigned char* p;
+
+    p = (unsigned char*)*ptr;
+
+    if (p >= from && p < to) {
+        *ptr = (void*)(p + delta);
+    }
+}
@@ -7,7 +7,9 @@
 #define _HTTP_REQUEST_H_
 
 #include "config.h"
+#include "coroutine.h"
 #include "epoll.h"
+#include "http_buffer.h"
 #include "http_timer.h"
 #include "list.h"
 
@@ -27,6 +29,7 @@
 
 #define HTTP_CONTINUE               100
 #define HTTP_OK                     200
+#define HTTP_PARTIAL_CONTENT        206
 #define HTTP_MOVED_PERMANENTLY      301
 #define HTTP_MOVED_TEMPORARILY      302
 #define HTTP_NOT_MODIFIED           304
@@ -34,14 +37,30 @@
 #define HTTP_FORBIDDEN              403
 #define HTTP_NOT_FOUND              404
 #define HTTP_PRECONDITION_FAILED    412
+#define HTTP_RANGE_NOT_SATISFIABLE  416
 #define HTTP_INTERNAL_SERVER_ERROR  500
 #define HTTP_NOT_IMPLEMENTED        501
+#define HTTP_SERVICE_UNAVAILABLE    503
 #define HTTP_VERSION_NOT_SUPPORTED  505
 
-#define BUF_SIZE                    8192
+#define HTTP_HEADERS_INLINE         16          /* 保存在请求结构体内的首部字段个数 */
+#define HTTP_HEADERS_MAX            100         /* 一个请求最多的首部字段个数，超过时视为错误请求 */
+
+/* 第 i 个首部字段，前 HTTP_HEADERS_INLINE 个在请求结构体内，其余在溢出区 */
+#define http_request_header(rq, i) \
+    ((i) < HTTP_HEADERS_INLINE ? &((rq)->headers[i]) : &((rq)->headers_spill[(i) - HTTP_HEADERS_INLINE]))
 
 typedef struct http_request_s http_request_t;
 
+/* 保存单个 http 请求首部字段，指向读缓冲区中的字段名与字段值。*/
+typedef struct {
+    unsigned            id;                     /* 已知首部字段的编号，见 http_header.h */
+    void*               header_name_start;      /* 请求首部字段名的开始地址 */
+    void*               header_name_end;        /* 请求首部字段名的结束地址 */
+    void*               header_value_start;     /* 请求首部字段值的开始地址 */
+    void*               header_value_end;       /* 请求首部字段值的结束地址 */
+} http_header_t;
+
 typedef int (request_handler_t) (http_request_t* rq);
 
 /* 表征当前的 http 请求事件。*/
@@ -64,7 +83,9 @@ struct http_request_s{
     unsigned            http_version_minor:16;  /* http 主版本号 */
     unsigned            http_version_major:16;  /* http 子版本号 */
 
-    list_head_t         headers_list_head;      /* 保存首部字段的链表头 */
+    http_header_t       headers[HTTP_HEADERS_INLINE];   /* 解析出的首部字段 */
+    http_header_t*      headers_spill;          /* 首部字段多于 HTTP_HEADERS_INLINE 个时的溢出区，请求结束时释放 */
+    unsigned            headers_num;            /* 解析出的首部字段个数 */
     void*               cur_header_name_start;  /* 定位当前处理的首部字段名 */
     void*               cur_header_name_end;
     void*               cur_header_value_start; /* 定位当前处理的首部字段值 */
@@ -73,56 +94,83 @@ struct http_request_s{
     void*               root;                   /* 当前所在的主目录 */
     void*               defile;                 /* 默认文件 */
 
-    unsigned char       buf[BUF_SIZE];          /* 缓冲区 */
+    http_buffer_t*      buffer;                 /* 读缓冲区链，指向当前缓冲区，连接空闲时为 NULL */
+    unsigned char*      buf;                    /* 当前缓冲区的起始地址 */
+    unsigned char*      buflast;                /* 当前缓冲区的结束地址 */
     unsigned char*      bufst;                  /* 当前缓冲区可读的第一个字节下标 */
     unsigned char*      bufed;                  /* 当前缓冲区不可读/可写的第一个字节下标 */
+    unsigned            large_num;              /* 链中大缓冲区的个数 */
+    unsigned            large_max;              /* 一个请求最多使用的大缓冲区个数 */
 
     http_timer_t        timer;                  /* 定时器 */
 
     msec_t              timeout;                /* 长连接的超时时间 */
 
     request_handler_t*  handler;                /* 当前应该执行的解析函数指针 */
-};
 
-/* 保存单个 http 请求首部字段。*/
-typedef struct {
-    list_head_t         list_node;              /* 连入链表所需要的额外信息 */
-    void*               header_name_start;      /* 请求首部字段名的开始地址 */
-    void*               header_name_end;        /* 请求首部字段名的结束地址 */
-    void*               header_value_start;     /* 请求首部字段值的开始地址 */
-    void*               header_value_end;       /* 请求首部字段值的结束地址 */
-} http_header_t;
+    list_head_t         output_list_head;       /* 输出队列，套接字写满时留待可写后继续发送 */
+    unsigned            output_close;           /* 输出队列发送完毕后关闭连接 */
+
+    coroutine_t*        co;                     /* 执行该连接请求的协程，首次执行时创建 */
+    unsigned            wait_events;            /* 协程挂起时等待的 epoll 事件 */
+    unsigned            idle;                   /* 协程因连接空闲而退出，连接继续等待下一个请求 */
+};
 
 /* 保存解析完毕要发送响应的 headers 信息。 */
 typedef struct {
     unsigned            keep_alive:4;
     unsigned            if_modified:2;
     unsigned            if_unmodified:2;
-    unsigned            status:24;              /* 状态码 */
+    unsigned            if_range:2;             /* 1 为 If-Range 与文件一致， 2 为不一致，此时忽略 Range */
+    unsigned            status:22;              /* 状态码 */
     time_t              rtime;                  /* 请求报文的创建时间 */
     time_t              mtime;                  /* 所请求资源的修改时间 */
+    const char*         last_modified;          /* 预先格式化的 Last-Modified 头部行 */
+    const char*         range_start;            /* Range 字段值的开始地址，没有 Range 时为 NULL */
+    const char*         range_end;              /* Range 字段值的结束地址 */
 } http_headers_out_t;
 
 typedef int http_headers_handler_t (http_request_t*, http_headers_out_t*, char*, char*);
 
-/* 首部字段名映射到处理函数的函数指针 */
-typedef struct {
-    char*                   name;
-    http_headers_handler_t* handler;
-} http_headers_in_t;
-
 /*
  * 初始化 http_request_t 结构体，如果成功返回结构体指针，失败则返回 NULL 。
  */
 http_request_t* http_request_init(int fd, epoll_t* epoll, config_t* config);
 
+/*
+ * 初始化已分配好的 http_request_t 结构体，供嵌入在其他结构体中的请求使用。
+ */
+void http_request_setup(http_request_t* rq, int fd, epoll_t* epoll, config_t* config);
+
+/*
+ * 一个请求处理完毕后重置解析状态，准备解析同一连接上的下一个请求。
+ * 缓冲区中尚未解析的数据移动到缓冲区开头。
+ */
+void http_request_reset(http_request_t* rq);
+
+/*
+ * 为请求挂上读缓冲区，已有则不做任何事。成功返回 0 ，失败返回 -1 。
+ */
+int http_request_attach_buffer(http_request_t* rq);
+
+/*
+ * 缓冲区中没有任何数据时归还读缓冲区，连接空闲期间只占用请求结构体本身。
+ */
+void http_request_release_buffer(http_request_t* rq);
+
+/*
+ * 当前缓冲区已满时追加一块大缓冲区，把正在解析的请求行或首部字段移到新缓冲区中继续读入。
+ * 成功返回 0 ；大缓冲区已用完或单个请求行、首部字段超过 BUF_LARGE_SIZE 时返回 -1 。
+ */
+int http_request_grow_buffer(http_request_t* rq);
+
 /*
  * 初始化 http_headers_out_t 结构体，如果成功返回结构体指针，失败则返回 NULL 。
  */
 http_headers_out_t* http_headers_out_init();
 
 /*
- * 分析首部字段链表中的所有首部字段，并将结果信息保存至 out 指向的结构体。
+ * 分析请求的所有首部字段，并将结果信息保存至 out 指向的结构体。
  */
 int http_analyze_headers(http_request_t* rq, http_headers_out_t* out);
 
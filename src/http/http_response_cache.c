@@ -0,0 +1,422 @@
+/**
+ * @author ttoobne
+ * @date 2026/10/17
+ */
+
+#include "http_response_cache.h"
+
+#include "log.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/* 条目所在的段：新条目先进入窗口，被窗口淘汰时与主缓存的淘汰候选比较频率，胜者留在主缓存的试用段，
+   在试用段中再次命中后升入受保护段 */
+#define SEGMENT_WINDOW      1
+#define SEGMENT_PROBATION   2
+#define SEGMENT_PROTECTED   3
+#define SEGMENT_NUM         4
+
+#define SKETCH_ROWS         4           /* 频率草图（ count-min sketch ）的行数 */
+
+/* 分片：键的哈希值最高几位相同的条目属于同一分片 */
+typedef struct {
+    pthread_mutex_t     lock;
+    http_cached_t**     buckets;        /* 哈希桶 */
+    size_t              buckets_mask;
+    list_head_t         lru[SEGMENT_NUM];   /* 各段的 LRU 链表，尾部为最近使用的条目 */
+    size_t              used[SEGMENT_NUM];  /* 各段占用的内存 */
+
+    unsigned char*      sketch;         /* SKETCH_ROWS 行计数器，每行宽度为哈希桶数 */
+    unsigned            sketch_bits;    /* 每行宽度的对数 */
+    unsigned long       sketch_count;   /* 上次减半以来的计数次数 */
+} response_shard_t;
+
+static const uint64_t sketch_seeds[SKETCH_ROWS] = {
+    0x9e3779b97f4a7c15ull, 0xc2b2ae3d27d4eb4full, 0x165667b19e3779f9ull, 0xd6e8feb86659fd93ull
+};
+
+static response_shard_t shards[RESPONSE_CACHE_SHARDS];
+static int              enabled;
+static size_t           body_max;       /* 缓存的响应体大小上限 */
+static size_t           window_max;     /* 每个分片窗口的预算 */
+static size_t           main_max;       /* 每个分片主缓存（试用段与受保护段）的预算 */
+static size_t           protected_max;  /* 每个分片受保护段的预算 */
+
+static uint64_t http_cached_hash(http_file_t* file, unsigned keep_alive);
+static response_shard_t* http_cached_shard(uint64_t hash);
+static http_cached_t* http_cached_find(response_shard_t* shard, http_file_t* file, uint64_t hash,
+                                       unsigned keep_alive, unsigned long timeout);
+static void http_cached_touch(response_shard_t* shard, http_cached_t* cached);
+static void http_cached_admit(response_shard_t* shard, http_cached_t* candidate);
+static void http_cached_link(response_shard_t* shard, http_cached_t* cached, unsigned segment);
+static void http_cached_unlink(response_shard_t* shard, http_cached_t* cached);
+static void http_sketch_increment(response_shard_t* shard, uint64_t hash);
+static unsigned http_sketch_frequency(response_shard_t* shard, uint64_t hash);
+
+/*
+ * 按配置初始化缓存， response_cache 为 0 时不缓存。应在启动工作线程之前调用。
+ * 成功返回 0 ，失败返回 -1 。
+ */
+int http_response_cache_init(config_t* config) {
+    response_shard_t* shard;
+    size_t budget;
+    size_t width;
+    unsigned bits;
+    int i;
+    int j;
+
+    if (config->response_cache == 0) {
+        return 0;
+    }
+
+    budget = config->response_cache * 1024 / RESPONSE_CACHE_SHARDS;
+    body_max = config->response_cache_max;
+    window_max = budget / RESPONSE_CACHE_WINDOW;
+    main_max = budget - window_max;
+    protected_max = main_max / 100 * RESPONSE_CACHE_PROTECT;
+
+    /* 按平均 1KB 一个条目估计哈希桶数与草图宽度，至少 16 */
+    for (bits = 4, width = 16; width < budget / 1024; ++ bits, width <<= 1);
+
+    for (i = 0; i < RESPONSE_CACHE_SHARDS; ++ i) {
+        shard = &(shards[i]);
+
+        pthread_mutex_init(&(shard->lock), NULL);
+
+        for (j = 0; j < SEGMENT_NUM; ++ j) {
+            init_list_head(&(shard->lru[j]));
+            shard->used[j] = 0;
+        }
+
+        shard->buckets = (http_cached_t**)calloc(width, sizeof(http_cached_t*));
+        shard->sketch = (unsigned char*)calloc(width * SKETCH_ROWS, 1);
+
+        if (shard->buckets == NULL || shard->sketch == NULL) {
+            log_error("response cache malloc failed.");
+            return -1;
+        }
+
+        shard->buckets_mask = width - 1;
+        shard->sketch_bits = bits;
+        shard->sketch_count = 0;
+    }
+
+    enabled = 1;
+
+    return 0;
+}
+
+/*
+ * 查找文件 file 的响应，并记录一次访问频率。命中返回持有一个引用的条目，用完后调用 http_cached_release ；
+ * 未命中、文件过大或不缓存时返回 NULL 。
+ */
+http_cached_t* http_response_cache_get(http_file_t* file, unsigned keep_alive, unsigned long timeout) {
+    response_shard_t* shard;
+    http_cached_t* cached;
+    uint64_t hash;
+
+    if (!enabled || (size_t)file->size > body_max) {
+        return NULL;
+    }
+
+    hash = http_cached_hash(file, keep_alive);
+    shard = http_cached_shard(hash);
+
+    pthread_mutex_lock(&(shard->lock));
+
+    http_sketch_increment(shard, hash);
+
+    if ((cached = http_cached_find(shard, file, hash, keep_alive, timeout)) != NULL) {
+        http_cached_touch(shard, cached);
+        __atomic_add_fetch(&(cached->refs), 1, __ATOMIC_RELAXED);
+    }
+
+    pthread_mutex_unlock(&(shard->lock));
+
+    return cached;
+}
+
+/*
+ * 由已生成的头部与读入的文件内容生成条目，交给准入策略决定是否缓存。
+ * date_off 为 Date 头部行在头部中的偏移。返回持有一个引用的条目（即使没有被缓存），
+ * 文件过大、不缓存或读取失败时返回 NULL 。
+ */
+http_cached_t* http_response_cache_put(http_file_t* file, unsigned keep_alive, unsigned long timeout,
+                                       const char* headers, size_t headers_len, size_t date_off) {
+    response_shard_t* shard;
+    http_cached_t* cached;
+    http_cached_t* old;
+    size_t charge;
+    size_t done;
+    ssize_t n;
+
+    if (!enabled || (size_t)file->size > body_max) {
+        return NULL;
+    }
+
+    charge = sizeof(http_cached_t) + headers_len + file->size + file->name_len;
+
+    if ((cached = (http_cached_t*)malloc(charge)) == NULL) {
+        log_error("http_cached_t malloc failed.");
+        return NULL;
+    }
+
+    memcpy(cached->data, headers, headers_len);
+
+    /* 文件内容紧跟在头部之后 */
+    for (done = 0; done < (size_t)file->size; done += n) {
+        if ((n = pread(file->fd, cached->data + headers_len + done, file->size - done, done)) > 0) {
+            continue;
+        }
+
+        if (n < 0 && errno == EINTR) {
+            n = 0;
+            continue;
+        }
+
+        /* 文件被截断或读取出错，交给普通的发送路径处理 */
+        free(cached);
+        return NULL;
+    }
+
+    memcpy(cached->data + headers_len + file->size, file->name, file->name_len);
+
+    cached->next = NULL;
+    cached->hash = http_cached_hash(file, keep_alive);
+    cached->refs = 1;
+    cached->segment = 0;
+    cached->charge = charge;
+    cached->version = file->version;
+    cached->name = cached->data + headers_len + file->size;
+    cached->name_len = file->name_len;
+    cached->keep_alive = keep_alive;
+    cached->timeout = timeout;
+    cached->headers_len = headers_len;
+    cached->date_off = date_off;
+    cached->body_len = file->size;
+
+    /* 超过主缓存预算的条目只用于这一次响应 */
+    if (charge > main_max) {
+        return cached;
+    }
+
+    shard = http_cached_shard(cached->hash);
+
+    pthread_mutex_lock(&(shard->lock));
+
+    if ((old = http_cached_find(shard, file, cached->hash, keep_alive, timeout)) != NULL) {
+        http_cached_unlink(shard, old);
+    }
+
+    /* 新条目总是进入窗口，窗口超出预算时把最久未使用的条目交给准入策略 */
+    http_cached_link(shard, cached, SEGMENT_WINDOW);
+    __atomic_add_fetch(&(cached->refs), 1, __ATOMIC_RELAXED);
+
+    while (shard->used[SEGMENT_WINDOW] > window_max) {
+        http_cached_admit(shard, list_entry(shard->lru[SEGMENT_WINDOW].next, http_cached_t, lru_node));
+    }
+
+    pthread_mutex_unlock(&(shard->lock));
+
+    return cached;
+}
+
+/*
+ * 释放一个引用，可以在任意线程调用。
+ */
+void http_cached_release(http_cached_t* cached) {
+    if (cached == NULL || __atomic_sub_fetch(&(cached->refs), 1, __ATOMIC_ACQ_REL) > 0) {
+        return;
+    }
+
+    free(cached);
+}
+
+/*
+ * 键的哈希值：文件名的哈希值，长连接与非长连接的响应头部不同，分别缓存。
+ */
+static uint64_t http_cached_hash(http_file_t* file, unsigned keep_alive) {
+    return keep_alive ? file->hash ^ 0x9e3779b97f4a7c15ull : file->hash;
+}
+
+/*
+ * 哈希值所属的分片，取最高几位，与哈希桶使用的低位无关。
+ */
+static response_shard_t* http_cached_shard(uint64_t hash) {
+    return &(shards[(hash >> 32) % RESPONSE_CACHE_SHARDS]);
+}
+
+/*
+ * 查找文件名与响应头部参数都相同的条目，调用者持有分片的锁。
+ * 找到的条目生成时的文件版本与 file 不同时说明文件已经变化，移出缓存并返回 NULL 。
+ */
+static http_cached_t* http_cached_find(response_shard_t* shard, http_file_t* file, uint64_t hash,
+                                       unsigned keep_alive, unsigned long timeout) {
+    http_cached_t* it;
+
+    for (it = shard->buckets[hash & shard->buckets_mask]; it; it = it->next) {
+        if (it->hash == hash && it->keep_alive == keep_alive && it->name_len == file->name_len &&
+            memcmp(it->name, file->name, file->name_len) == 0) {
+            break;
+        }
+    }
+
+    if (it && (it->version != file->version || it->timeout != timeout)) {
+        http_cached_unlink(shard, it);
+        return NULL;
+    }
+
+    return it;
+}
+
+/*
+ * 命中的条目移到所在段的尾部，试用段中的条目升入受保护段，受保护段超出预算时最久未使用的条目降回试用段。
+ */
+static void http_cached_touch(response_shard_t* shard, http_cached_t* cached) {
+    http_cached_t* demoted;
+    unsigned segment;
+
+    segment = cached->segment == SEGMENT_PROBATION ? SEGMENT_PROTECTED : cached->segment;
+
+    list_del(&(cached->lru_node));
+    shard->used[cached->segment] -= cached->charge;
+    list_add_tail(&(cached->lru_node), &(shard->lru[segment]));
+    shard->used[segment] += cached->charge;
+    cached->segment = segment;
+
+    while (shard->used[SEGMENT_PROTECTED] > protected_max) {
+        demoted = list_entry(shard->lru[SEGMENT_PROTECTED].next, http_cached_t, lru_node);
+
+        list_del(&(demoted->lru_node));
+        shard->used[SEGMENT_PROTECTED] -= demoted->charge;
+        list_add_tail(&(demoted->lru_node), &(shard->lru[SEGMENT_PROBATION]));
+        shard->used[SEGMENT_PROBATION] += demoted->charge;
+        demoted->segment = SEGMENT_PROBATION;
+    }
+}
+
+/*
+ * 窗口淘汰的候选条目进入主缓存：主缓存放不下时与试用段（为空时受保护段）中最久未使用的条目比较访问频率，
+ * 频率更高者留下。只访问过一两次的条目（如爬虫遍历整个目录）赢不了热门条目，不会冲掉工作集。
+ */
+static void http_cached_admit(response_shard_t* shard, http_cached_t* candidate) {
+    http_cached_t* victim;
+    list_head_t* lru;
+    unsigned frequency;
+
+    list_del(&(candidate->lru_node));
+    shard->used[SEGMENT_WINDOW] -= candidate->charge;
+    candidate->segment = SEGMENT_PROBATION;
+    list_add_tail(&(candidate->lru_node), &(shard->lru[SEGMENT_PROBATION]));
+    shard->used[SEGMENT_PROBATION] += candidate->charge;
+
+    frequency = http_sketch_frequency(shard, candidate->hash);
+
+    while (shard->used[SEGMENT_PROBATION] + shard->used[SEGMENT_PROTECTED] > main_max) {
+        lru = &(shard->lru[SEGMENT_PROBATION]);
+
+        /* 候选条目在试用段尾部，试用段中只剩它时从受保护段中挑选 */
+        if (lru->next == &(candidate->lru_node)) {
+            lru = &(shard->lru[SEGMENT_PROTECTED]);
+        }
+
+        victim = list_entry(lru->next, http_cached_t, lru_node);
+
+        if (frequency > http_sketch_frequency(shard, victim->hash)) {
+            http_cached_unlink(shard, victim);
+        } else {
+            http_cached_unlink(shard, candidate);
+            return;
+        }
+    }
+}
+
+/*
+ * 把条目加入哈希桶与段 segment 的尾部，调用者持有分片的锁。
+ */
+static void http_cached_link(response_shard_t* shard, http_cached_t* cached, unsigned segment) {
+    http_cached_t** bucket;
+
+    bucket = &(shard->buckets[cached->hash & shard->buckets_mask]);
+    cached->next = *bucket;
+    *bucket = cached;
+
+    list_add_tail(&(cached->lru_node), &(shard->lru[segment]));
+    shard->used[segment] += cached->charge;
+    cached->segment = segment;
+}
+
+/*
+ * 把条目移出缓存并释放缓存持有的引用，调用者持有分片的锁。
+ */
+static void http_cached_unlink(response_shard_t* shard, http_cached_t* cached) {
+    http_cached_t** pos;
+
+    for (pos = &(shard->buckets[cached->hash & shard->buckets_mask]); *pos != cached; pos = &((*pos)->next));
+
+    *pos = cached->next;
+    list_del(&(cached->lru_node));
+    shard->used[cached->segment] -= cached->charge;
+    cached->segment = 0;
+
+    http_cached_release(cached);
+}
+
+/*
+ * 草图中每行计数器的下标，每行使用不同的乘数。
+ */
+#define http_sketch_index(shard, hash, row) \
+    ((row) * ((size_t)1 << (shard)->sketch_bits) + (size_t)(((hash) * sketch_seeds[row]) >> (64 - (shard)->sketch_bits)))
+
+/*
+ * 记录一次访问，计数器饱和于 RESPONSE_CACHE_COUNTER 。累计足够多次后所有计数器减半。
+ */
+static void http_sketch_increment(response_shard_t* shard, uint64_t hash) {
+    unsigned char* counter;
+    size_t size;
+    size_t i;
+    int row;
+
+    for (row = 0; row < SKETCH_ROWS; ++ row) {
+        counter = &(shard->sketch[http_sketch_index(shard, hash, row)]);
+
+        if (*counter < RESPONSE_CACHE_COUNTER) {
+            ++ *counter;
+        }
+    }
+
+    size = (size_t)SKETCH_ROWS << shard->sketch_bits;
+
+    if ( ++ shard->sketch_count >= (size / SKETCH_ROWS) * RESPONSE_CACHE_SAMPLE) {
+        for (i = 0; i < size; ++ i) {
+            shard->sketch[i] >>= 1;
+        }
+
+        shard->sketch_count = 0;
+    }
+}
+
+/*
+ * 估计访问频率：各行计数器的最小值。
+ */
+static unsigned http_sketch_frequency(response_shard_t* shard, uint64_t hash) {
+    unsigned frequency;
+    unsigned counter;
+    int row;
+
+    frequency = RESPONSE_CACHE_COUNTER;
+
+    for (row = 0; row < SKETCH_ROWS; ++ row) {
+        counter = shard->sketch[http_sketch_index(shard, hash, row)];
+
+        if (counter < frequency) {
+            frequency = counter;
+        }
+    }
+
+    return frequency;
+}
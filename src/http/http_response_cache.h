@@ -0,0 +1,73 @@
+/**
+ * @author ttoobne
+ * @date 2026/10/17
+ */
+
+#ifndef _HTTP_RESPONSE_CACHE_H_
+#define _HTTP_RESPONSE_CACHE_H_
+
+#include "config.h"
+#include "http_file_cache.h"
+#include "list.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define RESPONSE_CACHE_SHARDS   8           /* 分片数，每个分片一把互斥锁与一套独立的 W-TinyLFU */
+#define RESPONSE_CACHE_WINDOW   100         /* 窗口 LRU 占分片预算的 1 / RESPONSE_CACHE_WINDOW */
+#define RESPONSE_CACHE_PROTECT  80          /* 受保护段占主缓存预算的百分比 */
+#define RESPONSE_CACHE_COUNTER  15          /* 频率草图计数器的上限 */
+#define RESPONSE_CACHE_SAMPLE   10          /* 草图累计 宽度 * RESPONSE_CACHE_SAMPLE 次计数后全部减半，旧的热度逐渐衰减 */
+
+/*
+ * 完整的响应：状态行、头部与响应体连续存放，命中时复制头部、写入当前的 Date 头部行后即可发送，响应体直接引用。
+ * 条目带引用计数：缓存本身持有一个，正在发送的响应各持有一个。
+ * 条目记录生成时的文件版本，不持有打开文件缓存的条目与文件描述符，文件版本变化后该响应失效。
+ */
+typedef struct http_cached_s http_cached_t;
+
+struct http_cached_s {
+    http_cached_t*      next;           /* 哈希桶中的下一个条目 */
+    list_head_t         lru_node;       /* 连入所在段的 LRU 链表 */
+    uint64_t            hash;           /* 键的哈希值 */
+    unsigned            refs;           /* 引用计数 */
+    unsigned            segment;        /* 所在的段，不在缓存中时为 0 */
+    size_t              charge;         /* 占用的内存，计入预算 */
+
+    uint64_t            version;        /* 生成响应时的文件版本 */
+    const char*         name;           /* 文件名，存放在响应体之后 */
+    size_t              name_len;       /* 文件名长度 */
+    unsigned            keep_alive;     /* 响应是否保持连接 */
+    unsigned long       timeout;        /* Keep-Alive 头部的超时时间 */
+    size_t              headers_len;    /* 头部长度 */
+    size_t              date_off;       /* Date 头部行在头部中的偏移 */
+    size_t              body_len;       /* 响应体长度 */
+    char                data[];         /* 头部、响应体与文件名 */
+};
+
+/*
+ * 按配置初始化缓存， response_cache 为 0 时不缓存。应在启动工作线程之前调用。
+ * 成功返回 0 ，失败返回 -1 。
+ */
+int http_response_cache_init(config_t* config);
+
+/*
+ * 查找文件 file 的响应，并记录一次访问频率。命中返回持有一个引用的条目，用完后调用 http_cached_release ；
+ * 未命中、文件过大或不缓存时返回 NULL 。
+ */
+http_cached_t* http_response_cache_get(http_file_t* file, unsigned keep_alive, unsigned long timeout);
+
+/*
+ * 由已生成的头部与读入的文件内容生成条目，交给准入策略决定是否缓存。
+ * date_off 为 Date 头部行在头部中的偏移。返回持有一个引用的条目（即使没有被缓存），
+ * 文件过大、不缓存或读取失败时返回 NULL 。
+ */
+http_cached_t* http_response_cache_put(http_file_t* file, unsigned keep_alive, unsigned long timeout,
+                                       const char* headers, size_t headers_len, size_t date_off);
+
+/*
+ * 释放一个引用，可以在任意线程调用。
+ */
+void http_cached_release(http_cached_t* cached);
+
+#endif /* _HTTP_RESPONSE_CACHE_H_ */
@@ -0,0 +1,281 @@
+/**
+ * @author ttoobne
+ * @date 2026/10/17
+ */
+
+#include "http_scan.h"
+
+#include "http_parse.h"
+
+#include <stdint.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HTTP_SCAN_X86
+#endif
+
+/* token 字符： "!" / "#" / "$" / "%" / "&" / "'" / "*" / "+" / "-" / "." / "^" / "_" / "`" / "|" / "~" / DIGIT / ALPHA */
+const unsigned char http_token_chars[256] = {
+    ['!'] = 1, ['#'] = 1, ['$'] = 1, ['%'] = 1, ['&'] = 1, ['\''] = 1, ['*'] = 1, ['+'] = 1,
+    ['-'] = 1, ['.'] = 1, ['^'] = 1, ['_'] = 1, ['`'] = 1, ['|'] = 1, ['~'] = 1,
+    ['0' ... '9'] = 1, ['A' ... 'Z'] = 1, ['a' ... 'z'] = 1
+};
+
+static unsigned char* scan_uri_scalar(unsigned char* p, unsigned char* end);
+static unsigned char* scan_line_scalar(unsigned char* p, unsigned char* end);
+static unsigned char* scan_token_scalar(unsigned char* p, unsigned char* end);
+
+http_scan_t* http_scan_uri = scan_uri_scalar;
+http_scan_t* http_scan_line = scan_line_scalar;
+http_scan_t* http_scan_token = scan_token_scalar;
+
+#ifdef HTTP_SCAN_X86
+
+/*
+ * AVX2 用查表判断 token 字符：字节 c 是 token 字符当且仅当 token_lo[c & 0xf] & token_hi[c >> 4] 不为 0 。
+ * token_lo[l] 的第 h 位表示 (h << 4) | l 是 token 字符， token_hi[h] 为 1 << h ， h >= 8 时为 0 ，
+ * 所以非 ASCII 字节都不是 token 字符。
+ */
+static unsigned char token_lo[16];
+static unsigned char token_hi[16];
+
+static unsigned char* scan_uri_sse42(unsigned char* p, unsigned char* end);
+static unsigned char* scan_line_sse42(unsigned char* p, unsigned char* end);
+static unsigned char* scan_token_sse42(unsigned char* p, unsigned char* end);
+static unsigned char* scan_uri_avx2(unsigned char* p, unsigned char* end);
+static unsigned char* scan_line_avx2(unsigned char* p, unsigned char* end);
+static unsigned char* scan_token_avx2(unsigned char* p, unsigned char* end);
+
+#endif /* HTTP_SCAN_X86 */
+
+/*
+ * 选择不超过 level 且 CPU 支持的最快实现，返回实际选择的实现。
+ * 应在启动工作线程之前调用；不调用时使用逐字节扫描。
+ */
+int http_scan_init(int level) {
+#ifdef HTTP_SCAN_X86
+    int c;
+
+    __builtin_cpu_init();
+
+    if (level >= HTTP_SCAN_AVX2 && __builtin_cpu_supports("avx2")) {
+        for (c = 0; c < 128; ++ c) {
+            if (http_token_chars[c]) {
+                token_lo[c & 0xf] |= 1 << (c >> 4);
+            }
+        }
+
+        for (c = 0; c < 8; ++ c) {
+            token_hi[c] = 1 << c;
+        }
+
+        http_scan_uri = scan_uri_avx2;
+        http_scan_line = scan_line_avx2;
+        http_scan_token = scan_token_avx2;
+
+        return HTTP_SCAN_AVX2;
+    }
+
+    if (level >= HTTP_SCAN_SSE42 && __builtin_cpu_supports("sse4.2")) {
+        http_scan_uri = scan_uri_sse42;
+        http_scan_line = scan_line_sse42;
+        http_scan_token = scan_token_sse42;
+
+        return HTTP_SCAN_SSE42;
+    }
+#endif /* HTTP_SCAN_X86 */
+
+    http_scan_uri = scan_uri_scalar;
+    http_scan_line = scan_line_scalar;
+    http_scan_token = scan_token_scalar;
+
+    return HTTP_SCAN_SCALAR;
+}
+
+/*
+ * 返回实现的名称。
+ */
+const char* http_scan_name(int level) {
+    switch (level) {
+    case HTTP_SCAN_AVX2:
+        return "avx2";
+
+    case HTTP_SCAN_SSE42:
+        return "sse4.2";
+
+    default:
+        return "scalar";
+    }
+}
+
+static unsigned char* scan_uri_scalar(unsigned char* p, unsigned char* end) {
+    for (; p != end; ++ p) {
+        if (*p == ' ' || *p == '?') {
+            break;
+        }
+    }
+
+    return p;
+}
+
+static unsigned char* scan_line_scalar(unsigned char* p, unsigned char* end) {
+    for (; p != end; ++ p) {
+        if (*p == CR || *p == LF) {
+            break;
+        }
+    }
+
+    return p;
+}
+
+static unsigned char* scan_token_scalar(unsigned char* p, unsigned char* end) {
+    for (; p != end; ++ p) {
+        if (!http_token_char(*p)) {
+            break;
+        }
+    }
+
+    return p;
+}
+
+#ifdef HTTP_SCAN_X86
+
+/*
+ * pcmpestri 在 16 个字节中找第一个属于 set 的字节，没有时返回 16 。
+ */
+__attribute__((target("sse4.2")))
+static unsigned char* scan_uri_sse42(unsigned char* p, unsigned char* end) {
+    __m128i set;
+    int i;
+
+    set = _mm_setr_epi8(' ', '?', 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+
+    for (; end - p >= 16; p += 16) {
+        i = _mm_cmpestri(set, 2, _mm_loadu_si128((const __m128i*)p), 16,
+                         _SIDD_UBYTE_OPS | _SIDD_CMP_EQUAL_ANY | _SIDD_LEAST_SIGNIFICANT);
+
+        if (i != 16) {
+            return p + i;
+        }
+    }
+
+    return scan_uri_scalar(p, end);
+}
+
+__attribute__((target("sse4.2")))
+static unsigned char* scan_line_sse42(unsigned char* p, unsigned char* end) {
+    __m128i set;
+    int i;
+
+    set = _mm_setr_epi8(CR, LF, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+
+    for (; end - p >= 16; p += 16) {
+        i = _mm_cmpestri(set, 2, _mm_loadu_si128((const __m128i*)p), 16,
+                         _SIDD_UBYTE_OPS | _SIDD_CMP_EQUAL_ANY | _SIDD_LEAST_SIGNIFICANT);
+
+        if (i != 16) {
+            return p + i;
+        }
+    }
+
+    return scan_line_scalar(p, end);
+}
+
+/*
+ * pcmpestri 最多比较 8 个区间，不足以精确表示非 token 字符，
+ * 最后一个区间 '{' - 0xff 把 '|' 与 '~' 也包括在内，调用者需要用 http_token_char 再判断一次。
+ */
+__attribute__((target("sse4.2")))
+static unsigned char* scan_token_sse42(unsigned char* p, unsigned char* end) {
+    __m128i ranges;
+    int i;
+
+    ranges = _mm_setr_epi8(0x00, ' ', '"', '"', '(', ')', ',', ',', '/', '/', ':', '@', '[', ']', '{', (char)0xff);
+
+    for (; end - p >= 16; p += 16) {
+        i = _mm_cmpestri(ranges, 16, _mm_loadu_si128((const __m128i*)p), 16,
+                         _SIDD_UBYTE_OPS | _SIDD_CMP_RANGES | _SIDD_LEAST_SIGNIFICANT);
+
+        if (i != 16) {
+            return p + i;
+        }
+    }
+
+    return scan_token_scalar(p, end);
+}
+
+/*
+ * AVX2 每次比较 32 个字节，把比较结果的最高位收集成掩码，最低的置位即第一个匹配的字节。
+ */
+__attribute__((target("avx2")))
+static unsigned char* scan_uri_avx2(unsigned char* p, unsigned char* end) {
+    __m256i sp;
+    __m256i qm;
+    __m256i v;
+    uint32_t mask;
+
+    sp = _mm256_set1_epi8(' ');
+    qm = _mm256_set1_epi8('?');
+
+    for (; end - p >= 32; p += 32) {
+        v = _mm256_loadu_si256((const __m256i*)p);
+        mask = _mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(v, sp), _mm256_cmpeq_epi8(v, qm)));
+
+        if (mask) {
+            return p + __builtin_ctz(mask);
+        }
+    }
+
+    return scan_uri_scalar(p, end);
+}
+
+__attribute__((target("avx2")))
+static unsigned char* scan_line_avx2(unsigned char* p, unsigned char* end) {
+    __m256i cr;
+    __m256i lf;
+    __m256i v;
+    uint32_t mask;
+
+    cr = _mm256_set1_epi8(CR);
+    lf = _mm256_set1_epi8(LF);
+
+    for (; end - p >= 32; p += 32) {
+        v = _mm256_loadu_si256((const __m256i*)p);
+        mask = _mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(v, cr), _mm256_cmpeq_epi8(v, lf)));
+
+        if (mask) {
+            return p + __builtin_ctz(mask);
+        }
+    }
+
+    return scan_line_scalar(p, end);
+}
+
+__attribute__((target("avx2")))
+static unsigned char* scan_token_avx2(unsigned char* p, unsigned char* end) {
+    __m256i lo;
+    __m256i hi;
+    __m256i nibble;
+    __m256i v;
+    __m256i t;
+    uint32_t mask;
+
+    lo = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)token_lo));
+    hi = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)token_hi));
+    nibble = _mm256_set1_epi8(0x0f);
+
+    for (; end - p >= 32; p += 32) {
+        v = _mm256_loadu_si256((const __m256i*)p);
+        t = _mm256_and_si256(_mm256_shuffle_epi8(lo, _mm256_and_si256(v, nibble)),
+                             _mm256_shuffle_epi8(hi, _mm256_and_si256(_mm256_srli_epi16(v, 4), nibble)));
+        mask = _mm256_movemask_epi8(_mm256_cmpeq_epi8(t, _mm256_setzero_si256()));
+
+        if (mask) {
+            return p + __builtin_ctz(mask);
+        }
+    }
+
+    return scan_token_scalar(p, end);
+}
+
+#endif /* HTTP_SCAN_X86 */
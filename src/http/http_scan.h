@@ -0,0 +1,43 @@
+/**
+ * @author ttoobne
+ * @date 2026/10/17
+ */
+
+#ifndef _HTTP_SCAN_H_
+#define _HTTP_SCAN_H_
+
+/*
+ * 解析器的批量扫描：在请求行与首部字段中跳到下一个需要状态机处理的字节。
+ * 启动时按 CPU 支持的指令集选择实现，扫描到缓冲区末尾不足一个向量的部分逐字节处理，
+ * 所以对不完整的请求同样适用，状态机本身不变。
+ */
+#define HTTP_SCAN_SCALAR    0           /* 逐字节扫描 */
+#define HTTP_SCAN_SSE42     1           /* SSE4.2 pcmpestri ，每次 16 字节 */
+#define HTTP_SCAN_AVX2      2           /* AVX2 比较与 movemask ，每次 32 字节 */
+
+/* 是否为首部字段名允许的 token 字符（ RFC 7230 tchar ） */
+#define http_token_char(ch) (http_token_chars[(unsigned char)(ch)])
+
+/*
+ * 扫描 [p, end) ，返回第一个需要处理的字节的位置，没有时返回 end 。
+ */
+typedef unsigned char* (http_scan_t) (unsigned char* p, unsigned char* end);
+
+extern const unsigned char http_token_chars[256];
+
+extern http_scan_t* http_scan_uri;      /* 跳到下一个空格或 '?' */
+extern http_scan_t* http_scan_line;     /* 跳到下一个 CR 或 LF */
+extern http_scan_t* http_scan_token;    /* 跳到下一个不是 token 字符的字节 */
+
+/*
+ * 选择不超过 level 且 CPU 支持的最快实现，返回实际选择的实现。
+ * 应在启动工作线程之前调用；不调用时使用逐字节扫描。
+ */
+int http_scan_init(int level);
+
+/*
+ * 返回实现的名称。
+ */
+const char* http_scan_name(int level);
+
+#endif /* _HTTP_SCAN_H_ */
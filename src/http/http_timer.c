@@ -7,167 +7,191 @@
 
 #include "log.h"
 #include "http_request.h"
+#include "times.h"
 
-#include <sys/time.h>
 #include <stddef.h>
-#include <pthread.h>
-
-static volatile rbtree_t    timer_rbtree;   /* 定时器所使用的红黑树 */
-static rbtree_node_t        timer_nil;      /* 红黑树的叶子节点 */
-static msec_t               current_msec;   /* 当前时间 */
-static pthread_mutex_t      timer_mutex;    /* 用于同步的互斥锁 */
-
-static int update_current_msec();
+#include <stdlib.h>
+#include <string.h>
+
+/* 时间轮，只由所属的事件循环线程操作，其他线程只能通过收件箱交给它节点 */
+typedef struct {
+    http_timer_t*       inbox;          /* 其他线程重新定时的节点组成的无锁栈 */
+    msec_t              remote_timeout; /* 其他线程定时用过的最短超时时间，所属线程阻塞等待不超过该时间 */
+    msec_t              current;        /* 下一个要处理的毫秒 */
+    unsigned long       count;          /* 槽中的节点数，包括惰性删除的节点 */
+    list_head_t         slots[WHEEL_SLOTS];
+    unsigned long       bitmap[WHEEL_SLOTS / (8 * sizeof(unsigned long))];  /* 非空的槽 */
+} timer_wheel_t;
+
+static __thread timer_wheel_t* local_wheel; /* 当前线程的时间轮 */
+
+static timer_wheel_t* get_wheel();
+static void wheel_post(timer_wheel_t* wheel, http_timer_t* timer, msec_t timeout);
+static void wheel_drain(timer_wheel_t* wheel);
+static void wheel_link(timer_wheel_t* wheel, http_timer_t* timer);
+static void wheel_unlink(timer_wheel_t* wheel, http_timer_t* timer);
+static void wheel_cascade(timer_wheel_t* wheel, unsigned slot, msec_t now, list_head_t* expired);
+static http_request_t* timer_owner(http_timer_t* timer);
 
 /*
- * 初始化定时器。
+ * 初始化定时器。时间轮由各线程首次使用时创建，这里只初始化主线程的时间轮。
  */
 int init_timer() {
-    /* 初始化的主要工作就是初始化一颗红黑树 */
-    if (rbtree_init(&timer_rbtree, &timer_nil, rbtree_insert_timer) != 0) {
-        log_error("rbtree init error.");
-        return -1;
-    }
-
-    /* 初始化互斥锁，用于多线程使用定时器的同步操作 */
-    if (pthread_mutex_init(&timer_mutex, NULL) != 0) {
-        log_error("timer mutex init failed.");
-        return -1;
-    }
-
-    /* 初始化 current_msec ，可做可不做 */
-    if (update_current_msec() != 0) {
-        log_error("get current time error.");
-        return -1;
-    }
-
-    return 0;
-}
-
-/*
- * 更新 current_msec 为当前时间，单位毫秒。
- */
-static int update_current_msec() {
-    struct timeval cur_time;
-    
-    if (gettimeofday(&cur_time, NULL) != 0) {
+    if (get_wheel() == NULL) {
+        log_error("timer wheel init failed.");
         return -1;
     }
 
-    current_msec = cur_time.tv_sec * 1000 + cur_time.tv_usec / 1000;
-
     return 0;
 }
 
 /*
- * 寻找定时器中距离超时时间最近的一个时间并返回。
+ * 寻找当前线程的时间轮中距离超时时间最近的一个时间并返回。
  * 如果定时器为空则返回 TIMER_INFINITE 。
+ * 高层槽中的节点只在下放时才能确定到期时间，所以第 0 层本圈为空时返回本圈结束的时间。
+ * 收件箱中随时可能有新的节点，等待时间不超过其他线程定时用过的最短超时时间，节点到期前总能被取走。
  */
 msec_t find_timer() {
-    msec_int_t timer;
-    rbtree_node_t* node;
-
-    //DBG("find timer pid:%u ready to lock\n", pthread_self());
-    pthread_mutex_lock(&timer_mutex);
-    //DBG("find timer pid:%u locked\n", pthread_self());
-
-    /* 如果定时器为空，则返回无穷 */
-    if (timer_rbtree.root == &timer_nil) {
-        //DBG("find timer pid:%u ready to unlock\n", pthread_self());
-        pthread_mutex_unlock(&timer_mutex);
-        //DBG("find timer pid:%u unlocked\n", pthread_self());
+    timer_wheel_t* wheel;
+    unsigned long bits;
+    unsigned bits_len;
+    unsigned idx;
+    unsigned i;
+    msec_t remote;
+    msec_t next;
+    msec_t now;
+    msec_t wait;
+
+    if ((wheel = local_wheel) == NULL) {
         return TIMER_INFINITE;
     }
 
-    /* 获取红黑树中最左边的节点即键最小的节点 */
-    node = rbtree_get_min(&timer_rbtree);
-    //ASSERT(node != NULL, "node is NULL.");
+    wheel_drain(wheel);
 
-    //DBG("find timer pid:%u ready to unlock\n", pthread_self());
-    pthread_mutex_unlock(&timer_mutex);
-    //DBG("find timer pid:%u unlocked\n", pthread_self());
+    wait = TIMER_INFINITE;
 
-    /* 计算与当前时间的差值并返回 */
-    update_current_msec();
+    if (wheel->count > 0) {
+        bits_len = 8 * sizeof(unsigned long);
 
-    timer = (msec_int_t)(node->key - current_msec);
+        /* 从当前槽开始在第 0 层的位图中找第一个非空的槽 */
+        idx = wheel->current & (WHEEL_ROOT_SIZE - 1);
+        next = (wheel->current | (WHEEL_ROOT_SIZE - 1)) + 1;
 
-    return (msec_t)(timer > 0 ? timer : 0);
+        for (i = idx / bits_len; i < WHEEL_ROOT_SIZE / bits_len; ++ i) {
+            bits = wheel->bitmap[i];
+
+            if (i == idx / bits_len) {
+                bits &= ~0UL << (idx % bits_len);
+            }
+
+            if (bits) {
+                next = (wheel->current & ~(msec_t)(WHEEL_ROOT_SIZE - 1)) + i * bits_len + __builtin_ctzl(bits);
+                break;
+            }
+        }
+
+        now = current_msec();
+        wait = next > now ? next - now : 0;
+    }
+
+    remote = __atomic_load_n(&(wheel->remote_timeout), __ATOMIC_RELAXED);
+
+    /* TIMER_INFINITE 按无符号数比较时最大 */
+    if (remote > 0 && wait > remote) {
+        wait = remote;
+    }
+
+    return wait;
 }
 
 /*
- * 执行超时事件的回调函数。
+ * 推进当前线程的时间轮，执行超时事件的回调函数。
+ * 到期的节点先整槽摘到 expired 中再逐个执行回调，回调中可以再次操作任意定时器：
+ * 等待回调期间被删除的节点不再执行回调，被重新定时的节点放回时间轮。
  */
 int expire_timers() {
-    rbtree_node_t* node;
+    timer_wheel_t* wheel;
+    list_head_t expired;
     http_timer_t* timer;
-    http_request_t* ev;
+    unsigned idx;
+    unsigned level;
+    msec_t now;
 
-    //while (timer_rbtree.root != &timer_nil) {
-    for ( ;; ) {
-        //DBG("expire timer pid:%u ready to lock\n", pthread_self());
-        pthread_mutex_lock(&timer_mutex);
+    if ((wheel = local_wheel) == NULL) {
+        return 0;
+    }
 
-        //DBG("expire timer pid:%u locked\n", pthread_self());
-        
-        /* 定时器为空，即红黑树为空 */
-        if (timer_rbtree.root == &timer_nil) {
-            break;
-        }
+    wheel_drain(wheel);
 
-        /* 获取红黑树中最左边的节点即键最小的节点 */
-        if ((node = rbtree_get_min(&timer_rbtree)) == NULL) {
-            log_error("get min failed.");
-            pthread_mutex_unlock(&timer_mutex);
-            return -1;
+    init_list_head(&expired);
+
+    now = current_msec();
+
+    while (wheel->current <= now) {
+        /* 时间轮为空时直接跳到当前时间 */
+        if (wheel->count == 0) {
+            wheel->current = now + 1;
+            break;
         }
 
-        update_current_msec();
+        idx = wheel->current & (WHEEL_ROOT_SIZE - 1);
 
-        /* 计算是否超时 */
-        if ((msec_int_t)(node->key - current_msec) <= 0) {
-            /* 如果超时 */
-            /* 删除红黑树中的节点 */
-            rbtree_delete(&timer_rbtree, node);
+        /* 第 0 层转完一圈，逐层下放上一层的槽，下放的层转完一圈时再下放更高一层 */
+        if (idx == 0) {
+            for (level = 0; level < WHEEL_LEVELS; ++ level) {
+                idx = (wheel->current >> (WHEEL_ROOT_BITS + level * WHEEL_LEVEL_BITS)) & (WHEEL_LEVEL_SIZE - 1);
+                wheel_cascade(wheel, WHEEL_ROOT_SIZE + level * WHEEL_LEVEL_SIZE + idx, now, &expired);
 
-            pthread_mutex_unlock(&timer_mutex);
+                if (idx != 0) {
+                    break;
+                }
+            }
 
+            idx = 0;
+        }
 
-            /* 通过偏移量获取 timer 指针 */
-            timer = (http_timer_t*) ((char*)node - offsetof(http_timer_t, timer_node));
+        wheel_cascade(wheel, idx, now, &expired);
 
-            /* 标记红黑树中已经不监控该事件 */
-            timer->timer_set = 0;
+        wheel->current ++ ;
+    }
 
-            /* 通过偏移量获取事件指针 */
-            ev = (http_request_t*) ((char*)timer - offsetof(http_request_t, timer));
-            
-            /* 标记事件已超时 */
-            timer->timeout = 1;
+    while (!list_empty(&expired)) {
+        timer = list_entry(expired.next, http_timer_t, timer_node);
+        list_del(&(timer->timer_node));
+        timer->expired = 0;
 
-            /* 执行回调函数 */
-            if (timer->handler) {
-                timer->handler((void*)ev);
-            }
+        if (!timer->timer_set) {
+            continue;
+        }
 
+        if ((msec_int_t)(timer->expires - now) > 0) {
+            wheel_link(wheel, timer);
             continue;
         }
 
+        /* 标记事件已超时 */
+        timer->timer_set = 0;
+        timer->timeout = 1;
 
-        break;
+        /* 执行回调函数 */
+        if (timer->handler) {
+            timer->handler((void*)timer_owner(timer));
+        }
     }
 
-    pthread_mutex_unlock(&timer_mutex);
-
     return 0;
 }
 
 /*
  * 为事件添加定时器。
+ * 事件仍在槽中且新的到期时间不早于原来的到期时间时只更新到期时间，槽转到时再移动到正确的位置。
+ * 在其他线程中调用时只设置定时器，节点经收件箱交给所属线程放入槽中。
  */
 int add_timer(void* http_request, msec_t timeout, timer_handler_t* handler) {
     http_request_t* ev;
     http_timer_t* timer;
+    timer_wheel_t* wheel;
+    msec_t expires;
 
     if (http_request == NULL) {
         log_error("event ptr is NULL.");
@@ -182,42 +206,64 @@ int add_timer(void* http_request, msec_t timeout, timer_handler_t* handler) {
     ev = (http_request_t*)http_request;
     timer = &(ev->timer);
 
-    if (timer->timer_set) {
-        /* 如果定时器已被设置，则先删除再添加 */
-        //log_debug("delete timer first?");
-        delete_timer(ev);
+    if (timer->wheel == NULL && (timer->wheel = get_wheel()) == NULL) {
+        log_error("timer wheel init failed.");
+        return -1;
     }
 
+    wheel = (timer_wheel_t*)timer->wheel;
+    expires = current_msec() + timeout;
+
+    if (wheel != local_wheel) {
+        if (timer->linked || timer->expired) {
+            log_error("timer is still in the wheel of another thread.");
+            return -1;
+        }
+
+        timer->timer_set = 1;
+        timer->timeout = 0;
+        timer->handler = handler;
+        timer->expires = expires;
+
+        wheel_post(wheel, timer, timeout);
+
+        return 0;
+    }
+
+    wheel_drain(wheel);
+
     /* 设置标记位和回调函数 */
     timer->timer_set = 1;
     timer->timeout = 0;
     timer->handler = handler;
 
-    update_current_msec();
-
-    /* 设置超时时间 */
-    timer->timer_node.key = current_msec + timeout;
+    /* 等待回调的节点由 expire_timers 放回时间轮 */
+    if (timer->expired) {
+        timer->expires = expires;
+        return 0;
+    }
 
-    pthread_mutex_lock(&timer_mutex);
+    if (timer->linked && expires >= timer->expires) {
+        timer->expires = expires;
+    } else {
+        if (timer->linked) {
+            wheel_unlink(wheel, timer);
+        }
 
-    /* 向红黑树中插入节点 */
-    //log_debug("ready to insert:%d", timer->timer_node.key);
-    if (rbtree_insert(&timer_rbtree, &(timer->timer_node)) != 0) {
-        log_error("rbtree insert failed.");
-        pthread_mutex_unlock(&timer_mutex);
-        return -1;
+        timer->expires = expires;
+        wheel_link(wheel, timer);
     }
 
-    pthread_mutex_unlock(&timer_mutex);
-
     return 0;
 }
 
 /*
  * 删除指定事件的定时器。
+ * 惰性删除：只清除标记，节点留在槽中，随后的 add_timer 通常可以原地复用。
  */
 int delete_timer(void* http_request) {
     http_request_t* ev;
+    timer_wheel_t* wheel;
 
     if (http_request == NULL) {
         log_error("event ptr is NULL.");
@@ -226,20 +272,249 @@ int delete_timer(void* http_request) {
 
     ev = (http_request_t*)http_request;
 
-    pthread_mutex_lock(&timer_mutex);
+    /* 没有设置定时器则无需删除 */
+    if (!(ev->timer).timer_set) {
+        return 0;
+    }
+
+    wheel = (timer_wheel_t*)(ev->timer).wheel;
 
-    /* 删除红黑树中的节点 */
-    //log_debug("ready to delete:%d", (ev->timer).timer_node.key);
-    if (rbtree_delete(&timer_rbtree, &((ev->timer).timer_node)) != 0) {
-        log_error("delete rbtree node failed.");
-        pthread_mutex_unlock(&timer_mutex);
+    if (wheel != local_wheel) {
+        log_error("timer is still in the wheel of another thread.");
         return -1;
     }
 
-    pthread_mutex_unlock(&timer_mutex);
+    /* 节点可能还在收件箱中，取走之后才能确定它的状态 */
+    wheel_drain(wheel);
 
-    /* 标记红黑树中已经不监控该事件 */
+    /* 标记已经不监控该事件 */
     (ev->timer).timer_set = 0;
 
     return 0;
-}
\ No newline at end of file
+}
+
+/*
+ * 将事件彻底移出时间轮，释放事件之前必须调用。
+ */
+int detach_timer(void* http_request) {
+    http_request_t* ev;
+    http_timer_t* timer;
+    timer_wheel_t* wheel;
+
+    if (http_request == NULL) {
+        log_error("event ptr is NULL.");
+        return -1;
+    }
+
+    ev = (http_request_t*)http_request;
+    timer = &(ev->timer);
+
+    if ((wheel = (timer_wheel_t*)timer->wheel) == NULL) {
+        return 0;
+    }
+
+    if (wheel != local_wheel) {
+        if (timer->linked || timer->expired) {
+            log_error("timer is still in the wheel of another thread.");
+            return -1;
+        }
+
+        timer->timer_set = 0;
+
+        return 0;
+    }
+
+    wheel_drain(wheel);
+
+    if (timer->linked) {
+        wheel_unlink(wheel, timer);
+    }
+
+    /* 等待回调的节点从 expired 中移出， expire_timers 每次都从链表头取节点 */
+    if (timer->expired) {
+        list_del(&(timer->timer_node));
+        timer->expired = 0;
+    }
+
+    timer->timer_set = 0;
+
+    return 0;
+}
+
+/*
+ * 获取当前线程的时间轮，没有则创建。失败返回 NULL 。
+ */
+static timer_wheel_t* get_wheel() {
+    timer_wheel_t* wheel;
+    int i;
+
+    if (local_wheel) {
+        return local_wheel;
+    }
+
+    if ((wheel = (timer_wheel_t*)malloc(sizeof(timer_wheel_t))) == NULL) {
+        log_error("timer_wheel_t malloc failed.");
+        return NULL;
+    }
+
+    for (i = 0; i < WHEEL_SLOTS; ++ i) {
+        init_list_head(&(wheel->slots[i]));
+    }
+
+    memset(wheel->bitmap, 0, sizeof(wheel->bitmap));
+    wheel->inbox = NULL;
+    wheel->remote_timeout = 0;
+    wheel->count = 0;
+    wheel->current = current_msec();
+
+    local_wheel = wheel;
+
+    return wheel;
+}
+
+/*
+ * 其他线程把节点压入时间轮的收件箱。
+ * 收件箱只会被所属线程整个取走，不会单个弹出，所以无锁栈没有 ABA 问题。
+ */
+static void wheel_post(timer_wheel_t* wheel, http_timer_t* timer, msec_t timeout) {
+    http_timer_t* head;
+    msec_t remote;
+
+    remote = __atomic_load_n(&(wheel->remote_timeout), __ATOMIC_RELAXED);
+
+    while ((remote == 0 || timeout < remote) &&
+           !__atomic_compare_exchange_n(&(wheel->remote_timeout), &remote, timeout, 1,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+        /* 失败时 remote 已更新为当前值，重新比较 */
+    }
+
+    head = __atomic_load_n(&(wheel->inbox), __ATOMIC_RELAXED);
+
+    do {
+        timer->next = (void*)head;
+    } while (!__atomic_compare_exchange_n(&(wheel->inbox), &head, timer, 1, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+}
+
+/*
+ * 所属线程取走收件箱中的所有节点放入槽中，已被删除的节点直接丢弃。
+ */
+static void wheel_drain(timer_wheel_t* wheel) {
+    http_timer_t* timer;
+    http_timer_t* next;
+
+    if (__atomic_load_n(&(wheel->inbox), __ATOMIC_RELAXED) == NULL) {
+        return;
+    }
+
+    timer = __atomic_exchange_n(&(wheel->inbox), NULL, __ATOMIC_ACQUIRE);
+
+    while (timer) {
+        next = (http_timer_t*)timer->next;
+        timer->next = NULL;
+
+        if (timer->timer_set) {
+            wheel_link(wheel, timer);
+        }
+
+        timer = next;
+    }
+}
+
+/*
+ * 按到期时间与 current 的距离选择层，按到期时间选择该层的槽。
+ */
+static void wheel_link(timer_wheel_t* wheel, http_timer_t* timer) {
+    msec_t expires;
+    msec_t delta;
+    unsigned shift;
+    unsigned slot;
+    unsigned level;
+
+    expires = timer->expires;
+
+    /* 已经到期的放在下一个要处理的槽 */
+    if ((msec_int_t)(expires - wheel->current) < 0) {
+        expires = wheel->current;
+    }
+
+    delta = expires - wheel->current;
+
+    if (delta < WHEEL_ROOT_SIZE) {
+        slot = expires & (WHEEL_ROOT_SIZE - 1);
+    } else {
+        for (level = 0; level < WHEEL_LEVELS - 1; ++ level) {
+            if (delta < 1UL << (WHEEL_ROOT_BITS + (level + 1) * WHEEL_LEVEL_BITS)) {
+                break;
+            }
+        }
+
+        /* 超出时间轮范围的放在最高层的最远处，下放时重新计算 */
+        shift = WHEEL_ROOT_BITS + level * WHEEL_LEVEL_BITS;
+        if (delta >= 1UL << (shift + WHEEL_LEVEL_BITS)) {
+            expires = wheel->current + (1UL << (shift + WHEEL_LEVEL_BITS)) - 1;
+        }
+
+        slot = WHEEL_ROOT_SIZE + level * WHEEL_LEVEL_SIZE + ((expires >> shift) & (WHEEL_LEVEL_SIZE - 1));
+    }
+
+    list_add_tail(&(timer->timer_node), &(wheel->slots[slot]));
+    wheel->bitmap[slot / (8 * sizeof(unsigned long))] |= 1UL << (slot % (8 * sizeof(unsigned long)));
+    wheel->count ++ ;
+
+    timer->slot = slot;
+    timer->linked = 1;
+}
+
+/*
+ * 将节点移出所在的槽。
+ */
+static void wheel_unlink(timer_wheel_t* wheel, http_timer_t* timer) {
+    unsigned slot;
+
+    slot = timer->slot;
+
+    list_del(&(timer->timer_node));
+
+    if (list_empty(&(wheel->slots[slot]))) {
+        wheel->bitmap[slot / (8 * sizeof(unsigned long))] &= ~(1UL << (slot % (8 * sizeof(unsigned long))));
+    }
+
+    wheel->count -- ;
+    timer->linked = 0;
+}
+
+/*
+ * 处理一个槽中的所有节点：已删除的移出，已到期的移到 expired ，其余按新的到期时间重新放置。
+ */
+static void wheel_cascade(timer_wheel_t* wheel, unsigned slot, msec_t now, list_head_t* expired) {
+    list_head_t* head;
+    http_timer_t* timer;
+
+    head = &(wheel->slots[slot]);
+
+    while (!list_empty(head)) {
+        timer = list_entry(head->next, http_timer_t, timer_node);
+        wheel_unlink(wheel, timer);
+
+        if (!timer->timer_set) {
+            continue;
+        }
+
+        if ((msec_int_t)(timer->expires - now) <= 0) {
+            /* 等待执行回调，期间不在槽中 */
+            timer->expired = 1;
+            list_add_tail(&(timer->timer_node), expired);
+            continue;
+        }
+
+        /* 到期时间在 now 之后，放回时间轮，本槽当前这一刻不会再被处理 */
+        wheel_link(wheel, timer);
+    }
+}
+
+/*
+ * 通过偏移量获取定时器所属的事件。
+ */
+static http_request_t* timer_owner(http_timer_t* timer) {
+    return (http_request_t*)((char*)timer - offsetof(http_request_t, timer));
+}
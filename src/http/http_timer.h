@@ -6,20 +6,39 @@
 #ifndef _HTTP_TIMER_H_
 #define _HTTP_TIMER_H_
 
-#include "rbtree.h"
+#include "list.h"
 
 #define TIMER_INFINITE      -1          /* 一直阻塞 */
 
-typedef rbtree_key_t        msec_t;
-typedef rbtree_key_int_t    msec_int_t;
+/*
+ * 分层时间轮，精度 1 毫秒。第 0 层 256 个槽，每槽 1 毫秒；其上 4 层各 64 个槽，每层的一个槽覆盖下一层一整圈。
+ * 高层的槽转到时整体下放到低层，第 0 层的槽转到时整体到期。
+ * 每个事件循环线程拥有自己的时间轮，事件首次加入定时器时所在线程的时间轮负责该事件。
+ * 时间轮只由所属线程操作，不加锁；其他线程为事件重新定时时把节点放入该时间轮的无锁收件箱，由所属线程取走放入槽中。
+ */
+#define WHEEL_ROOT_BITS     8
+#define WHEEL_LEVEL_BITS    6
+#define WHEEL_LEVELS        4           /* 第 0 层之上的层数 */
+#define WHEEL_ROOT_SIZE     (1 << WHEEL_ROOT_BITS)
+#define WHEEL_LEVEL_SIZE    (1 << WHEEL_LEVEL_BITS)
+#define WHEEL_SLOTS         (WHEEL_ROOT_SIZE + WHEEL_LEVELS * WHEEL_LEVEL_SIZE)
+
+typedef unsigned long       msec_t;
+typedef long                msec_int_t;
 
 typedef int (timer_handler_t) (void*);
 
 typedef struct {
-    rbtree_node_t       timer_node;     /* 红黑树中的节点 */
+    list_head_t         timer_node;     /* 时间轮槽中的节点 */
+    msec_t              expires;        /* 到期时间 */
     timer_handler_t*    handler;        /* 超时事件的回调函数 */
+    void*               wheel;          /* 所属的时间轮，首次加入定时器时确定 */
+    void*               next;           /* 收件箱中的下一个节点 */
+    unsigned            slot:16;        /* 所在的槽， linked 为 1 时有效 */
     unsigned            timer_set:1;    /* 如果为 1 ，则该事件设置了定时器 */
     unsigned            timeout:1;      /* 如果为 1 ，表示事件已超时 */
+    unsigned            linked:1;       /* 如果为 1 ，节点仍在槽中。删除是惰性的，被删除的节点在槽转到时才移出 */
+    unsigned            expired:1;      /* 如果为 1 ，节点已到期，正在等待执行回调，既不在槽中也不能再放入槽中 */
 } http_timer_t;
 
 /*
@@ -28,18 +47,19 @@ typedef struct {
 int init_timer();
 
 /*
- * 寻找定时器中距离超时时间最近的一个时间并返回。
+ * 寻找当前线程的时间轮中距离超时时间最近的一个时间并返回。
  * 如果定时器为空则返回 TIMER_INFINITE 。
  */
 msec_t find_timer();
 
 /*
- * 执行超时事件的回调函数。
+ * 推进当前线程的时间轮，执行超时事件的回调函数。
  */
 int expire_timers();
 
 /*
  * 为事件添加定时器。
+ * 在其他线程中调用时事件必须不在时间轮中（分发给工作线程之前已经移出），节点经收件箱交给所属线程。
  */
 int add_timer(void* http_request, msec_t timeout, timer_handler_t* handler);
 
@@ -48,4 +68,9 @@ int add_timer(void* http_request, msec_t timeout, timer_handler_t* handler);
  */
 int delete_timer(void* http_request);
 
-#endif /* _HTTP_TIMER_H_ */
\ No newline at end of file
+/*
+ * 将事件彻底移出时间轮，释放事件之前必须调用。
+ */
+int detach_timer(void* http_request);
+
+#endif /* _HTTP_TIMER_H_ */
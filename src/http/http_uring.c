@@ -0,0 +1,663 @@
+/**
+ * @author ttoobne
+ * @date 2026/10/17
+ */
+
+#include "http_uring.h"
+
+#include "http_buffer.h"
+#include "http_timer.h"
+#include "log.h"
+#include "pool.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+static void http_uring_accept(uring_t* uring, http_request_t* listen_event, int res, unsigned flags, config_t* config);
+static void http_uring_recv(http_uring_conn_t* conn, int res, unsigned flags);
+static void http_uring_sent(http_uring_conn_t* conn, unsigned op, int res);
+static int http_uring_append(http_uring_conn_t* conn, unsigned char* data, size_t len);
+static void http_uring_process(http_uring_conn_t* conn);
+static http_uring_send_t* http_uring_attach_send(http_uring_conn_t* conn);
+static void http_uring_detach_send(http_uring_conn_t* conn);
+static void http_uring_send_response(http_uring_conn_t* conn);
+static void http_uring_next_part(http_uring_conn_t* conn);
+static void http_uring_submit_round(http_uring_conn_t* conn);
+static void http_uring_finish_response(http_uring_conn_t* conn);
+static int http_uring_arm_recv(http_uring_conn_t* conn);
+static void http_uring_close(http_uring_conn_t* conn);
+static void http_uring_release(http_uring_conn_t* conn);
+static int http_uring_timeout(void* http_request);
+
+static __thread pool_cache_t* send_cache;   /* 当前事件循环线程的空闲响应块 */
+
+/*
+ * 在监听描述符上提交 multishot accept ， listen_event 为监听描述符对应的 http_request_t 。
+ * 成功返回 0 ，否则返回 -1 。
+ */
+int http_uring_listen(uring_t* uring, http_request_t* listen_event) {
+    io_uring_sqe* sqe;
+
+    if (uring == NULL || listen_event == NULL) {
+        log_error("arguments invalid.");
+        return -1;
+    }
+
+    if ((sqe = uring_get_sqe(uring)) == NULL) {
+        log_error("submit accept failed.");
+        return -1;
+    }
+
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->fd = listen_event->fd;
+    sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+    sqe->user_data = (uintptr_t)listen_event | URING_OP_ACCEPT;
+
+    return 0;
+}
+
+/*
+ * 处理一个完成事件。
+ */
+void http_uring_handle(uring_t* uring, io_uring_cqe* cqe, config_t* config) {
+    unsigned op;
+    void* ptr;
+    int res;
+    unsigned flags;
+
+    /* 处理过程中可能提交新的操作，先取出完成事件的内容 */
+    op = cqe->user_data & URING_OP_MASK;
+    ptr = (void*)(uintptr_t)(cqe->user_data & ~(unsigned long long)URING_OP_MASK);
+    res = cqe->res;
+    flags = cqe->flags;
+
+    switch (op) {
+    case URING_OP_ACCEPT:
+        http_uring_accept(uring, (http_request_t*)ptr, res, flags, config);
+        break;
+
+    case URING_OP_RECV:
+        http_uring_recv((http_uring_conn_t*)ptr, res, flags);
+        break;
+
+    case URING_OP_SEND:
+    case URING_OP_SPLICE_IN:
+    case URING_OP_SPLICE_OUT:
+        http_uring_sent((http_uring_conn_t*)ptr, op, res);
+        break;
+
+    default:
+        log_error("unknown io_uring operation %u.", op);
+        break;
+    }
+}
+
+/*
+ * 新连接到达：初始化连接，提交 multishot recv ，加入定时器。
+ * multishot accept 终止时重新提交。
+ */
+static void http_uring_accept(uring_t* uring, http_request_t* listen_event, int res, unsigned flags, config_t* config) {
+    http_uring_conn_t* conn;
+
+    if (!(flags & IORING_CQE_F_MORE)) {
+        http_uring_listen(uring, listen_event);
+    }
+
+    if (res < 0) {
+        log_error("accept error.");
+        return;
+    }
+
+    log_info("new connection arrive.");
+
+    if ((conn = (http_uring_conn_t*)pool_alloc(sizeof(http_uring_conn_t))) == NULL) {
+        log_error("http_uring_conn_t alloc failed.");
+        close(res);
+        return;
+    }
+
+    /* 套接字保持阻塞，由 io_uring 负责等待就绪，splice 到非阻塞套接字会直接返回 EAGAIN */
+    http_request_setup(&(conn->rq), res, NULL, config);
+
+    conn->uring = uring;
+    conn->inflight = 0;
+    conn->pending = 0;
+    conn->closing = 0;
+    conn->recving = 0;
+    conn->sending = 0;
+    conn->failed = 0;
+    conn->eof = 0;
+    conn->send = NULL;
+    conn->pipefd[0] = -1;
+    conn->pipefd[1] = -1;
+    conn->pipe_size = URING_PIPE_SIZE;
+
+    if (http_uring_arm_recv(conn) != 0) {
+        http_uring_close(conn);
+        http_uring_release(conn);
+        return;
+    }
+
+    add_timer((void*)&(conn->rq), conn->rq.timeout, http_uring_timeout);
+}
+
+/*
+ * 收到数据：拷贝到连接的缓冲区，立即归还接收缓冲区。
+ * 正在发送响应时只追加数据，发送完毕后再解析。
+ */
+static void http_uring_recv(http_uring_conn_t* conn, int res, unsigned flags) {
+    http_request_t* rq;
+    unsigned bid;
+
+    rq = &(conn->rq);
+
+    if (!(flags & IORING_CQE_F_MORE)) {
+        conn->recving = 0;
+        conn->inflight -- ;
+    }
+
+    if (flags & IORING_CQE_F_BUFFER) {
+        bid = flags >> IORING_CQE_BUFFER_SHIFT;
+
+        /* 发送完毕后就关闭连接的响应正在发送时，后续数据不会再被处理，直接丢弃 */
+        if (res > 0 && !conn->closing && (!conn->sending || conn->send->response.keep_alive)) {
+            if (http_uring_append(conn, uring_buffer(conn->uring, bid), res) != 0) {
+                /* 请求头部过大，与 epoll 模式一致返回 400 */
+                if (conn->sending || http_uring_attach_send(conn) == NULL) {
+                    http_uring_close(conn);
+                } else {
+                    http_prepare_error(rq, &(conn->send->response), HTTP_BAD_REQUEST);
+                    http_uring_send_response(conn);
+                }
+            } else if (!conn->sending) {
+                http_uring_process(conn);
+            }
+        }
+
+        uring_recycle_buffer(conn->uring, bid);
+    } else if (res == 0) {
+        /* 对端关闭连接，正在发送响应时等流水线上已收到的请求处理完毕再关闭 */
+        conn->eof = 1;
+
+        if (!conn->sending) {
+            http_uring_close(conn);
+        }
+    } else if (res < 0 && res != -ENOBUFS) {
+        http_uring_close(conn);
+    }
+
+    /* 接收缓冲区暂时用尽或 multishot 被内核终止，重新提交 */
+    if (!conn->closing && !conn->recving && !conn->eof && http_uring_arm_recv(conn) != 0) {
+        http_uring_close(conn);
+    }
+
+    http_uring_release(conn);
+}
+
+/*
+ * 链式发送中的一个操作完成，本轮所有操作完成后决定继续发送、结束响应还是关闭连接。
+ */
+static void http_uring_sent(http_uring_conn_t* conn, unsigned op, int res) {
+    http_uring_send_t* send;
+
+    send = conn->send;
+    conn->inflight -- ;
+    conn->pending -- ;
+
+    if (res < 0) {
+        /* 前一个操作出错或发送不完整时链中后续的操作被取消，下一轮重新提交即可 */
+        if (res != -ECANCELED) {
+            conn->failed = 1;
+        }
+    } else if (op == URING_OP_SEND) {
+        send->mem_sent += res;
+    } else if (op == URING_OP_SPLICE_IN) {
+        if (res == 0) {
+            /* 文件被截断 */
+            conn->failed = 1;
+        }
+
+        send->file_off += res;
+    } else {
+        send->file_sent += res;
+    }
+
+    if (conn->pending > 0) {
+        return;
+    }
+
+    if (conn->closing) {
+        http_uring_release(conn);
+        return;
+    }
+
+    if (conn->failed) {
+        log_error("send response error.");
+        http_uring_close(conn);
+        http_uring_release(conn);
+        return;
+    }
+
+    if (send->mem_sent < send->response.headers_len + send->response.body_len ||
+        send->file_sent < send->response.file_len) {
+        http_uring_submit_round(conn);
+        http_uring_release(conn);
+        return;
+    }
+
+    if (send->part < send->response.part_num) {
+        http_uring_next_part(conn);
+        http_uring_submit_round(conn);
+        http_uring_release(conn);
+        return;
+    }
+
+    http_uring_finish_response(conn);
+    http_uring_release(conn);
+}
+
+/*
+ * 把接收缓冲区中的数据追加到连接的读缓冲区，读缓冲区满时先解析已有的数据，再追加大缓冲区，
+ * 这样追加时只需移动正在解析的请求行或首部字段。
+ * 成功返回 0 ，请求头部超过 large_header_buffers 或分配失败时返回 -1 。
+ */
+static int http_uring_append(http_uring_conn_t* conn, unsigned char* data, size_t len) {
+    http_request_t* rq;
+    size_t n;
+
+    rq = &(conn->rq);
+
+    if (http_request_attach_buffer(rq) != 0) {
+        return -1;
+    }
+
+    while (len > 0 && !conn->closing) {
+        if (rq->bufed == rq->buflast) {
+            if (!conn->sending) {
+                http_uring_process(conn);
+            }
+
+            if (http_request_grow_buffer(rq) != 0) {
+                return -1;
+            }
+        }
+
+        n = rq->buflast - rq->bufed;
+        n = n < len ? n : len;
+
+        memcpy(rq->bufed, data, n);
+        rq->bufed += n;
+        data += n;
+        len -= n;
+    }
+
+    return 0;
+}
+
+/*
+ * 解析缓冲区中的数据，请求完整时生成响应并开始发送。
+ */
+static void http_uring_process(http_uring_conn_t* conn) {
+    http_uring_send_t* send;
+    http_request_t* rq;
+    int ret;
+
+    rq = &(conn->rq);
+
+    if (rq->buf == NULL || rq->bufed == rq->bufst) {
+        return;
+    }
+
+    delete_timer((void*)rq);
+
+    if ((ret = rq->handler(rq)) == REQUEST_AGAIN) {
+        /* 请求不完整，等待更多数据，缓冲区满时由 http_uring_append 追加 */
+        add_timer((void*)rq, rq->timeout, http_uring_timeout);
+        return;
+    }
+
+    if ((send = http_uring_attach_send(conn)) == NULL) {
+        http_uring_close(conn);
+        return;
+    }
+
+    if (ret != REQUEST_OK) {
+        http_prepare_error(rq, &(send->response), HTTP_BAD_REQUEST);
+    } else {
+        http_prepare_response(rq, &(send->out), &(send->response));
+    }
+
+    http_uring_send_response(conn);
+}
+
+/*
+ * 为即将生成的响应挂上响应块，优先使用当前线程缓存的空闲响应块。失败返回 NULL 。
+ */
+static http_uring_send_t* http_uring_attach_send(http_uring_conn_t* conn) {
+    http_uring_send_t* send;
+
+    send = NULL;
+
+    /* io_uring 只在事件循环线程上运行，缓存在首次使用时创建 */
+    if (send_cache == NULL) {
+        send_cache = pool_cache_create(URING_SEND_CACHE_MAX);
+    }
+
+    if (send_cache) {
+        send = (http_uring_send_t*)pool_cache_get(send_cache);
+    }
+
+    if (send == NULL && (send = (http_uring_send_t*)malloc(sizeof(http_uring_send_t))) == NULL) {
+        log_error("http_uring_send_t malloc failed.");
+        return NULL;
+    }
+
+    send->node.cache = send_cache;
+    send->response.file = NULL;
+    send->response.cached = NULL;
+    send->filefd = -1;
+
+    conn->send = send;
+
+    return send;
+}
+
+/*
+ * 释放响应持有的文件与缓存条目，归还响应块。
+ */
+static void http_uring_detach_send(http_uring_conn_t* conn) {
+    http_uring_send_t* send;
+
+    if ((send = conn->send) == NULL) {
+        return;
+    }
+
+    http_file_release(send->response.file);
+    http_cached_release(send->response.cached);
+
+    if (pool_cache_put(send_cache, &(send->node)) != 0) {
+        free(send);
+    }
+
+    conn->send = NULL;
+}
+
+/*
+ * 开始发送 conn->send 中的响应。
+ */
+static void http_uring_send_response(http_uring_conn_t* conn) {
+    http_uring_send_t* send;
+    http_response_t* resp;
+    int ret;
+
+    send = conn->send;
+    resp = &(send->response);
+
+    conn->sending = 1;
+    conn->failed = 0;
+    send->mem_sent = 0;
+    send->file_off = 0;
+    send->file_sent = 0;
+    send->part = 0;
+
+    if (resp->file == NULL) {
+        resp->file_len = 0;
+        resp->part_num = 0;
+    }
+
+    if (resp->part_num > 0) {
+        http_uring_next_part(conn);
+    }
+
+    if (resp->file_len > 0) {
+        /* 文件描述符属于打开文件缓存的条目，响应持有条目的引用直到发送完毕 */
+        send->filefd = resp->file->fd;
+
+        if (conn->pipefd[0] < 0 && pipe2(conn->pipefd, O_CLOEXEC) != 0) {
+            log_error("create pipe error.");
+            http_uring_close(conn);
+            return;
+        }
+
+        /* 扩大管道失败不影响发送，只是轮数更多 */
+        if (resp->file_len > (off_t)conn->pipe_size && conn->pipe_size < URING_PIPE_SIZE_MAX &&
+            (ret = fcntl(conn->pipefd[0], F_SETPIPE_SZ, URING_PIPE_SIZE_MAX)) > 0) {
+            conn->pipe_size = ret;
+        }
+    }
+
+    http_uring_submit_round(conn);
+}
+
+/*
+ * 多个区间时把下一部分的分隔行与文件区间作为当前的响应体与文件区间，头部只在第一部分之前发送。
+ */
+static void http_uring_next_part(http_uring_conn_t* conn) {
+    http_uring_send_t* send;
+    http_response_t* resp;
+    http_part_t* part;
+
+    send = conn->send;
+    resp = &(send->response);
+    part = &(resp->parts[send->part ++ ]);
+
+    resp->body = resp->page + part->head_off;
+    resp->body_len = part->head_len;
+    resp->file_off = part->file_off;
+    resp->file_len = part->file_len;
+
+    send->mem_sent = send->part == 1 ? 0 : resp->headers_len;
+    send->file_off = 0;
+    send->file_sent = 0;
+}
+
+/*
+ * 提交一轮链式发送：发送剩余的头部与响应体 -> 文件读入管道 -> 管道写入套接字。
+ * 每轮最多转发 pipe_size 字节文件内容，上一轮留在管道中的数据先发送。
+ * 整条链先一次预留，保证它不会被拆到两次提交中，预留失败时关闭连接。
+ */
+static void http_uring_submit_round(http_uring_conn_t* conn) {
+    http_uring_send_t* send;
+    http_response_t* resp;
+    io_uring_sqe* sqe;
+    size_t sent;
+    size_t len;
+    int iovcnt;
+    int more;
+    int last;
+
+    send = conn->send;
+    resp = &(send->response);
+    more = send->file_sent < resp->file_len;
+    last = send->part >= resp->part_num;
+
+    if (uring_reserve(conn->uring, URING_CHAIN_MAX) != 0) {
+        http_uring_close(conn);
+        return;
+    }
+
+    /* 头部与响应体用一次 sendmsg 发送 */
+    if (send->mem_sent < resp->headers_len + resp->body_len) {
+        sent = send->mem_sent;
+        iovcnt = 0;
+
+        if (sent < resp->headers_len) {
+            send->iov[iovcnt].iov_base = resp->headers + sent;
+            send->iov[iovcnt].iov_len = resp->headers_len - sent;
+            iovcnt ++ ;
+            sent = 0;
+        } else {
+            sent -= resp->headers_len;
+        }
+
+        if (resp->body_len > 0) {
+            send->iov[iovcnt].iov_base = (void*)(resp->body + sent);
+            send->iov[iovcnt].iov_len = resp->body_len - sent;
+            iovcnt ++ ;
+        }
+
+        memset(&(send->msg), 0, sizeof(send->msg));
+        send->msg.msg_iov = send->iov;
+        send->msg.msg_iovlen = iovcnt;
+
+        sqe = uring_get_sqe(conn->uring);
+        sqe->opcode = IORING_OP_SENDMSG;
+        sqe->fd = conn->rq.fd;
+        sqe->addr = (uintptr_t)&(send->msg);
+        sqe->len = 1;
+        /* 后面还有文件内容时暂缓发出不满一个报文段的尾部，避免 Nagle 算法与延迟确认叠加造成停顿 */
+        sqe->msg_flags = MSG_NOSIGNAL | MSG_WAITALL | (more || !last ? MSG_MORE : 0);
+        sqe->flags = more ? IOSQE_IO_LINK : 0;
+        sqe->user_data = (uintptr_t)conn | URING_OP_SEND;
+        conn->pending ++ ;
+    }
+
+    if (more) {
+        len = send->file_off - send->file_sent;
+
+        /* 管道已空，从文件读入下一段 */
+        if (len == 0) {
+            len = resp->file_len - send->file_off;
+            if (len > conn->pipe_size) {
+                len = conn->pipe_size;
+            }
+
+            sqe = uring_get_sqe(conn->uring);
+            sqe->opcode = IORING_OP_SPLICE;
+            sqe->splice_fd_in = send->filefd;
+            sqe->splice_off_in = resp->file_off + send->file_off;
+            sqe->fd = conn->pipefd[1];
+            sqe->off = (unsigned long long)-1;
+            sqe->len = len;
+            sqe->flags = IOSQE_IO_LINK;
+            sqe->user_data = (uintptr_t)conn | URING_OP_SPLICE_IN;
+            conn->pending ++ ;
+        }
+
+        sqe = uring_get_sqe(conn->uring);
+        sqe->opcode = IORING_OP_SPLICE;
+        sqe->splice_fd_in = conn->pipefd[0];
+        sqe->splice_off_in = (unsigned long long)-1;
+        sqe->fd = conn->rq.fd;
+        sqe->off = (unsigned long long)-1;
+        sqe->len = len;
+        sqe->splice_flags = SPLICE_F_MOVE | (send->file_sent + len < resp->file_len || !last ? SPLICE_F_MORE : 0);
+        sqe->user_data = (uintptr_t)conn | URING_OP_SPLICE_OUT;
+        conn->pending ++ ;
+    }
+
+    conn->inflight += conn->pending;
+}
+
+/*
+ * 响应发送完毕：非长连接则关闭，否则重置请求并继续解析已收到的数据。
+ */
+static void http_uring_finish_response(http_uring_conn_t* conn) {
+    unsigned keep_alive;
+
+    keep_alive = conn->send->response.keep_alive;
+    http_uring_detach_send(conn);
+
+    conn->sending = 0;
+
+    if (!keep_alive) {
+        http_uring_close(conn);
+        return;
+    }
+
+    /* 没有流水线上的下一个请求时归还读缓冲区 */
+    http_request_reset(&(conn->rq));
+    http_request_release_buffer(&(conn->rq));
+    add_timer((void*)&(conn->rq), conn->rq.timeout, http_uring_timeout);
+
+    /* 发送期间可能已经收到下一个请求 */
+    http_uring_process(conn);
+
+    /* 对端已关闭，缓冲区中不再有完整的请求 */
+    if (conn->eof && !conn->sending) {
+        http_uring_close(conn);
+    }
+}
+
+/*
+ * 提交 multishot recv ，由内核从接收缓冲区环中挑选缓冲区。
+ * 成功返回 0 ，提交队列一直腾不出空间时返回 -1 。
+ */
+static int http_uring_arm_recv(http_uring_conn_t* conn) {
+    io_uring_sqe* sqe;
+
+    if ((sqe = uring_get_sqe(conn->uring)) == NULL) {
+        return -1;
+    }
+
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = conn->rq.fd;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = URING_BUF_GROUP;
+    sqe->user_data = (uintptr_t)conn | URING_OP_RECV;
+
+    conn->recving = 1;
+    conn->inflight ++ ;
+
+    return 0;
+}
+
+/*
+ * 关闭连接： shutdown 套接字使所有已提交的操作尽快完成，由 http_uring_release 释放。
+ */
+static void http_uring_close(http_uring_conn_t* conn) {
+    if (conn->closing) {
+        return;
+    }
+
+    conn->closing = 1;
+
+    if (conn->rq.timer.timer_set) {
+        delete_timer((void*)&(conn->rq));
+    }
+
+    shutdown(conn->rq.fd, SHUT_RDWR);
+}
+
+/*
+ * 连接正在关闭且没有未完成的操作时释放。
+ */
+static void http_uring_release(http_uring_conn_t* conn) {
+    if (!conn->closing || conn->inflight > 0) {
+        return;
+    }
+
+    detach_timer((void*)&(conn->rq));
+    close(conn->rq.fd);
+
+    http_uring_detach_send(conn);
+
+    if (conn->pipefd[0] >= 0) {
+        close(conn->pipefd[0]);
+        close(conn->pipefd[1]);
+    }
+
+    http_buffer_free(conn->rq.buffer);
+    pool_free(conn);
+
+    log_info("connection closed.");
+}
+
+/*
+ * 连接超时。连接可能还有未完成的操作，所以只 shutdown 套接字，
+ * 收到 recv 的完成事件后再关闭连接。
+ */
+static int http_uring_timeout(void* http_request) {
+    http_request_t* rq;
+
+    rq = (http_request_t*)http_request;
+
+    shutdown(rq->fd, SHUT_RDWR);
+
+    return 0;
+}
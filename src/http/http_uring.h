@@ -0,0 +1,82 @@
+/**
+ * @author ttoobne
+ * @date 2026/10/17
+ */
+
+#ifndef _HTTP_URING_H_
+#define _HTTP_URING_H_
+
+#include "config.h"
+#include "http.h"
+#include "http_request.h"
+#include "pool.h"
+#include "uring.h"
+
+#include <sys/uio.h>
+#include <sys/socket.h>
+
+/* 提交项的 user_data 为连接指针与操作类型的按位或，连接按 16 字节对齐，低 3 位存放操作类型 */
+#define URING_OP_ACCEPT     1           /* multishot accept */
+#define URING_OP_RECV       2           /* multishot recv ，数据存放在内核挑选的接收缓冲区中 */
+#define URING_OP_SEND       3           /* 发送内存中的响应头部与响应体 */
+#define URING_OP_SPLICE_IN  4           /* 文件 -> 管道 */
+#define URING_OP_SPLICE_OUT 5           /* 管道 -> 套接字 */
+#define URING_OP_MASK       7
+
+#define URING_PIPE_SIZE     65536       /* 管道的默认容量 */
+#define URING_PIPE_SIZE_MAX 1048576     /* 发送大文件时尝试扩大管道，减少每个文件需要的轮数 */
+#define URING_SEND_CACHE_MAX 256        /* 每个事件循环缓存的空闲响应块数 */
+#define URING_CHAIN_MAX     3           /* 一轮链式发送最多的操作数： sendmsg 、 splice in 、 splice out */
+
+/*
+ * 正在发送的响应及其发送状态，只在生成响应到发送完毕期间挂在连接上，空闲连接不占用这部分内存。
+ * 发送完毕后放回事件循环线程的缓存供之后的响应使用。
+ */
+typedef struct {
+    pool_node_t         node;           /* 缓存中的链接，必须是第一个成员 */
+    http_headers_out_t  out;            /* 分析首部字段的结果 */
+    http_response_t     response;       /* 正在发送的响应 */
+
+    size_t              mem_sent;       /* 已发送的头部与响应体字节数 */
+    int                 filefd;         /* 正在发送的文件，属于 response.file */
+    unsigned            part;           /* 多个区间时下一个要发送的部分 */
+    off_t               file_off;       /* 当前文件区间已读入管道的字节数 */
+    off_t               file_sent;      /* 已发送的文件字节数 */
+    struct iovec        iov[2];         /* 发送头部与响应体使用的 iovec */
+    struct msghdr       msg;
+} http_uring_send_t;
+
+/*
+ * io_uring 模式下的连接。
+ * 请求必须为第一个成员，定时器回调得到的请求指针即连接指针。
+ * 连接关闭时先 shutdown 套接字，等所有已提交的操作完成后才释放，避免完成事件引用已释放的内存。
+ */
+typedef struct {
+    http_request_t      rq;             /* 请求 */
+    uring_t*            uring;          /* 所属事件循环的 io_uring */
+    http_uring_send_t*  send;           /* 正在发送的响应，没有时为 NULL */
+
+    unsigned            inflight;       /* 已提交尚未完成的操作数 */
+    unsigned            pending;        /* 本轮链式发送中尚未完成的操作数 */
+    unsigned            closing:1;      /* 正在关闭，所有操作完成后释放 */
+    unsigned            recving:1;      /* multishot recv 仍然有效 */
+    unsigned            sending:1;      /* 正在发送响应，期间收到的数据只追加到缓冲区 */
+    unsigned            failed:1;       /* 本轮发送出错 */
+    unsigned            eof:1;          /* 对端已关闭写端，已收到的请求处理完毕后关闭连接 */
+
+    int                 pipefd[2];      /* splice 使用的管道，首次发送文件时创建 */
+    size_t              pipe_size;      /* 管道容量，即每轮经管道转发的最大文件字节数 */
+} http_uring_conn_t;
+
+/*
+ * 在监听描述符上提交 multishot accept ， listen_event 为监听描述符对应的 http_request_t 。
+ * 成功返回 0 ，否则返回 -1 。
+ */
+int http_uring_listen(uring_t* uring, http_request_t* listen_event);
+
+/*
+ * 处理一个完成事件。
+ */
+void http_uring_handle(uring_t* uring, io_uring_cqe* cqe, config_t* config);
+
+#endif /* _HTTP_URING_H_ */
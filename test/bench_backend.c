@@ -0,0 +1,196 @@
+/**
+ * @author ttoobne
+ * @date 2026/10/17
+ */
+
+/*
+ * 事件循环后端的对比测试：多个长连接反复请求同一个文件，统计每秒完成的请求数。
+ * 分别以 event_backend = epoll 与 event_backend = io_uring （ reactors 相同）启动 bohttpd ，
+ * 对同一端口各运行一次即可对比：
+ *
+ *   gcc -std=gnu99 -O2 -D_GNU_SOURCE test/bench_backend.c -lpthread -o bench_backend
+ *   ./bench_backend 127.0.0.1 80 /index.html 64 4 5
+ */
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#define RESP_SIZE   (1 << 20)       /* 每个连接接收响应的缓冲区大小 */
+#define MAX_CONNS   4096
+
+typedef struct {
+    int         fd;
+    char*       buf;                /* 已收到的响应 */
+    size_t      len;
+} bench_conn_t;
+
+typedef struct {
+    pthread_t   tid;
+    int         conns;              /* 该线程负责的连接数 */
+    long        done;               /* 完成的请求数 */
+    long        errors;             /* 出错的连接数 */
+} bench_thread_t;
+
+static struct sockaddr_in   servaddr;
+static char                 request[1024];
+static size_t               request_len;
+static volatile int         stop;
+
+/*
+ * 若 buf 中已有一个完整的响应则返回其长度，否则返回 0 。
+ */
+static size_t response_complete(char* buf, size_t len) {
+    char* end;
+    char* cl;
+    size_t head;
+
+    buf[len] = '\0';
+
+    if ((end = strstr(buf, "\r\n\r\n")) == NULL) {
+        return 0;
+    }
+
+    head = end - buf + 4;
+
+    if ((cl = strcasestr(buf, "Content-length:")) == NULL || cl > end) {
+        return head;
+    }
+
+    head += strtoul(cl + 15, NULL, 10);
+
+    return len >= head ? head : 0;
+}
+
+static int send_request(int fd) {
+    return write(fd, request, request_len) == (ssize_t)request_len ? 0 : -1;
+}
+
+static void* bench_worker(void* args) {
+    bench_thread_t* self = (bench_thread_t*)args;
+    bench_conn_t* conns;
+    struct epoll_event ev, events[256];
+    size_t n;
+    ssize_t size;
+    int epfd;
+    int one;
+    int i;
+    int k;
+
+    conns = calloc(self->conns, sizeof(bench_conn_t));
+    epfd = epoll_create1(0);
+    one = 1;
+
+    for (i = 0; i < self->conns; ++ i) {
+        conns[i].fd = socket(AF_INET, SOCK_STREAM, 0);
+        conns[i].buf = malloc(RESP_SIZE + 1);
+        setsockopt(conns[i].fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+        if (connect(conns[i].fd, (struct sockaddr*)&servaddr, sizeof(servaddr)) != 0) {
+            perror("connect");
+            exit(1);
+        }
+
+        ev.events = EPOLLIN;
+        ev.data.ptr = &conns[i];
+        epoll_ctl(epfd, EPOLL_CTL_ADD, conns[i].fd, &ev);
+        send_request(conns[i].fd);
+    }
+
+    while (!stop) {
+        if ((n = epoll_wait(epfd, events, 256, 100)) <= 0) {
+            continue;
+        }
+
+        for (k = 0; k < (int)n; ++ k) {
+            bench_conn_t* c = (bench_conn_t*)events[k].data.ptr;
+
+            if ((size = read(c->fd, c->buf + c->len, RESP_SIZE - c->len)) <= 0) {
+                self->errors ++ ;
+                epoll_ctl(epfd, EPOLL_CTL_DEL, c->fd, NULL);
+                continue;
+            }
+
+            c->len += size;
+
+            if (response_complete(c->buf, c->len) > 0) {
+                self->done ++ ;
+                c->len = 0;
+                send_request(c->fd);
+            }
+        }
+    }
+
+    for (i = 0; i < self->conns; ++ i) {
+        close(conns[i].fd);
+        free(conns[i].buf);
+    }
+
+    free(conns);
+    close(epfd);
+
+    return NULL;
+}
+
+int main(int argc, char* argv[]) {
+    bench_thread_t* threads;
+    int conns, nthreads, seconds;
+    long done, errors;
+    int i;
+
+    if (argc != 7) {
+        printf("Usage: %s <ip> <port> <path> <connections> <threads> <seconds>\n", argv[0]);
+        return 1;
+    }
+
+    memset(&servaddr, 0, sizeof(servaddr));
+    servaddr.sin_family = AF_INET;
+    servaddr.sin_addr.s_addr = inet_addr(argv[1]);
+    servaddr.sin_port = htons(atoi(argv[2]));
+
+    request_len = snprintf(request, sizeof(request),
+                           "GET %s HTTP/1.1\r\nHost: bench\r\nConnection: keep-alive\r\n\r\n", argv[3]);
+
+    conns = atoi(argv[4]);
+    nthreads = atoi(argv[5]);
+    seconds = atoi(argv[6]);
+
+    if (conns <= 0 || conns > MAX_CONNS || nthreads <= 0 || nthreads > conns || seconds <= 0) {
+        printf("arguments invalid.\n");
+        return 1;
+    }
+
+    threads = calloc(nthreads, sizeof(bench_thread_t));
+
+    for (i = 0; i < nthreads; ++ i) {
+        threads[i].conns = conns / nthreads + (i < conns % nthreads);
+        pthread_create(&threads[i].tid, NULL, bench_worker, &threads[i]);
+    }
+
+    sleep(seconds);
+    stop = 1;
+
+    done = 0;
+    errors = 0;
+    for (i = 0; i < nthreads; ++ i) {
+        pthread_join(threads[i].tid, NULL);
+        done += threads[i].done;
+        errors += threads[i].errors;
+    }
+
+    printf("%s connections: %d requests: %ld errors: %ld throughput: %.0f req/s\n",
+           argv[3], conns, done, errors, (double)done / seconds);
+
+    free(threads);
+
+    return 0;
+}
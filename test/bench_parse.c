@@ -0,0 +1,278 @@
+/**
+ * @author ttoobne
+ * @date 2026/10/17
+ */
+
+/*
+ * 请求解析器的吞吐量测试：反复解析一组常见浏览器发出的请求头部，分别使用逐字节、 SSE4.2 与 AVX2 扫描。
+ * 开始前先检查已知首部字段的编号，以及各实现对完整读入与任意切分读入的解析结果一致：
+ *
+ *   gcc -std=gnu99 -O2 -D_GNU_SOURCE -I src/core -I src/http test/bench_parse.c \
+ *       src/http/http_header.c src/http/http_parse.c src/http/http_scan.c -o bench_parse
+ *   ./bench_parse 200000
+ */
+
+#include "debug.h"
+#include "http_header.h"
+#include "http_parse.h"
+#include "http_request.h"
+#include "http_scan.h"
+
+#include <ctype.h>
+#include <time.h>
+
+static const char* corpus[] = {
+    /* Chrome 桌面版 */
+    "GET /index.html HTTP/1.1\r\n"
+    "Host: www.example.com\r\n"
+    "Connection: keep-alive\r\n"
+    "Cache-Control: max-age=0\r\n"
+    "sec-ch-ua: \"Chromium\";v=\"124\", \"Google Chrome\";v=\"124\", \"Not-A.Brand\";v=\"99\"\r\n"
+    "sec-ch-ua-mobile: ?0\r\n"
+    "sec-ch-ua-platform: \"Windows\"\r\n"
+    "Upgrade-Insecure-Requests: 1\r\n"
+    "User-Agent: Mozilla/5.0 (Windows NT 10.0; Win64; x64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/124.0.0.0 Safari/537.36\r\n"
+    "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,image/avif,image/webp,image/apng,*/*;q=0.8,application/signed-exchange;v=b3;q=0.7\r\n"
+    "Sec-Fetch-Site: none\r\n"
+    "Sec-Fetch-Mode: navigate\r\n"
+    "Sec-Fetch-User: ?1\r\n"
+    "Sec-Fetch-Dest: document\r\n"
+    "Accept-Encoding: gzip, deflate, br, zstd\r\n"
+    "Accept-Language: zh-CN,zh;q=0.9,en;q=0.8\r\n"
+    "Cookie: _ga=GA1.2.1234567890.1700000000; _gid=GA1.2.987654321.1700000000; session=3f2a9c1e7b4d4e8f9a0b1c2d3e4f5a6b; theme=dark\r\n"
+    "If-None-Match: \"5ed21299-1c6e\"\r\n"
+    "If-Modified-Since: Sat, 30 May 2020 08:00:25 GMT\r\n"
+    "\r\n",
+
+    /* Firefox 请求样式表 */
+    "GET /static/css/main.3f9a1c.css HTTP/1.1\r\n"
+    "Host: www.example.com\r\n"
+    "User-Agent: Mozilla/5.0 (X11; Linux x86_64; rv:125.0) Gecko/20100101 Firefox/125.0\r\n"
+    "Accept: text/css,*/*;q=0.1\r\n"
+    "Accept-Language: en-US,en;q=0.5\r\n"
+    "Accept-Encoding: gzip, deflate, br\r\n"
+    "Referer: https://www.example.com/index.html\r\n"
+    "Connection: keep-alive\r\n"
+    "Sec-Fetch-Dest: style\r\n"
+    "Sec-Fetch-Mode: no-cors\r\n"
+    "Sec-Fetch-Site: same-origin\r\n"
+    "Pragma: no-cache\r\n"
+    "Cache-Control: no-cache\r\n"
+    "\r\n",
+
+    /* Safari 移动版请求图片 */
+    "GET /images/banner-1920x1080.webp?v=20240501 HTTP/1.1\r\n"
+    "Host: cdn.example.com\r\n"
+    "Accept: image/webp,image/avif,image/jxl,image/heic,image/heic-sequence,video/*;q=0.8,image/png,image/svg+xml,image/*;q=0.8,*/*;q=0.5\r\n"
+    "Accept-Encoding: gzip, deflate, br\r\n"
+    "Accept-Language: ja-JP,ja;q=0.9\r\n"
+    "Connection: keep-alive\r\n"
+    "Referer: https://www.example.com/\r\n"
+    "User-Agent: Mozilla/5.0 (iPhone; CPU iPhone OS 17_4 like Mac OS X) AppleWebKit/605.1.15 (KHTML, like Gecko) Version/17.4 Mobile/15E148 Safari/604.1\r\n"
+    "\r\n",
+
+    /* 带长 Cookie 的 XHR */
+    "POST /api/v1/events HTTP/1.1\r\n"
+    "Host: api.example.com\r\n"
+    "Connection: keep-alive\r\n"
+    "Content-Length: 0\r\n"
+    "Accept: application/json, text/plain, */*\r\n"
+    "X-Requested-With: XMLHttpRequest\r\n"
+    "User-Agent: Mozilla/5.0 (Macintosh; Intel Mac OS X 10_15_7) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/124.0.0.0 Safari/537.36\r\n"
+    "Origin: https://www.example.com\r\n"
+    "Referer: https://www.example.com/dashboard?tab=overview&range=7d\r\n"
+    "Accept-Encoding: gzip, deflate, br\r\n"
+    "Accept-Language: en-GB,en-US;q=0.9,en;q=0.8\r\n"
+    "Cookie: csrftoken=Zq8XkJ3mP0aLw9sVb2nR7tYc4uE1oI6h; sessionid=7r4n3b8c0d2e6f1a9g5h3j7k2l4m8n0p; "
+    "_ga=GA1.1.1122334455.1710000000; _ga_ABCDEF1234=GS1.1.1710000000.3.1.1710000600.0.0.0; "
+    "prefs=%7B%22lang%22%3A%22en%22%2C%22tz%22%3A%22Europe%2FLondon%22%7D\r\n"
+    "\r\n",
+
+    /* 命令行工具 */
+    "GET / HTTP/1.1\r\n"
+    "Host: localhost\r\n"
+    "User-Agent: curl/8.5.0\r\n"
+    "Accept: */*\r\n"
+    "\r\n",
+
+    /* HTTP/1.0 压测工具 */
+    "GET /index.html HTTP/1.0\r\n"
+    "Host: 127.0.0.1\r\n"
+    "User-Agent: ApacheBench/2.3\r\n"
+    "Accept: */*\r\n"
+    "\r\n"
+};
+
+#define CORPUS_NUM  (sizeof(corpus) / sizeof(corpus[0]))
+
+/*
+ * 从 buf 开始按每次 step 字节读入的方式解析一个请求， step 为 0 时一次读入全部。
+ * 返回解析出的首部字段数，出错返回 -1 。
+ */
+static int parse(http_request_t* rq, unsigned char* buf, size_t len, size_t step) {
+    int (*handler)(void*);
+    int ret;
+
+    rq->state = 0;
+    rq->have_args = 0;
+    rq->headers_num = 0;
+
+    rq->buf = buf;
+    rq->bufst = buf;
+    rq->bufed = buf;
+    handler = http_parse_request_line;
+
+    for (;;) {
+        rq->bufed = step == 0 || (size_t)(buf + len - rq->bufed) < step ? buf + len : rq->bufed + step;
+
+        while ((ret = handler(rq)) == REQUEST_OK && handler == http_parse_request_line) {
+            handler = http_parse_request_headers;
+        }
+
+        if (ret == REQUEST_OK) {
+            break;
+        }
+
+        if (ret != REQUEST_AGAIN || rq->bufed == buf + len) {
+            return -1;
+        }
+    }
+
+    return rq->headers_num;
+}
+
+/*
+ * 把解析结果写成文本，用来比较不同实现与不同切分方式的结果。
+ */
+static int dump(http_request_t* rq, char* out) {
+    http_header_t* pos;
+    unsigned i;
+    int len;
+
+    len = sprintf(out, "%d|%.*s|%d|%d.%d\n", rq->method,
+                  (int)((char*)rq->uri_end - (char*)rq->uri_start + 1), (char*)rq->uri_start,
+                  rq->have_args, rq->http_version_major, rq->http_version_minor);
+
+    for (i = 0; i < rq->headers_num; ++ i) {
+        pos = http_request_header(rq, i);
+        len += sprintf(out + len, "%u[%.*s]=[%.*s]\n", pos->id,
+                       (int)((char*)pos->header_name_end - (char*)pos->header_name_start + 1), (char*)pos->header_name_start,
+                       (int)((char*)pos->header_value_end - (char*)pos->header_value_start + 1), (char*)pos->header_value_start);
+    }
+
+    return len;
+}
+
+static double now() {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(int argc, char* argv[]) {
+    static char expect[CORPUS_NUM][8192];
+    static char got[8192];
+    static unsigned char buf[CORPUS_NUM][8192];
+    http_request_t rq;
+    size_t len[CORPUS_NUM];
+    size_t total;
+    size_t step;
+    double start;
+    double cost;
+    long iters;
+    long i;
+    int level;
+    int impl;
+    int c;
+
+    iters = argc > 1 ? atol(argv[1]) : 100000;
+    total = 0;
+
+    memset(&rq, 0, sizeof(http_request_t));
+
+    /* 已知首部字段不区分大小写地查出编号，前缀与改动一个字符的字段名查不出 */
+    for (c = 1; c < HTTP_HEADER_NUM; ++ c) {
+        step = strlen(http_header_names[c]);
+        strcpy(got, http_header_names[c]);
+        ASSERT(http_header_id((unsigned char*)got, step) == c, "header id mismatch.");
+
+        for (i = 0; i < step; ++ i) {
+            got[i] = tolower(got[i]);
+        }
+
+        ASSERT(http_header_id((unsigned char*)got, step) == c, "lower case header id mismatch.");
+
+        for (i = 0; i < step; ++ i) {
+            got[i] = toupper(got[i]);
+        }
+
+        ASSERT(http_header_id((unsigned char*)got, step) == c, "upper case header id mismatch.");
+        ASSERT(http_header_id((unsigned char*)got, step - 1) == HTTP_HEADER_UNKNOWN, "header prefix matched.");
+
+        got[step - 1] = '_';
+        ASSERT(http_header_id((unsigned char*)got, step) == HTTP_HEADER_UNKNOWN, "unknown header matched.");
+    }
+
+    for (c = 0; c < CORPUS_NUM; ++ c) {
+        len[c] = strlen(corpus[c]);
+        memcpy(buf[c], corpus[c], len[c]);
+        total += len[c];
+
+        http_scan_init(HTTP_SCAN_SCALAR);
+        ASSERT(parse(&rq, buf[c], len[c], 0) > 0, "scalar parse failed.");
+        dump(&rq, expect[c]);
+    }
+
+    /* 各实现的结果与逐字节扫描一致，切分读入不影响结果 */
+    for (level = HTTP_SCAN_SCALAR; level <= HTTP_SCAN_AVX2; ++ level) {
+        if ((impl = http_scan_init(level)) != level) {
+            continue;
+        }
+
+        for (c = 0; c < CORPUS_NUM; ++ c) {
+            for (step = 0; step <= 64; ++ step) {
+                ASSERT(parse(&rq, buf[c], len[c], step) > 0, "parse failed.");
+                dump(&rq, got);
+
+                if (strcmp(got, expect[c]) != 0) {
+                    printf("%s mismatch on request %d, step %zu:\n%s\nexpect:\n%s\n",
+                           http_scan_name(impl), c, step, got, expect[c]);
+                    return 1;
+                }
+            }
+        }
+    }
+
+    printf("corpus: %d requests, %zu bytes\n", (int)CORPUS_NUM, total);
+
+    for (level = HTTP_SCAN_SCALAR; level <= HTTP_SCAN_AVX2; ++ level) {
+        if ((impl = http_scan_init(level)) != level) {
+            printf("%-8s not supported\n", http_scan_name(level));
+            continue;
+        }
+
+        /* 预热，避免先测的实现吃亏 */
+        for (i = 0; i < iters / 10; ++ i) {
+            for (c = 0; c < CORPUS_NUM; ++ c) {
+                parse(&rq, buf[c], len[c], 0);
+            }
+        }
+
+        start = now();
+
+        for (i = 0; i < iters; ++ i) {
+            for (c = 0; c < CORPUS_NUM; ++ c) {
+                parse(&rq, buf[c], len[c], 0);
+            }
+        }
+
+        cost = now() - start;
+
+        printf("%-8s %8.1f MB/s %10.0f req/s\n", http_scan_name(impl),
+               total * iters / cost / 1e6, CORPUS_NUM * iters / cost);
+    }
+
+    return 0;
+}
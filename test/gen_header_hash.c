@@ -0,0 +1,93 @@
+/**
+ * @author ttoobne
+ * @date 2026/10/17
+ */
+
+/*
+ * 生成 src/http/http_header_hash.h ：用固定种子的伪随机数寻找使 HTTP_HEADERS 中所有字段名落在不同槽中的奇数乘数，
+ * 输出乘数与槽到首部字段编号的表，同样的字段名每次生成的结果相同。修改 src/http/http_header.h 中的 HTTP_HEADERS 后重新生成：
+ *
+ *   gcc -std=gnu99 -O2 -I src/http test/gen_header_hash.c -o gen_header_hash
+ *   ./gen_header_hash > src/http/http_header_hash.h
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#define HTTP_HEADER_HASH_MUL    mul     /* 由下面的搜索决定 */
+
+#include "http_header.h"
+
+#define HTTP_HEADER_GEN(id, name)   { #id, name },
+
+static const struct {
+    const char*     id;
+    const char*     name;
+} headers[] = {
+    HTTP_HEADERS(HTTP_HEADER_GEN)
+};
+
+#define HEADERS_NUM (sizeof(headers) / sizeof(headers[0]))
+
+#define SEARCH_MAX  (1 << 24)           /* 最多尝试的乘数个数 */
+
+static uint64_t mul;
+
+static unsigned slot_of(const char* name) {
+    return http_header_hash_slot(http_header_hash_key((const unsigned char*)name, strlen(name)));
+}
+
+int main() {
+    int slots[HTTP_HEADER_HASH_SIZE];
+    uint64_t x;
+    unsigned s;
+    long tries;
+    int i;
+
+    x = 88172645463325252ull;
+
+    for (tries = 0; tries < SEARCH_MAX; ++ tries) {
+        /* xorshift64 */
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        mul = x | 1;
+
+        memset(slots, -1, sizeof(slots));
+
+        for (i = 0; i < HEADERS_NUM; ++ i) {
+            if (slots[s = slot_of(headers[i].name)] >= 0) {
+                break;
+            }
+
+            slots[s] = i;
+        }
+
+        if (i == HEADERS_NUM) {
+            break;
+        }
+    }
+
+    if (tries == SEARCH_MAX) {
+        fprintf(stderr, "no perfect hash for %d headers, enlarge HTTP_HEADER_HASH_BITS.\n", (int)HEADERS_NUM);
+        return 1;
+    }
+
+    printf("/**\n * @author ttoobne\n * @date 2026/10/17\n */\n\n");
+    printf("/* 由 test/gen_header_hash.c 生成，不要手动修改。 */\n\n");
+    printf("#ifndef _HTTP_HEADER_HASH_H_\n#define _HTTP_HEADER_HASH_H_\n\n");
+    printf("#include \"http_header.h\"\n\n");
+    printf("#define HTTP_HEADER_HASH_MUL    0x%016llxull\n\n", (unsigned long long)mul);
+    printf("/* 槽到首部字段编号，空槽为 HTTP_HEADER_UNKNOWN */\n");
+    printf("static const unsigned char http_header_slots[HTTP_HEADER_HASH_SIZE] = {\n");
+
+    for (s = 0; s < HTTP_HEADER_HASH_SIZE; ++ s) {
+        if (slots[s] >= 0) {
+            printf("    [%3u] = HTTP_HEADER_%s,\n", s, headers[slots[s]].id);
+        }
+    }
+
+    printf("};\n\n#endif /* _HTTP_HEADER_HASH_H_ */\n");
+
+    return 0;
+}
@@ -0,0 +1,114 @@
+/**
+ * @author ttoobne
+ * @date 2026/10/17
+ */
+
+#include "coroutine.h"
+#include "debug.h"
+
+#include <pthread.h>
+#include <stdio.h>
+
+#define CO_NUM      1000
+#define YIELD_NUM   10
+
+typedef struct {
+    coroutine_t*    co;
+    int             count;
+} counter_t;
+
+static void count_up(void* arg) {
+    counter_t* c;
+    char buf[4096];     /* 使用一部分栈 */
+    int i;
+
+    c = (counter_t*)arg;
+
+    for (i = 0; i < YIELD_NUM; ++ i) {
+        buf[i] = (char)i;
+        c->count += buf[i] + 1 - i;
+        coroutine_yield(c->co);
+    }
+}
+
+static void* free_co(void* arg) {
+    coroutine_free((coroutine_t*)arg);
+
+    return NULL;
+}
+
+static void* resume_once(void* arg) {
+    counter_t* c;
+
+    c = (counter_t*)arg;
+    coroutine_resume(c->co);
+
+    return NULL;
+}
+
+int main() {
+    static counter_t counters[CO_NUM];
+    pthread_t tid;
+    int i;
+    int k;
+
+    coroutine_init(16 * 1024);
+
+    /* 大量协程交替执行 */
+    for (i = 0; i < CO_NUM; ++ i) {
+        counters[i].co = coroutine_create(count_up, &counters[i]);
+        ASSERT(counters[i].co != NULL, "create coroutine failed.");
+    }
+
+    for (k = 0; k <= YIELD_NUM; ++ k) {
+        for (i = 0; i < CO_NUM; ++ i) {
+            ASSERT(coroutine_resume(counters[i].co) == (k < YIELD_NUM ? COROUTINE_SUSPENDED : COROUTINE_DEAD),
+                   "unexpected state.");
+            ASSERT(counters[i].count == (k < YIELD_NUM ? k + 1 : YIELD_NUM), "count error.");
+        }
+    }
+
+    for (i = 0; i < CO_NUM; ++ i) {
+        coroutine_free(counters[i].co);
+    }
+
+    /* 在不同的线程上恢复同一个协程，栈来自缓存 */
+    counters[0].count = 0;
+    counters[0].co = coroutine_create(count_up, &counters[0]);
+    ASSERT(counters[0].co != NULL, "create coroutine failed.");
+
+    for (k = 0; k < YIELD_NUM; ++ k) {
+        pthread_create(&tid, NULL, resume_once, &counters[0]);
+        pthread_join(tid, NULL);
+    }
+
+    ASSERT(counters[0].count == YIELD_NUM, "count error.");
+    ASSERT(coroutine_resume(counters[0].co) == COROUTINE_DEAD, "unexpected state.");
+
+    coroutine_free(counters[0].co);
+
+    /* 有自己的缓存的线程创建的协程在其他线程销毁，栈经远程空闲链表回到创建它的线程 */
+    ASSERT(coroutine_init_local() == 0, "init local cache failed.");
+
+    counters[0].co = coroutine_create(count_up, &counters[0]);
+    ASSERT(counters[0].co != NULL, "create coroutine failed.");
+    counters[1].co = counters[0].co;
+
+    pthread_create(&tid, NULL, free_co, counters[0].co);
+    pthread_join(tid, NULL);
+
+    counters[0].co = coroutine_create(count_up, &counters[0]);
+    ASSERT(counters[0].co == counters[1].co, "stack is not reused.");
+
+    counters[0].count = 0;
+    for (k = 0; k <= YIELD_NUM; ++ k) {
+        coroutine_resume(counters[0].co);
+    }
+    ASSERT(counters[0].count == YIELD_NUM, "count error.");
+
+    coroutine_free(counters[0].co);
+
+    DBG("debug done.\n");
+
+    return 0;
+}
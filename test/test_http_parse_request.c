@@ -6,91 +6,113 @@
 #include "debug.h"
 #include "http_parse.h"
 #include "http_request.h"
-#include "list.h"
 
+#include <string.h>
 #include <time.h>
 
-void print_info(char* pr, char* st, char* ed) {
-    printf("%s\n%.*s\n\n", pr, ed - st + 1, st);
+static const char request[] =
+    "GET /index.html HTTP/1.1\r\n"
+    "Host: ttoobne.com\r\n"
+    "Connection: keep-alive\r\n"
+    "Cache-Control: max-age=0\r\n"
+    "Upgrade-Insecure-Requests: 1\r\n"
+    "User-Agent: Mozilla/5.0 (Linux; Android 6.0; Nexus 5 Build/MRA58N) AppleWebKit/537.36 (KHTML, like Gecko) "
+    "Chrome/83.0.4103.116 Mobile Safari/537.36\r\n"
+    "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,image/webp,image/apng,*/*;q=0.8,"
+    "application/signed-exchange;v=b3;q=0.9\r\n"
+    "Accept-Encoding: gzip, deflate\r\n"
+    "Accept-Language: zh-CN,zh;q=0.9\r\n"
+    "If-None-Match: \"5ed21299-1c6e\"\r\n"
+    "If-Modified-Since: Sat, 30 May 2020 08:00:25 GMT\r\n"
+    "\r\n";
+
+static const char* headers[][2] = {
+    {"Host", "ttoobne.com"},
+    {"Connection", "keep-alive"},
+    {"Cache-Control", "max-age=0"},
+    {"Upgrade-Insecure-Requests", "1"},
+    {"User-Agent", "Mozilla/5.0 (Linux; Android 6.0; Nexus 5 Build/MRA58N) AppleWebKit/537.36 (KHTML, like Gecko) "
+                   "Chrome/83.0.4103.116 Mobile Safari/537.36"},
+    {"Accept", "text/html,application/xhtml+xml,application/xml;q=0.9,image/webp,image/apng,*/*;q=0.8,"
+               "application/signed-exchange;v=b3;q=0.9"},
+    {"Accept-Encoding", "gzip, deflate"},
+    {"Accept-Language", "zh-CN,zh;q=0.9"},
+    {"If-None-Match", "\"5ed21299-1c6e\""},
+    {"If-Modified-Since", "Sat, 30 May 2020 08:00:25 GMT"},
+};
+
+static int slice_is(void* st, void* ed, const char* s) {
+    return (size_t)((char*)ed - (char*)st + 1) == strlen(s) && memcmp(st, s, strlen(s)) == 0;
 }
 
-int main() {
-    http_request_t* rq;
-    http_header_t* pos;
-    list_head_t* head;
-    list_head_t* now;
-    list_head_t* next;
+/*
+ * 每次向读缓冲区追加 step 字节并解析，直到解析出完整的请求，检查解析结果。
+ */
+static void parse(http_request_t* rq, size_t step) {
     http_headers_out_t* out;
+    http_header_t* h;
     struct tm time;
-    time_t mtime;
-    int len;
+    size_t pos;
+    size_t n;
+    unsigned i;
     int ret;
 
-    if ((rq = http_request_init(0, 1)) == NULL) {
-        ERROR("http_request_init failed.");
-        return 1;
-    }
+    ASSERT(http_request_attach_buffer(rq) == 0, "attach buffer failed.");
 
-    if ((out = http_headers_out_init(0)) == NULL) {
-        ERROR("http_headers_out_init failed.");
-        return 1;
-    }
+    for (pos = 0, ret = REQUEST_AGAIN; ret == REQUEST_AGAIN; pos += n) {
+        ASSERT(pos < sizeof(request) - 1, "request not complete.");
 
-    sprintf(rq->buf, "GET /index.html HTTP/1.1\r\n");
-    sprintf(rq->buf, "%sHost: ttoobne.com\r\n", rq->buf);
-    sprintf(rq->buf, "%sConnection: keep-alive\r\n", rq->buf);
-    sprintf(rq->buf, "%sCache-Control: max-age=0\r\n", rq->buf);
-    sprintf(rq->buf, "%sUpgrade-Insecure-Requests: 1\r\n", rq->buf);
-    sprintf(rq->buf, "%sUser-Agent: Mozilla/5.0 (Linux; Android 6.0; Nexus 5 Build/MRA58N) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/83.0.4103.116 Mobile Safari/537.36\r\n", rq->buf);
-    sprintf(rq->buf, "%sAccept: text/html,application/xhtml+xml,application/xml;q=0.9,image/webp,image/apng,*/*;q=0.8,application/signed-exchange;v=b3;q=0.9\r\n", rq->buf);
-    sprintf(rq->buf, "%sAccept-Encoding: gzip, deflate\r\n", rq->buf);
-    sprintf(rq->buf, "%sAccept-Language: zh-CN,zh;q=0.9\r\n", rq->buf);
-    sprintf(rq->buf, "%sIf-None-Match: \"5ed21299-1c6e\"\r\n", rq->buf);
-    len = sprintf(rq->buf, "%sIf-Modified-Since: Sat, 30 May 2020 08:00:25 GMT\r\n\r\n", rq->buf);
-
-    //DBG("%s", rq->buf);
-
-    rq->bufed += len;
-
-    //DBG("bufst: %d\n", rq->bufst);
-    //DBG("bufed: %d\n", rq->bufed);
-    //DBG("bufend if end = '\\n': %d\n", rq->buf[rq->bufed - 1] == '\n');
-
-    //DBG("before while\n");
-
-    while((ret = rq->handler(rq)) != REQUEST_OK) {
-        if (ret != REQUEST_AGAIN) {
-            DBG("error return value: %d\n", ret);
-            DBG("state: %d\n", rq->state);
-            return 1;
-        }
+        n = sizeof(request) - 1 - pos < step ? sizeof(request) - 1 - pos : step;
+        memcpy(rq->bufed, request + pos, n);
+        rq->bufed += n;
+
+        ret = rq->handler(rq);
     }
 
-    //DBG("after while\n");
-    print_info("whole request line:", rq->request_start, rq->request_end);
-    print_info("method:", rq->method_start, rq->method_end);
-    print_info("uri:", rq->uri_start, rq->uri_end);
-    printf("version:\nHTTP/%d.%d\n\n", rq->http_version_major, rq->http_version_minor);
+    ASSERT(ret == REQUEST_OK, "parse error.");
+    ASSERT(pos == sizeof(request) - 1, "request parsed too early.");
 
-    head = &(rq->headers_list_head);
+    ASSERT(rq->method == HTTP_GET && slice_is(rq->method_start, rq->method_end, "GET"), "method error.");
+    ASSERT(slice_is(rq->uri_start, rq->uri_end, "/index.html"), "uri error.");
+    ASSERT(rq->http_version_major == 1 && rq->http_version_minor == 1, "version error.");
+    ASSERT(rq->headers_num == sizeof(headers) / sizeof(headers[0]), "header number error.");
 
-    list_for_each_entry(pos, head, list_node) {
-        print_info("name:", pos->header_name_start, pos->header_name_end);
-        print_info("value:", pos->header_value_start, pos->header_value_end);
+    for (i = 0; i < rq->headers_num; ++ i) {
+        h = http_request_header(rq, i);
+        ASSERT(slice_is(h->header_name_start, h->header_name_end, headers[i][0]), "header name error.");
+        ASSERT(slice_is(h->header_value_start, h->header_value_end, headers[i][1]), "header value error.");
     }
 
+    /* 文件在 If-Modified-Since 之后修改过，返回 200 */
+    ASSERT((out = http_headers_out_init()) != NULL, "http_headers_out_init failed.");
+
+    memset(&time, 0, sizeof(time));
     strptime("Sat, 30 May 2020 08:00:30 GMT", "%a, %d %b %Y %H:%M:%S GMT", &time);
-    mtime = mktime(&time);
-    out->mtime = mtime;
+    out->mtime = mktime(&time);
+
+    ASSERT(http_analyze_headers(rq, out) == 0, "analyze headers failed.");
+    ASSERT(out->keep_alive == 1, "keep_alive error.");
+    ASSERT(out->if_modified == 1, "if_modified error.");
+    ASSERT(out->if_unmodified == 0, "if_unmodified error.");
+
+    http_headers_out_destroy(out);
+
+    http_request_reset(rq);
+    http_request_release_buffer(rq);
+}
 
-    http_analyze_headers(rq, out);
+int main() {
+    http_request_t* rq;
 
-    printf("out: keep_alive: %d\n", out->keep_alive);
-    printf("out: if_modified: %d\n", out->if_modified);
-    printf("out: if_unmodified: %d\n", out->if_unmodified);
+    ASSERT((rq = http_request_init(-1, NULL, NULL)) != NULL, "http_request_init failed.");
+
+    /* 一次读入整个请求，以及逐字节读入 */
+    parse(rq, sizeof(request));
+    parse(rq, 1);
 
     http_request_destroy(rq);
-    http_headers_out_destroy(out);
+
+    DBG("debug done.\n");
 
     return 0;
-}
\ No newline at end of file
+}
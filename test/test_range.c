@@ -0,0 +1,133 @@
+/**
+ * @author ttoobne
+ * @date 2026/10/17
+ */
+
+#include "debug.h"
+#include "http.h"
+#include "http_range.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define SIZE        1000        /* 文件长度 */
+
+static off_t    first[HTTP_RANGES_MAX];
+static off_t    last[HTTP_RANGES_MAX];
+static unsigned num;
+
+static unsigned parse(const char* value, off_t size) {
+    num = 0;
+
+    return http_range_parse(value, value + strlen(value) - 1, size, first, last, &num);
+}
+
+static int part_is(http_response_t* resp, unsigned i, const char* head) {
+    http_part_t* part;
+
+    part = &(resp->parts[i]);
+
+    return part->head_len == strlen(head) && memcmp(resp->page + part->head_off, head, part->head_len) == 0;
+}
+
+int main() {
+    static http_response_t resp;
+    char value[HTTP_RANGES_MAX * 8 + 16];
+    off_t length;
+    int i;
+
+    /* 普通区间与开放的结尾，结尾超过文件末尾时截到最后一个字节 */
+    ASSERT(parse("bytes=0-99", SIZE) == HTTP_PARTIAL_CONTENT, "status error.");
+    ASSERT(num == 1 && first[0] == 0 && last[0] == 99, "range error.");
+
+    ASSERT(parse("bytes=500-", SIZE) == HTTP_PARTIAL_CONTENT, "status error.");
+    ASSERT(num == 1 && first[0] == 500 && last[0] == SIZE - 1, "open end error.");
+
+    ASSERT(parse("bytes=990-5000", SIZE) == HTTP_PARTIAL_CONTENT, "status error.");
+    ASSERT(num == 1 && first[0] == 990 && last[0] == SIZE - 1, "end clamp error.");
+
+    ASSERT(parse("BYTES = 1-2", SIZE) == HTTP_OK, "malformed unit accepted.");
+    ASSERT(parse("Bytes=1-2", SIZE) == HTTP_PARTIAL_CONTENT, "unit is case sensitive.");
+
+    /* 后缀区间：最后 n 字节，超过文件长度时为整个文件 */
+    ASSERT(parse("bytes=-100", SIZE) == HTTP_PARTIAL_CONTENT, "status error.");
+    ASSERT(num == 1 && first[0] == 900 && last[0] == SIZE - 1, "suffix error.");
+
+    ASSERT(parse("bytes=-5000", SIZE) == HTTP_PARTIAL_CONTENT, "status error.");
+    ASSERT(num == 1 && first[0] == 0 && last[0] == SIZE - 1, "long suffix error.");
+
+    /* 超长的数字按文件长度处理，不会溢出成负数 */
+    ASSERT(parse("bytes=0-99999999999999999999999999999999", SIZE) == HTTP_PARTIAL_CONTENT, "status error.");
+    ASSERT(num == 1 && first[0] == 0 && last[0] == SIZE - 1, "overflow end error.");
+
+    ASSERT(parse("bytes=-99999999999999999999999999999999", SIZE) == HTTP_PARTIAL_CONTENT, "status error.");
+    ASSERT(num == 1 && first[0] == 0 && last[0] == SIZE - 1, "overflow suffix error.");
+
+    ASSERT(parse("bytes=99999999999999999999999999999999-", SIZE) == HTTP_RANGE_NOT_SATISFIABLE,
+           "overflow start error.");
+
+    /* 区间都从文件末尾之后开始时为 416 ，格式错误时忽略 Range 发送整个文件 */
+    ASSERT(parse("bytes=1000-", SIZE) == HTTP_RANGE_NOT_SATISFIABLE, "unsatisfiable error.");
+    ASSERT(parse("bytes=-0", SIZE) == HTTP_RANGE_NOT_SATISFIABLE, "empty suffix error.");
+    ASSERT(parse("bytes=0-", 0) == HTTP_RANGE_NOT_SATISFIABLE, "empty file error.");
+    ASSERT(parse("bytes=2000-3000, 0-9", SIZE) == HTTP_PARTIAL_CONTENT, "status error.");
+    ASSERT(num == 1 && first[0] == 0 && last[0] == 9, "unsatisfiable range not skipped.");
+
+    ASSERT(parse("bytes=", SIZE) == HTTP_OK, "empty set error.");
+    ASSERT(parse("bytes=-", SIZE) == HTTP_OK, "empty range error.");
+    ASSERT(parse("bytes=5-3", SIZE) == HTTP_OK, "reversed range error.");
+    ASSERT(parse("bytes=1-2x", SIZE) == HTTP_OK, "trailing garbage error.");
+    ASSERT(parse("bytes=a-b", SIZE) == HTTP_OK, "non-digit error.");
+    ASSERT(parse("items=0-1", SIZE) == HTTP_OK, "unit error.");
+    ASSERT(parse("bytes=2000-3000, 5-3", SIZE) == HTTP_OK, "malformed after unsatisfiable error.");
+
+    /* 总长度超过文件长度时忽略 Range ，重叠的区间不能成倍放大响应 */
+    ASSERT(parse("bytes=0-499, 500-999", SIZE) == HTTP_PARTIAL_CONTENT, "status error.");
+    ASSERT(num == 2 && first[1] == 500 && last[1] == SIZE - 1, "range list error.");
+
+    ASSERT(parse("bytes=0-499, 499-999", SIZE) == HTTP_OK, "amplification accepted.");
+    ASSERT(parse("bytes=0-, 0-", SIZE) == HTTP_OK, "amplification accepted.");
+    ASSERT(parse("bytes=-600,-600", SIZE) == HTTP_OK, "amplification accepted.");
+
+    /* 最多 HTTP_RANGES_MAX 个区间 */
+    strcpy(value, "bytes=");
+    for (i = 0; i < HTTP_RANGES_MAX; ++ i) {
+        sprintf(value + strlen(value), "%s%d-%d", i ? "," : "", i * 2, i * 2);
+    }
+
+    ASSERT(parse(value, SIZE) == HTTP_PARTIAL_CONTENT, "status error.");
+    ASSERT(num == HTTP_RANGES_MAX && first[HTTP_RANGES_MAX - 1] == (HTTP_RANGES_MAX - 1) * 2, "range list error.");
+
+    sprintf(value + strlen(value), ",%d-%d", HTTP_RANGES_MAX * 2, HTTP_RANGES_MAX * 2);
+    ASSERT(parse(value, SIZE) == HTTP_OK, "too many ranges accepted.");
+
+    /* 多个区间的分隔行与部分头部，最后一部分为结束分隔行 */
+    ASSERT(parse("bytes=0-9,-20", SIZE) == HTTP_PARTIAL_CONTENT, "status error.");
+
+    length = http_range_multipart(&resp, "0123", "text/plain", SIZE, first, last, num);
+
+    ASSERT(resp.part_num == 3, "part number error.");
+    ASSERT(part_is(&resp, 0, "\r\n--0123\r\nContent-type: text/plain\r\nContent-Range: bytes 0-9/1000\r\n\r\n"),
+           "first part head error.");
+    ASSERT(part_is(&resp, 1, "\r\n--0123\r\nContent-type: text/plain\r\nContent-Range: bytes 980-999/1000\r\n\r\n"),
+           "second part head error.");
+    ASSERT(part_is(&resp, 2, "\r\n--0123--\r\n"), "closing delimiter error.");
+    ASSERT(resp.parts[0].file_off == 0 && resp.parts[0].file_len == 10, "first part range error.");
+    ASSERT(resp.parts[1].file_off == 980 && resp.parts[1].file_len == 20, "second part range error.");
+    ASSERT(resp.parts[2].file_len == 0, "closing delimiter has a range.");
+    ASSERT(length == (off_t)(resp.parts[0].head_len + resp.parts[1].head_len + resp.parts[2].head_len) + 30,
+           "body length error.");
+
+    /* 416 响应的 Content-Range 用星号代替区间 */
+    strcpy(resp.headers, "HTTP/1.1 416 Range Not Satisfiable\r\n\r\n");
+    resp.headers_len = strlen(resp.headers);
+    http_range_content_range(&resp, -1, -1, SIZE);
+
+    ASSERT(resp.headers_len == strlen("HTTP/1.1 416 Range Not Satisfiable\r\nContent-Range: bytes */1000\r\n\r\n") &&
+           memcmp(resp.headers, "HTTP/1.1 416 Range Not Satisfiable\r\nContent-Range: bytes */1000\r\n\r\n",
+                  resp.headers_len) == 0, "content range error.");
+
+    DBG("debug done.\n");
+
+    return 0;
+}
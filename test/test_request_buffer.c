@@ -0,0 +1,295 @@
+/**
+ * @author ttoobne
+ * @date 2026/10/17
+ */
+
+#include "debug.h"
+#include "http_buffer.h"
+#include "http_request.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SPEC_MAX    8           /* 一次喂入的最多请求数 */
+#define TEXT_MAX    65536
+
+/* 生成的请求： uri 为 '/' 之后 uri_len 个字符，第 i 个首部字段为 "X-Test-i: " 之后 value_len 个字符 */
+typedef struct {
+    size_t          uri_len;
+    unsigned        header_num;
+    size_t          value_len;
+} spec_t;
+
+static char     text[TEXT_MAX];
+static size_t   text_len;
+static spec_t   specs[SPEC_MAX];
+static unsigned spec_num;
+
+static char fill(size_t i, size_t j) {
+    return 'a' + (i * 7 + j) % 26;
+}
+
+/*
+ * 追加一个请求，返回它在 text 中的起始偏移。
+ */
+static size_t add_request(size_t uri_len, unsigned header_num, size_t value_len) {
+    size_t start;
+    size_t j;
+    unsigned i;
+
+    start = text_len;
+
+    text_len += sprintf(text + text_len, "GET /");
+    for (j = 0; j < uri_len; ++ j) {
+        text[text_len ++ ] = fill(0, j);
+    }
+    text_len += sprintf(text + text_len, " HTTP/1.1\r\n");
+
+    for (i = 0; i < header_num; ++ i) {
+        text_len += sprintf(text + text_len, "X-Test-%u: ", i);
+        for (j = 0; j < value_len; ++ j) {
+            text[text_len ++ ] = fill(i + 1, j);
+        }
+        text_len += sprintf(text + text_len, "\r\n");
+    }
+
+    text_len += sprintf(text + text_len, "\r\n");
+
+    specs[spec_num].uri_len = uri_len;
+    specs[spec_num].header_num = header_num;
+    specs[spec_num].value_len = value_len;
+    spec_num ++ ;
+
+    ASSERT(text_len < TEXT_MAX && spec_num <= SPEC_MAX, "request text too long.");
+
+    return start;
+}
+
+static void reset_text() {
+    text_len = 0;
+    spec_num = 0;
+}
+
+/*
+ * 检查解析出的请求的每个片段都与生成时一致。
+ */
+static void check_request(http_request_t* rq, spec_t* spec) {
+    http_header_t* h;
+    char name[32];
+    char* p;
+    size_t j;
+    unsigned i;
+
+    ASSERT(rq->method == HTTP_GET, "method error.");
+    ASSERT((char*)rq->method_end - (char*)rq->method_start + 1 == 3 &&
+           memcmp(rq->method_start, "GET", 3) == 0, "method slice error.");
+
+    p = (char*)rq->uri_start;
+    ASSERT((size_t)((char*)rq->uri_end - p + 1) == spec->uri_len + 1 && p[0] == '/', "uri slice error.");
+    for (j = 0; j < spec->uri_len; ++ j) {
+        ASSERT(p[j + 1] == fill(0, j), "uri content error.");
+    }
+
+    ASSERT(rq->headers_num == spec->header_num, "header number error.");
+
+    for (i = 0; i < spec->header_num; ++ i) {
+        h = http_request_header(rq, i);
+
+        sprintf(name, "X-Test-%u", i);
+        ASSERT((size_t)((char*)h->header_name_end - (char*)h->header_name_start + 1) == strlen(name) &&
+               memcmp(h->header_name_start, name, strlen(name)) == 0, "header name slice error.");
+
+        p = (char*)h->header_value_start;
+        ASSERT((size_t)((char*)h->header_value_end - p + 1) == spec->value_len, "header value slice error.");
+        for (j = 0; j < spec->value_len; ++ j) {
+            ASSERT(p[j] == fill(i + 1, j), "header value content error.");
+        }
+    }
+}
+
+/*
+ * 与 serve_connection 相同地读入 text ：挂上缓冲区，缓冲区满时追加大缓冲区，每次最多读入 step 字节，
+ * 每解析出一个完整的请求就检查并 http_request_reset ，缓冲区中还有数据时先解析再读。
+ * 返回解析出的请求数，超过 large_header_buffers 时返回 -HTTP_BAD_REQUEST 。
+ */
+static int feed(http_request_t* rq, size_t step) {
+    unsigned done;
+    size_t pos;
+    size_t n;
+    int pending;
+    int ret;
+
+    done = 0;
+    pos = 0;
+    pending = 0;
+
+    for ( ;; ) {
+        ASSERT(http_request_attach_buffer(rq) == 0, "attach buffer failed.");
+
+        if (!pending) {
+            if (pos == text_len) {
+                break;
+            }
+
+            if (rq->bufed == rq->buflast && http_request_grow_buffer(rq) != 0) {
+                return -HTTP_BAD_REQUEST;
+            }
+
+            n = rq->buflast - rq->bufed;
+            n = n < step ? n : step;
+            n = n < text_len - pos ? n : text_len - pos;
+
+            memcpy(rq->bufed, text + pos, n);
+            rq->bufed += n;
+            pos += n;
+        }
+
+        if ((ret = rq->handler(rq)) == REQUEST_AGAIN) {
+            pending = 0;
+            continue;
+        }
+
+        ASSERT(ret == REQUEST_OK, "parse error.");
+        ASSERT(done < spec_num, "too many requests.");
+
+        check_request(rq, &specs[done ++ ]);
+
+        http_request_reset(rq);
+
+        /* 重置后链中只剩当前缓冲区，未解析的数据在它的开头 */
+        ASSERT(rq->buffer->next == NULL && rq->bufst == rq->buf, "reset did not compact the buffer.");
+
+        pending = rq->bufst != rq->bufed;
+    }
+
+    ASSERT(rq->bufst == rq->bufed, "unparsed data left.");
+
+    http_request_release_buffer(rq);
+    ASSERT(rq->buffer == NULL, "buffer not released.");
+
+    return done;
+}
+
+/*
+ * 以不同的步长分别喂入 text ，都应解析出全部请求。
+ */
+static void feed_all(http_request_t* rq) {
+    static const size_t steps[] = {1, 3, 100, TEXT_MAX};
+    unsigned i;
+
+    for (i = 0; i < sizeof(steps) / sizeof(steps[0]); ++ i) {
+        ASSERT(feed(rq, steps[i]) == (int)spec_num, "request number error.");
+    }
+}
+
+int main() {
+    http_request_t* rq;
+    size_t line;
+    size_t pad;
+    size_t start;
+
+    ASSERT((rq = http_request_init(-1, NULL, NULL)) != NULL, "http_request_init failed.");
+    rq->large_max = 4;
+
+    /* 流水线上的小请求 */
+    reset_text();
+    add_request(10, 3, 20);
+    add_request(1, 0, 0);
+    add_request(30, 16, 5);
+    add_request(2, 20, 3);          /* 首部字段多于 HTTP_HEADERS_INLINE 个 */
+    feed_all(rq);
+
+    /* 请求行恰好跨过第一块缓冲区的末尾： "GET /" 5 字节， " HTTP/1.1\r\n" 11 字节 */
+    for (line = BUF_SIZE - 4; line <= BUF_SIZE + 4; ++ line) {
+        reset_text();
+        add_request(line - 16, 2, 10);
+        feed_all(rq);
+    }
+
+    /* 首部字段恰好跨过第一块缓冲区的末尾，第一个首部字段 "X-Test-0: " 之前为 13 字节的请求行 */
+    for (pad = BUF_SIZE - 40; pad <= BUF_SIZE - 20; ++ pad) {
+        reset_text();
+        add_request(0, 3, pad);
+        feed_all(rq);
+    }
+
+    /* 首部字段恰好跨过大缓冲区的末尾：每个首部字段约 1000 字节，逐字节移动边界 */
+    for (pad = 990; pad <= 1010; ++ pad) {
+        reset_text();
+        add_request(0, 20, pad);
+        feed_all(rq);
+    }
+
+    /* 单个首部字段放不下一块大缓冲区时返回 400 ，刚好放得下时正常 */
+    reset_text();
+    add_request(0, 1, BUF_LARGE_SIZE - 14);
+    feed_all(rq);
+
+    reset_text();
+    add_request(0, 1, BUF_LARGE_SIZE);
+    ASSERT(feed(rq, 1) == -HTTP_BAD_REQUEST, "oversized header accepted.");
+    http_request_reset(rq);
+    http_request_release_buffer(rq);
+
+    /* 请求头部用完 large_header_buffers 块大缓冲区时返回 400 */
+    reset_text();
+    add_request(0, 30, 1000);       /* 约 30KB ，需要 4 块大缓冲区 */
+    feed_all(rq);
+
+    rq->large_max = 3;
+    ASSERT(feed(rq, 1) == -HTTP_BAD_REQUEST, "large_header_buffers not enforced.");
+    ASSERT(rq->large_num == 3, "large buffer number error.");
+    http_request_reset(rq);
+    http_request_release_buffer(rq);
+
+    rq->large_max = 0;
+    ASSERT(feed(rq, 1) == -HTTP_BAD_REQUEST, "large_header_buffers not enforced.");
+    http_request_reset(rq);
+    http_request_release_buffer(rq);
+
+    rq->large_max = 4;
+
+    /* 流水线上的下一个请求跟在大缓冲区中的请求之后，重置时从大缓冲区中移到开头 */
+    reset_text();
+    add_request(0, 5, 400);
+    start = add_request(7, 4, 9);
+    add_request(3, 2, 1);
+    ASSERT(start > BUF_SIZE, "first request should need a large buffer.");
+    feed_all(rq);
+
+    /* 一次读入两个请求，检查第一个请求重置之后的缓冲区 */
+    ASSERT(http_request_attach_buffer(rq) == 0, "attach buffer failed.");
+    memcpy(rq->bufed, text, BUF_SIZE);
+    rq->bufed += BUF_SIZE;
+    ASSERT(rq->handler(rq) == REQUEST_AGAIN, "first request should be incomplete.");
+    ASSERT(http_request_grow_buffer(rq) == 0, "grow buffer failed.");
+    memcpy(rq->bufed, text + BUF_SIZE, text_len - BUF_SIZE);
+    rq->bufed += text_len - BUF_SIZE;
+
+    ASSERT(rq->handler(rq) == REQUEST_OK, "parse error.");
+    check_request(rq, &specs[0]);
+    http_request_reset(rq);
+
+    ASSERT(rq->buffer->size == BUF_LARGE_SIZE && rq->buffer->next == NULL && rq->large_num == 1,
+           "tail not kept in the large buffer.");
+    ASSERT((size_t)(rq->bufed - rq->bufst) == text_len - start && memcmp(rq->bufst, text + start, text_len - start) == 0,
+           "tail not moved to the beginning.");
+
+    ASSERT(rq->handler(rq) == REQUEST_OK, "parse error.");
+    check_request(rq, &specs[1]);
+    http_request_reset(rq);
+    ASSERT(rq->handler(rq) == REQUEST_OK, "parse error.");
+    check_request(rq, &specs[2]);
+    http_request_reset(rq);
+
+    ASSERT(rq->bufst == rq->bufed, "unparsed data left.");
+    http_request_release_buffer(rq);
+    ASSERT(rq->buffer == NULL, "buffer not released.");
+
+    http_request_destroy(rq);
+
+    DBG("debug done.\n");
+
+    return 0;
+}
@@ -6,16 +6,29 @@
 #include "debug.h"
 #include "threadpool.h"
 
+#include <pthread.h>
 #include <stdio.h>
+#include <time.h>
 #include <unistd.h>
 
 #define THREAD_NUM 128
 #define QUEUE_SIZE 1024
 
+#define BENCH_WORKERS   8           /* 竞争测试的工作线程数 */
+#define BENCH_QUEUE     1024        /* 竞争测试的任务队列大小 */
+#define BENCH_TASKS     200000      /* 每个生产者添加的任务数 */
+
+#define ELASTIC_MIN     1           /* 弹性测试的最小线程数 */
+#define ELASTIC_MAX     8           /* 弹性测试的最大线程数 */
+#define ELASTIC_TASKS   256         /* 弹性测试的任务数 */
+
 pthread_mutex_t wnum_lock;
 int work_num;
 int tot_num;
 
+long bench_done;
+threadpool_t* bench_pool;
+
 void* working(void* args) {
     usleep(10000);
     pthread_mutex_lock(&wnum_lock);
@@ -24,11 +37,99 @@ void* working(void* args) {
     return NULL;
 }
 
+/* 竞争测试中的空任务，只计数 */
+void* bench_working(void* args) {
+    __atomic_add_fetch(&bench_done, 1, __ATOMIC_RELAXED);
+    return NULL;
+}
+
+/* 竞争测试中的生产者 */
+void* bench_producer(void* args) {
+    int i;
+
+    for (i = 0; i < BENCH_TASKS; ++ i) {
+        threadpool_add_task(bench_pool, bench_working, NULL);
+    }
+
+    return NULL;
+}
+
+/*
+ * 多个生产者同时添加空任务，测量任务队列在竞争下的吞吐量。
+ */
+void bench_contention(int producers, int mode) {
+    pthread_t tids[64];
+    struct timespec st, ed;
+    long total;
+    double secs;
+    int i;
+
+    ASSERT((bench_pool = threadpool_create_mode(BENCH_WORKERS, BENCH_QUEUE, mode)) != NULL, "threadpool create failed.");
+
+    bench_done = 0;
+    total = (long)producers * BENCH_TASKS;
+
+    clock_gettime(CLOCK_MONOTONIC, &st);
+
+    for (i = 0; i < producers; ++ i) {
+        pthread_create(&tids[i], NULL, bench_producer, NULL);
+    }
+    for (i = 0; i < producers; ++ i) {
+        pthread_join(tids[i], NULL);
+    }
+    while (__atomic_load_n(&bench_done, __ATOMIC_RELAXED) < total) {
+        usleep(100);
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &ed);
+
+    ASSERT(threadpool_destroy(bench_pool) == 0, "threadpool destory failed.");
+
+    secs = (ed.tv_sec - st.tv_sec) + (ed.tv_nsec - st.tv_nsec) / 1e9;
+    printf("%s producers: %2d workers: %d tasks: %ld time: %.3fs throughput: %.0f tasks/s\n",
+           mode == THREADPOOL_STEAL ? "steal" : "fifo ", producers, BENCH_WORKERS, total, secs, total / secs);
+}
+
+/*
+ * 弹性测试：慢任务积压时线程数增长，空闲后回落到最小线程数。
+ */
+void test_elastic(int mode) {
+    threadpool_t* pool;
+    int current, min, max, peak;
+    int i;
+
+    ASSERT((pool = threadpool_create_elastic(ELASTIC_MIN, ELASTIC_MAX, QUEUE_SIZE, mode, 64 * 1024)) != NULL,
+           "threadpool create failed.");
+    threadpool_set_scaling(pool, 5, 200);
+
+    work_num = 0;
+    for (i = 0; i < ELASTIC_TASKS; ++ i) {
+        threadpool_add_task(pool, working, NULL);
+    }
+
+    peak = 0;
+    while (work_num < ELASTIC_TASKS) {
+        threadpool_get_threads(pool, &current, &min, &max);
+        peak = current > peak ? current : peak;
+        usleep(10000);
+    }
+
+    /* 等待多出的线程空闲退出，每个线程退出需要一个空闲时间 */
+    usleep(200000 * (ELASTIC_MAX + 1));
+    threadpool_get_threads(pool, &current, &min, &max);
+
+    printf("elastic %s: peak %d threads, %d threads after idle (min %d, max %d)\n",
+           mode == THREADPOOL_STEAL ? "steal" : "fifo ", peak, current, min, max);
+    ASSERT(peak > ELASTIC_MIN && current == ELASTIC_MIN, "threadpool not elastic.");
+
+    ASSERT(threadpool_destroy(pool) == 0, "threadpool destory failed.");
+}
+
 int main() {
     int i;
     threadpool_t* pool = NULL;
     ASSERT((pool = threadpool_create(THREAD_NUM, QUEUE_SIZE)) != NULL, "threadpool create failed.");
-    
+
     work_num = 0;
     tot_num = QUEUE_SIZE << 4;
     for (i = 0; i < tot_num; ++ i) {
@@ -43,5 +144,15 @@ int main() {
 
 	printf("done.\nwork_num: %d\ntot_num: %d\n", work_num, tot_num);
 
+    /* 弹性测试 */
+    test_elastic(THREADPOOL_FIFO);
+    test_elastic(THREADPOOL_STEAL);
+
+    /* 竞争测试 */
+    for (i = 1; i <= 16; i <<= 1) {
+        bench_contention(i, THREADPOOL_FIFO);
+        bench_contention(i, THREADPOOL_STEAL);
+    }
+
     return 0;
 }
@@ -0,0 +1,229 @@
+/**
+ * @author ttoobne
+ * @date 2026/10/17
+ */
+
+#include "debug.h"
+#include "http_request.h"
+#include "http_timer.h"
+#include "times.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define TIMER_NUM   20000
+#define MAX_TIMEOUT 3000
+#define SLACK       20          /* 缓存时钟精度与调度带来的允许误差（毫秒） */
+#define REMOTE_NUM  200         /* 其他线程重新定时的事件数 */
+#define REMOTE_WAIT 50          /* 其他线程定时的超时时间 */
+
+typedef struct {
+    unsigned long   deadline;   /* 预期的到期时间， 0 表示已删除 */
+    unsigned long   fired;      /* 实际的到期时间 */
+} record_t;
+
+static http_request_t*  requests;
+static record_t         records[TIMER_NUM];
+static int              fired_num;
+
+static int on_timeout(void* http_request) {
+    record_t* r;
+
+    r = &records[(http_request_t*)http_request - requests];
+
+    ASSERT(r->fired == 0, "timer fired twice.");
+    r->fired = current_msec();
+    fired_num ++ ;
+
+    return 0;
+}
+
+/*
+ * 第一个事件到期时重新定时第二个事件、移出第三个事件，三者同时到期。
+ */
+static int on_timeout_first(void* http_request) {
+    update_times();
+    add_timer(&requests[1], MAX_TIMEOUT / 10, on_timeout);
+    records[1].deadline = current_msec() + MAX_TIMEOUT / 10;
+
+    detach_timer(&requests[2]);
+    records[2].deadline = 0;
+
+    return on_timeout(http_request);
+}
+
+/*
+ * 模拟工作线程为已分发的事件重新定时。
+ */
+static void* remote_add(void* arg) {
+    int i;
+
+    for (i = 0; i < REMOTE_NUM; ++ i) {
+        update_times();
+        records[i].deadline = current_msec() + REMOTE_WAIT;
+        add_timer(&requests[i], REMOTE_WAIT, on_timeout);
+
+        if (i == 0) {
+            __atomic_store_n((int*)arg, 1, __ATOMIC_RELEASE);
+        }
+
+        usleep((i % 7) * 300);
+    }
+
+    return NULL;
+}
+
+/*
+ * 推进时间轮直到 expect 个事件到期或超过 limit 毫秒，检查到期时间。
+ */
+static void run_wheel(int expect, unsigned long limit, int num) {
+    unsigned long end;
+    msec_t wait;
+    int i;
+
+    end = current_msec() + limit;
+
+    while (fired_num < expect && current_msec() < end) {
+        wait = find_timer();
+
+        ASSERT(wait != (msec_t)TIMER_INFINITE, "timer wheel empty too early.");
+
+        usleep(wait * 1000);
+        update_times();
+        expire_timers();
+    }
+
+    ASSERT(fired_num == expect, "fired number error.");
+
+    for (i = 0; i < num; ++ i) {
+        if (records[i].deadline == 0) {
+            ASSERT(records[i].fired == 0, "deleted timer fired.");
+            continue;
+        }
+
+        ASSERT(records[i].fired >= records[i].deadline, "timer fired too early.");
+        ASSERT(records[i].fired <= records[i].deadline + SLACK, "timer fired too late.");
+    }
+}
+
+int main() {
+    unsigned long now;
+    unsigned long end;
+    msec_t wait;
+    pthread_t tid;
+    int started;
+    int expect;
+    int i;
+
+    srand(1);
+
+    ASSERT(init_times() == 0, "init times failed.");
+    ASSERT(init_timer() == 0, "init timer failed.");
+
+    requests = (http_request_t*)calloc(TIMER_NUM, sizeof(http_request_t));
+
+    /* 先写一遍，避免添加定时器时的缺页使先添加的定时器在开始推进前就已到期 */
+    for (i = 0; i < TIMER_NUM; ++ i) {
+        requests[i].fd = -1;
+    }
+
+    /* 添加随机的定时器，之后删除一部分、延长一部分、缩短一部分 */
+    for (i = 0; i < TIMER_NUM; ++ i) {
+        update_times();
+        now = current_msec();
+        records[i].deadline = now + 1 + rand() % MAX_TIMEOUT;
+        add_timer(&requests[i], records[i].deadline - now, on_timeout);
+    }
+
+    expect = TIMER_NUM;
+    for (i = 0; i < TIMER_NUM; i += 7) {
+        delete_timer(&requests[i]);
+        records[i].deadline = 0;
+        expect -- ;
+    }
+
+    for (i = 1; i < TIMER_NUM; i += 7) {
+        update_times();
+        now = current_msec();
+        records[i].deadline = now + (i % 2 ? MAX_TIMEOUT : 1 + rand() % 100);
+        add_timer(&requests[i], records[i].deadline - now, on_timeout);
+    }
+
+    end = current_msec() + MAX_TIMEOUT + 500;
+
+    while (current_msec() < end) {
+        wait = find_timer();
+
+        if (wait == (msec_t)TIMER_INFINITE) {
+            break;
+        }
+
+        usleep(wait * 1000);
+        update_times();
+        expire_timers();
+    }
+
+    ASSERT(fired_num == expect, "fired number error.");
+
+    for (i = 0; i < TIMER_NUM; ++ i) {
+        if (records[i].deadline == 0) {
+            ASSERT(records[i].fired == 0, "deleted timer fired.");
+            continue;
+        }
+
+        ASSERT(records[i].fired >= records[i].deadline, "timer fired too early.");
+        ASSERT(records[i].fired <= records[i].deadline + SLACK, "timer fired too late.");
+    }
+
+    for (i = 0; i < TIMER_NUM; ++ i) {
+        detach_timer(&requests[i]);
+    }
+
+    ASSERT(find_timer() == (msec_t)TIMER_INFINITE, "timer wheel not empty.");
+
+    /* 到期的节点等待回调期间被其他回调重新定时或移出 */
+    memset(records, 0, sizeof(records));
+    fired_num = 0;
+
+    update_times();
+    now = current_msec();
+    records[0].deadline = now + 10;
+    add_timer(&requests[0], 10, on_timeout_first);
+    add_timer(&requests[1], 10, on_timeout);
+    add_timer(&requests[2], 10, on_timeout);
+    add_timer(&requests[3], 5, on_timeout);         /* 保证前三个事件到期之前时间轮不为空 */
+    records[3].deadline = now + 5;
+
+    run_wheel(3, MAX_TIMEOUT, 4);
+
+    /* 其他线程为本线程时间轮中的事件重新定时，节点经收件箱放入时间轮，本线程空闲时也能按时取走 */
+    for (i = 0; i < TIMER_NUM; ++ i) {
+        detach_timer(&requests[i]);
+    }
+
+    memset(records, 0, sizeof(records));
+    fired_num = 0;
+    started = 0;
+
+    ASSERT(pthread_create(&tid, NULL, remote_add, &started) == 0, "create thread failed.");
+
+    while (!__atomic_load_n(&started, __ATOMIC_ACQUIRE)) {
+        usleep(100);
+    }
+
+    update_times();
+    run_wheel(REMOTE_NUM, MAX_TIMEOUT, REMOTE_NUM);
+
+    pthread_join(tid, NULL);
+
+    ASSERT(find_timer() == REMOTE_WAIT, "wait not bounded by the remote timeout.");
+
+    free(requests);
+
+    DBG("debug done.\n");
+
+    return 0;
+}